@@ -0,0 +1,75 @@
+#ifndef __BENCH_FRAMEWORK__
+#define __BENCH_FRAMEWORK__
+
+// system includes
+#include <functional>
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <chrono>
+
+struct bench_result {
+    std::string set;
+    std::string name;
+    uint64_t iterations;
+    double seconds;
+    std::map<std::string,double> metrics;
+};
+
+struct bench_case {
+    const char* name;
+    std::function<void(bench_result&)> run;
+};
+
+class bench_timer {
+
+    private:
+
+        std::chrono::steady_clock::time_point start;
+
+    public:
+
+        bench_timer();
+
+        double elapsed();
+
+};
+
+class bench_set {
+
+    public:
+
+        // a function-local static, so sets in other files can
+        // register no matter which is initialized first
+        static std::vector<bench_set*>& all_bench_sets();
+
+        std::string name;
+
+        std::vector<bench_case> benches;
+
+        bench_set( std::string t_name, std::vector<bench_case> t_cases );
+
+        void run( std::vector<bench_result>& t_results );
+
+};
+
+class bench_framework {
+
+    public:
+
+        std::vector<bench_result> results;
+
+        void run();
+
+        void report( std::ostream& t_out );
+};
+
+// ------------------------------------------------------------------
+// FUNCTIONS
+// ------------------------------------------------------------------
+std::string get_path( std::string partial );
+
+std::string json_escape( std::string s );
+
+#endif
@@ -0,0 +1,698 @@
+#include <memory>
+#include <map>
+#include <random>
+#include <fstream>
+#include <thread>
+#include <atomic>
+
+#include <unistd.h>
+#include <malloc.h>
+
+#include <boost/filesystem.hpp>
+
+#include "bench-framework.hpp"
+
+#include "blockchain.hpp"
+#include "generator.hpp"
+#include "segment_store.hpp"
+#include "publication_record.hpp"
+#include "genesis_record.hpp"
+#include "keys.hpp"
+#include "signature_cache.hpp"
+
+// synthetic chains are mined at a low difficulty so that
+// building them is bound by signing rather than mining
+static const unsigned int CHAIN_DIFFICULTY = 4;
+
+// the number of lookups timed by each find benchmark
+static const size_t LOOKUPS = 100;
+
+// the number of records published to segments by each append benchmark
+static const size_t APPENDS = 100;
+
+// the number of records published by each burst benchmark
+static const size_t BURST = 48;
+
+// sets the chain difficulty (or the given bits) for one
+// benchmark and puts the old difficulty back afterwards
+class difficulty_guard {
+
+    private:
+
+        unsigned int difficulty;
+
+    public:
+
+        difficulty_guard( unsigned int t_bits = CHAIN_DIFFICULTY ) : difficulty(BaseRecord::get_difficulty()) {
+            BaseRecord::set_difficulty(t_bits);
+        }
+
+        ~difficulty_guard(){
+            BaseRecord::set_difficulty(difficulty);
+        }
+
+};
+
+static std::string chain_path( size_t t_size ){
+    boost::filesystem::path path = boost::filesystem::temp_directory_path();
+    path /= "rechain-bench-chain-" + std::to_string(t_size) + ".dat";
+    return path.string();
+}
+
+// chains are built once and cached on disk, because signing
+// 100k records takes minutes
+static Blockchain& synthetic_chain( size_t t_size, bench_result& t_result ){
+
+    static std::map< size_t, std::unique_ptr<Blockchain> > chains;
+
+    auto it = chains.find(t_size);
+    if(it != chains.end()){
+        return *it->second;
+    }
+
+    bench_timer timer;
+    std::unique_ptr<Blockchain> chain(new Blockchain());
+    std::string path = chain_path(t_size);
+
+    if(!chain->load(path) || chain->size() != t_size){
+        Generator generator(t_size,3,0.5,CHAIN_DIFFICULTY);
+        generator.set_keys(get_path("keys"));
+
+        chain.reset(new Blockchain());
+        generator.generate(*chain);
+        chain->save(path);
+    }
+
+    t_result.metrics["setup_seconds"] = timer.elapsed();
+
+    Blockchain& result = *chain;
+    chains[t_size] = std::move(chain);
+    return result;
+}
+
+// records picked evenly along the chain so lookups
+// cost the same from run to run
+static std::vector< std::shared_ptr<BaseRecord> > sample( Blockchain& t_chain, RecordType t_type ){
+
+    std::vector< std::shared_ptr<BaseRecord> > records;
+    std::vector< std::shared_ptr<BaseRecord> > samples;
+
+    for(auto& record : t_chain){
+        if(record->get_type() == t_type){
+            records.push_back(record);
+        }
+    }
+
+    std::mt19937 generator(t_chain.size());
+    std::uniform_int_distribution<size_t> pick(0,records.size() - 1);
+
+    for(size_t i = 0; i < LOOKUPS && !records.empty(); ++i){
+        samples.push_back(records[pick(generator)]);
+    }
+
+    return samples;
+}
+
+static void save_with( bench_result& t_result, size_t t_size, FileFormat t_format = FileFormat::TextFile ){
+    difficulty_guard guard;
+    Blockchain& chain = synthetic_chain(t_size,t_result);
+
+    FileFormat format = chain.get_file_format();
+    chain.set_file_format(t_format);
+
+    std::string path = chain_path(t_size) + ".save";
+
+    bench_timer timer;
+    chain.save(path);
+    t_result.seconds = timer.elapsed();
+    t_result.iterations = chain.size();
+
+    t_result.metrics["bytes"] = boost::filesystem::file_size(path);
+
+    chain.set_file_format(format);
+    boost::filesystem::remove(path);
+}
+
+static void load_with( bench_result& t_result, size_t t_size, FileFormat t_format = FileFormat::TextFile ){
+    difficulty_guard guard;
+    Blockchain& cached = synthetic_chain(t_size,t_result);
+
+    FileFormat format = cached.get_file_format();
+    cached.set_file_format(t_format);
+
+    std::string path = chain_path(t_size) + ".load";
+    cached.save(path);
+    cached.set_file_format(format);
+
+    Blockchain chain;
+
+    bench_timer timer;
+    t_result.metrics["valid"] = chain.load(path);
+    t_result.seconds = timer.elapsed();
+    t_result.iterations = chain.size();
+
+    // reading alone, without checking signatures
+    Blockchain unchecked;
+
+    bench_timer read;
+    unchecked.read(path);
+    t_result.metrics["read_seconds"] = read.elapsed();
+    t_result.metrics["bytes"] = boost::filesystem::file_size(path);
+
+    // checking after the whole file is read, the way load used to
+    bench_timer checked;
+    unchecked.is_valid();
+    unchecked.update_trust();
+    t_result.metrics["sequential_seconds"] = t_result.metrics["read_seconds"] + checked.elapsed();
+
+    boost::filesystem::remove(path);
+}
+
+// each record is synced on its own, the way Manager publishes
+static void append_with( bench_result& t_result, size_t t_size ){
+    difficulty_guard guard;
+    Blockchain& chain = synthetic_chain(t_size,t_result);
+
+    std::string path = chain_path(t_size) + ".segments";
+    boost::filesystem::remove_all(path);
+
+    std::vector< std::shared_ptr<BaseRecord> > records;
+
+    {
+        SegmentStore store(path);
+        store.open(records);
+
+        bench_timer import;
+        for(auto& record : chain){
+            store.append(record);
+        }
+        store.sync();
+        t_result.metrics["import_seconds"] = import.elapsed();
+    }
+
+    SegmentStore store(path);
+
+    bench_timer open;
+    store.open(records);
+    t_result.metrics["open_seconds"] = open.elapsed();
+
+    // the store doesn't check records, so the same ones can be added again
+    auto it = chain.begin();
+
+    bench_timer timer;
+    for(size_t i = 0; i < APPENDS; ++i){
+        store.append(*it++);
+        store.sync();
+    }
+    t_result.seconds = timer.elapsed();
+    t_result.iterations = APPENDS;
+
+    boost::filesystem::remove_all(path);
+}
+
+// writers that publish and sync at the same time share fsyncs. Nothing
+// is mined, so the time is signing, appending and syncing.
+static void burst_with( bench_result& t_result, size_t t_writers ){
+    difficulty_guard guard(0);
+
+    std::string path = chain_path(0) + ".burst";
+    boost::filesystem::remove_all(path);
+
+    std::shared_ptr<PrivateKey> key(PrivateKey::load_file(get_path("keys/rsa.private")));
+
+    std::shared_ptr<GenesisRecord> genesis(new GenesisRecord());
+    genesis->set_distribution({"FIRST","SECOND"});
+
+    {
+        Blockchain chain;
+        chain.publish(genesis,key);
+        chain.open(path);
+
+        std::atomic<size_t> synced(0);
+        std::vector<std::thread> writers;
+
+        bench_timer timer;
+        for(size_t i = 0; i < t_writers; ++i){
+            writers.push_back(std::thread([&,i]{
+                for(size_t j = 0; j < BURST / t_writers; ++j){
+                    std::shared_ptr<PublicationRecord> publication(new PublicationRecord());
+                    publication->set_reference("BURST" + std::to_string(i) + "-" + std::to_string(j));
+
+                    if(chain.publish(publication,key) && chain.sync()){
+                        synced++;
+                    }
+                }
+            }));
+        }
+
+        for(auto& writer : writers){
+            writer.join();
+        }
+
+        t_result.seconds = timer.elapsed();
+        t_result.iterations = synced;
+    }
+
+    boost::filesystem::remove_all(path);
+}
+
+// resident and file-backed bytes of this process
+static void resident( double& t_resident, double& t_shared ){
+    size_t size, pages, shared;
+
+    std::ifstream statm("/proc/self/statm");
+    statm >> size >> pages >> shared;
+
+    t_resident = (double)pages * sysconf(_SC_PAGESIZE);
+    t_shared = (double)shared * sysconf(_SC_PAGESIZE);
+}
+
+static void open_with( bench_result& t_result, size_t t_size, bool t_mapped ){
+    difficulty_guard guard;
+    Blockchain& chain = synthetic_chain(t_size,t_result);
+
+    std::string path = chain_path(t_size) + ".segments";
+    boost::filesystem::remove_all(path);
+
+    std::vector< std::shared_ptr<BaseRecord> > records;
+
+    {
+        SegmentStore store(path);
+        store.open(records);
+
+        for(auto& record : chain){
+            store.append(record);
+        }
+    }
+
+    malloc_trim(0);
+
+    double resident_before, shared_before;
+    resident(resident_before,shared_before);
+
+    SegmentStore store(path);
+    store.set_mapped(t_mapped);
+
+    bench_timer timer;
+    store.open(records);
+    t_result.seconds = timer.elapsed();
+    t_result.iterations = records.size();
+
+    double resident_after, shared_after;
+    resident(resident_after,shared_after);
+
+    // mapped pages are shared with the page cache and other processes
+    t_result.metrics["rss_bytes"] = resident_after - resident_before;
+    t_result.metrics["anon_bytes"] = (resident_after - shared_after) - (resident_before - shared_before);
+
+    // decoding every record as validation would
+    bench_timer decode;
+    for(auto& record : records){
+        record->get_signature();
+    }
+    t_result.metrics["decode_seconds"] = decode.elapsed();
+
+    records.clear();
+    boost::filesystem::remove_all(path);
+}
+
+// a node restarting after a snapshot, with some records appended since
+static void resume_with( bench_result& t_result, size_t t_size ){
+    difficulty_guard guard;
+    Blockchain& chain = synthetic_chain(t_size,t_result);
+
+    const size_t APPENDED = 100;
+
+    std::string path = chain_path(t_size) + ".segments";
+    std::string snapshot = chain_path(t_size) + ".snapshot";
+    boost::filesystem::remove_all(path);
+    boost::filesystem::remove(snapshot);
+
+    std::vector< std::shared_ptr<BaseRecord> > records;
+    auto split = chain.begin() + (chain.size() - APPENDED);
+
+    {
+        SegmentStore store(path);
+        store.open(records);
+
+        for(auto it = chain.begin(); it != split; ++it){
+            store.append(*it);
+        }
+    }
+
+    // checking every record writes the snapshot
+    {
+        Blockchain full;
+        full.set_snapshot(snapshot);
+        full.set_full_check(true);
+
+        bench_timer timer;
+        full.open(path);
+        t_result.metrics["full_seconds"] = timer.elapsed();
+    }
+
+    {
+        SegmentStore store(path);
+        store.open(records);
+
+        for(auto it = split; it != chain.end(); ++it){
+            store.append(*it);
+        }
+    }
+
+    uint64_t checked = 0;
+
+    Blockchain resumed;
+    resumed.set_snapshot(snapshot);
+
+    bench_timer timer;
+    t_result.metrics["valid"] = resumed.open(path,true,[&checked]( uint64_t t_done, uint64_t /* t_total */ ){
+        checked = t_done;
+    });
+    t_result.seconds = timer.elapsed();
+    t_result.iterations = resumed.size();
+
+    t_result.metrics["checked"] = checked;
+    t_result.metrics["snapshot_bytes"] = boost::filesystem::file_size(snapshot);
+
+    // the same snapshot deflated
+    resumed.set_compressed(true);
+    resumed.snapshot();
+    t_result.metrics["compressed_snapshot_bytes"] = boost::filesystem::file_size(snapshot);
+
+    boost::filesystem::remove_all(path);
+    boost::filesystem::remove(snapshot);
+}
+
+// the bytes of every file in a directory
+static double directory_bytes( std::string t_path ){
+    double bytes = 0;
+    for(auto& entry : boost::filesystem::directory_iterator(t_path)){
+        bytes += boost::filesystem::file_size(entry.path());
+    }
+    return bytes;
+}
+
+// segments of 1k records, so that even the smallest chain seals one
+static void compress_with( bench_result& t_result, size_t t_size ){
+    difficulty_guard guard;
+    Blockchain& chain = synthetic_chain(t_size,t_result);
+
+    const size_t SEGMENT = 1000;
+
+    std::string plain = chain_path(t_size) + ".plain";
+    std::string path  = chain_path(t_size) + ".compressed";
+
+    double seconds[2];
+    double bytes[2];
+
+    for(bool compressed : {false,true}){
+        std::string directory = compressed ? path : plain;
+        boost::filesystem::remove_all(directory);
+
+        std::vector< std::shared_ptr<BaseRecord> > records;
+
+        {
+            SegmentStore store(directory,SEGMENT);
+            store.set_compressed(compressed);
+            store.open(records);
+
+            bench_timer timer;
+            for(auto& record : chain){
+                store.append(record);
+            }
+            t_result.metrics[compressed ? "compressed_append_seconds" : "plain_append_seconds"] = timer.elapsed();
+        }
+
+        // sealed segments are compressed when the store is next opened
+        if(compressed){
+            SegmentStore store(directory,SEGMENT);
+            store.set_compressed(true);
+
+            bench_timer timer;
+            store.open(records);
+            t_result.metrics["compress_seconds"] = timer.elapsed();
+        }
+
+        bytes[compressed] = directory_bytes(directory);
+
+        malloc_trim(0);
+
+        // opening and decoding every record, as validation would
+        SegmentStore store(directory,SEGMENT);
+
+        bench_timer timer;
+        store.open(records);
+        for(auto& record : records){
+            record->get_signature();
+        }
+        seconds[compressed] = timer.elapsed();
+
+        t_result.iterations = records.size();
+    }
+
+    t_result.seconds = seconds[1];
+
+    t_result.metrics["plain_bytes"] = bytes[0];
+    t_result.metrics["compressed_bytes"] = bytes[1];
+    t_result.metrics["ratio"] = bytes[0] / bytes[1];
+    t_result.metrics["plain_seconds"] = seconds[0];
+    t_result.metrics["records_per_second"] = t_result.iterations / seconds[1];
+    t_result.metrics["plain_records_per_second"] = t_result.iterations / seconds[0];
+
+    boost::filesystem::remove_all(plain);
+    boost::filesystem::remove_all(path);
+}
+
+static void validate_with( bench_result& t_result, size_t t_size ){
+    difficulty_guard guard;
+    Blockchain& chain = synthetic_chain(t_size,t_result);
+
+    // setting a field drops the cached digests, so
+    // hashing is part of the timing
+    for(auto& record : chain){
+        record->set_previous(record->get_previous());
+    }
+
+    bench_timer single;
+    chain.is_valid(1);
+    t_result.metrics["one_thread_seconds"] = single.elapsed();
+
+    for(auto& record : chain){
+        record->set_previous(record->get_previous());
+    }
+
+    bench_timer timer;
+    t_result.metrics["valid"] = chain.is_valid();
+    t_result.seconds = timer.elapsed();
+    t_result.iterations = chain.size();
+
+    t_result.metrics["threads"] = std::thread::hardware_concurrency();
+}
+
+// validating after a restart, with the signatures verified by the
+// last run in the cache
+static void verified_with( bench_result& t_result, size_t t_size ){
+    difficulty_guard guard;
+    Blockchain& chain = synthetic_chain(t_size,t_result);
+
+    std::string path = chain_path(t_size) + ".verified";
+    std::string secret(32,'s');
+    boost::filesystem::remove(path);
+
+    for(auto& record : chain){
+        record->set_previous(record->get_previous());
+    }
+
+    // the first run verifies every signature
+    SignatureCache::open(path,secret);
+
+    bench_timer first;
+    chain.is_valid();
+    t_result.metrics["uncached_seconds"] = first.elapsed();
+
+    SignatureCache::close();
+
+    for(auto& record : chain){
+        record->set_previous(record->get_previous());
+    }
+
+    bench_timer reopen;
+    SignatureCache::open(path,secret);
+    t_result.metrics["open_seconds"] = reopen.elapsed();
+
+    bench_timer timer;
+    t_result.metrics["valid"] = chain.is_valid();
+    t_result.seconds = timer.elapsed();
+    t_result.iterations = chain.size();
+
+    t_result.metrics["hits"] = SignatureCache::get_hits();
+    t_result.metrics["misses"] = SignatureCache::get_misses();
+    t_result.metrics["cache_bytes"] = boost::filesystem::file_size(path);
+
+    SignatureCache::close();
+    boost::filesystem::remove(path);
+}
+
+// publishing the way Manager does, on top of a chain that was checked
+// when it was loaded
+static void publish_with( bench_result& t_result, size_t t_size ){
+    difficulty_guard guard;
+    synthetic_chain(t_size,t_result);
+
+    const size_t PUBLISHES = 20;
+
+    Blockchain chain;
+    chain.load(chain_path(t_size));
+
+    std::shared_ptr<PrivateKey> key(PrivateKey::load_file(get_path("keys/rsa.private")));
+    size_t published = 0;
+
+    bench_timer timer;
+    for(size_t i = 0; i < PUBLISHES; ++i){
+        std::shared_ptr<PublicationRecord> publication(new PublicationRecord());
+        publication->set_reference("PUBLISH" + std::to_string(i));
+
+        if(chain.publish(publication,key) && chain.validate_from(chain.get_validated())){
+            published++;
+        }
+    }
+    t_result.seconds = timer.elapsed();
+    t_result.iterations = published;
+
+    // what each publish used to cost on top of mining and signing
+    bench_timer full;
+    chain.is_valid();
+    t_result.metrics["full_check_seconds"] = full.elapsed();
+}
+
+static void trust_with( bench_result& t_result, size_t t_size ){
+    difficulty_guard guard;
+    Blockchain& chain = synthetic_chain(t_size,t_result);
+
+    bench_timer timer;
+    chain.update_trust();
+    t_result.seconds = timer.elapsed();
+    t_result.iterations = chain.size();
+}
+
+static void find_record_with( bench_result& t_result, size_t t_size ){
+    difficulty_guard guard;
+    Blockchain& chain = synthetic_chain(t_size,t_result);
+
+    std::vector<std::string> hashes;
+    for(auto& record : sample(chain,RecordType::Signature)){
+        hashes.push_back(record->hash());
+    }
+
+    size_t found = 0;
+
+    bench_timer timer;
+    for(auto& hash : hashes){
+        found += (chain.find_record(hash) != nullptr);
+    }
+    t_result.seconds = timer.elapsed();
+    t_result.iterations = hashes.size();
+
+    t_result.metrics["found"] = found;
+}
+
+static void find_publication_with( bench_result& t_result, size_t t_size ){
+    difficulty_guard guard;
+    Blockchain& chain = synthetic_chain(t_size,t_result);
+
+    std::vector<std::string> references;
+    for(auto& record : sample(chain,RecordType::Publication)){
+        references.push_back(std::dynamic_pointer_cast<PublicationRecord>(record)->get_reference());
+    }
+
+    size_t found = 0;
+
+    bench_timer timer;
+    for(auto& reference : references){
+        found += (chain.find_publication(reference) != nullptr);
+    }
+    t_result.seconds = timer.elapsed();
+    t_result.iterations = references.size();
+
+    t_result.metrics["found"] = found;
+}
+
+static void find_signatures_with( bench_result& t_result, size_t t_size ){
+    difficulty_guard guard;
+    Blockchain& chain = synthetic_chain(t_size,t_result);
+
+    std::vector<std::string> references;
+    for(auto& record : sample(chain,RecordType::Publication)){
+        references.push_back(std::dynamic_pointer_cast<PublicationRecord>(record)->get_reference());
+    }
+
+    size_t found = 0;
+
+    bench_timer timer;
+    for(auto& reference : references){
+        found += chain.find_signatures(reference).size();
+    }
+    t_result.seconds = timer.elapsed();
+    t_result.iterations = references.size();
+
+    t_result.metrics["found"] = found;
+}
+
+bench_set blockchain_benches("blockchain",{
+
+    {"publish and sync a burst from 1 writer",[]( bench_result& result ){ burst_with(result,1); }},
+    {"publish and sync a burst from 8 writers",[]( bench_result& result ){ burst_with(result,8); }},
+
+    {"save a chain of 1k records",[]( bench_result& result ){ save_with(result,1000); }},
+    {"load a chain of 1k records",[]( bench_result& result ){ load_with(result,1000); }},
+    {"save a binary chain of 1k records",[]( bench_result& result ){ save_with(result,1000,FileFormat::BinaryFile); }},
+    {"load a binary chain of 1k records",[]( bench_result& result ){ load_with(result,1000,FileFormat::BinaryFile); }},
+    {"append records to segments of 1k records",[]( bench_result& result ){ append_with(result,1000); }},
+    {"open segments of 1k records",[]( bench_result& result ){ open_with(result,1000,false); }},
+    {"open mapped segments of 1k records",[]( bench_result& result ){ open_with(result,1000,true); }},
+    {"resume from a snapshot of 1k records",[]( bench_result& result ){ resume_with(result,1000); }},
+    {"open compressed segments of 1k records",[]( bench_result& result ){ compress_with(result,1000); }},
+    {"validate a chain of 1k records",[]( bench_result& result ){ validate_with(result,1000); }},
+    {"validate a chain of 1k records with verified signatures",[]( bench_result& result ){ verified_with(result,1000); }},
+    {"publish and validate on a chain of 1k records",[]( bench_result& result ){ publish_with(result,1000); }},
+    {"update trust over 1k records",[]( bench_result& result ){ trust_with(result,1000); }},
+    {"find records by hash in 1k records",[]( bench_result& result ){ find_record_with(result,1000); }},
+    {"find publications by reference in 1k records",[]( bench_result& result ){ find_publication_with(result,1000); }},
+    {"find signatures by reference in 1k records",[]( bench_result& result ){ find_signatures_with(result,1000); }},
+
+    {"save a chain of 10k records",[]( bench_result& result ){ save_with(result,10000); }},
+    {"load a chain of 10k records",[]( bench_result& result ){ load_with(result,10000); }},
+    {"save a binary chain of 10k records",[]( bench_result& result ){ save_with(result,10000,FileFormat::BinaryFile); }},
+    {"load a binary chain of 10k records",[]( bench_result& result ){ load_with(result,10000,FileFormat::BinaryFile); }},
+    {"append records to segments of 10k records",[]( bench_result& result ){ append_with(result,10000); }},
+    {"open segments of 10k records",[]( bench_result& result ){ open_with(result,10000,false); }},
+    {"open mapped segments of 10k records",[]( bench_result& result ){ open_with(result,10000,true); }},
+    {"resume from a snapshot of 10k records",[]( bench_result& result ){ resume_with(result,10000); }},
+    {"open compressed segments of 10k records",[]( bench_result& result ){ compress_with(result,10000); }},
+    {"validate a chain of 10k records",[]( bench_result& result ){ validate_with(result,10000); }},
+    {"validate a chain of 10k records with verified signatures",[]( bench_result& result ){ verified_with(result,10000); }},
+    {"publish and validate on a chain of 10k records",[]( bench_result& result ){ publish_with(result,10000); }},
+    {"update trust over 10k records",[]( bench_result& result ){ trust_with(result,10000); }},
+    {"find records by hash in 10k records",[]( bench_result& result ){ find_record_with(result,10000); }},
+    {"find publications by reference in 10k records",[]( bench_result& result ){ find_publication_with(result,10000); }},
+    {"find signatures by reference in 10k records",[]( bench_result& result ){ find_signatures_with(result,10000); }},
+
+    {"save a chain of 100k records",[]( bench_result& result ){ save_with(result,100000); }},
+    {"load a chain of 100k records",[]( bench_result& result ){ load_with(result,100000); }},
+    {"save a binary chain of 100k records",[]( bench_result& result ){ save_with(result,100000,FileFormat::BinaryFile); }},
+    {"load a binary chain of 100k records",[]( bench_result& result ){ load_with(result,100000,FileFormat::BinaryFile); }},
+    {"append records to segments of 100k records",[]( bench_result& result ){ append_with(result,100000); }},
+    {"open segments of 100k records",[]( bench_result& result ){ open_with(result,100000,false); }},
+    {"open mapped segments of 100k records",[]( bench_result& result ){ open_with(result,100000,true); }},
+    {"resume from a snapshot of 100k records",[]( bench_result& result ){ resume_with(result,100000); }},
+    {"open compressed segments of 100k records",[]( bench_result& result ){ compress_with(result,100000); }},
+    {"validate a chain of 100k records",[]( bench_result& result ){ validate_with(result,100000); }},
+    {"validate a chain of 100k records with verified signatures",[]( bench_result& result ){ verified_with(result,100000); }},
+    {"publish and validate on a chain of 100k records",[]( bench_result& result ){ publish_with(result,100000); }},
+    {"update trust over 100k records",[]( bench_result& result ){ trust_with(result,100000); }},
+    {"find records by hash in 100k records",[]( bench_result& result ){ find_record_with(result,100000); }},
+    {"find publications by reference in 100k records",[]( bench_result& result ){ find_publication_with(result,100000); }},
+    {"find signatures by reference in 100k records",[]( bench_result& result ){ find_signatures_with(result,100000); }},
+
+});
@@ -0,0 +1,104 @@
+#include <sstream>
+#include "bench-framework.hpp"
+
+using namespace std::chrono;
+
+std::vector<bench_set*>& bench_set::all_bench_sets(){
+    static std::vector<bench_set*> sets;
+    return sets;
+}
+
+bench_timer::bench_timer() : start(steady_clock::now()) {}
+
+double bench_timer::elapsed(){
+    return duration_cast<duration<double>>(steady_clock::now() - start).count();
+}
+
+bench_set::bench_set( std::string t_name, std::vector<bench_case> t_cases ){
+    name = t_name;
+    benches = t_cases;
+
+    bench_set::all_bench_sets().push_back(this);
+}
+
+void bench_set::run( std::vector<bench_result>& t_results ){
+
+    for(auto& bench : benches){
+
+        bench_result result = { name, bench.name, 0, 0, {} };
+        std::cerr << "running: " << name << " -> " << bench.name << std::endl;
+
+        try {
+            bench.run(result);
+        }
+        catch(const std::exception& e){
+            std::cerr << "   failed: " << e.what() << std::endl;
+            continue;
+        }
+
+        // every result reports a rate if it has a duration
+        if(result.seconds > 0 && result.iterations > 0){
+            result.metrics["per_second"] = result.iterations/result.seconds;
+        }
+
+        t_results.push_back(result);
+    }
+
+}
+
+void bench_framework::run(){
+    for(auto set : bench_set::all_bench_sets()){
+        set->run(results);
+    }
+}
+
+void bench_framework::report( std::ostream& t_out ){
+
+    t_out << "{\n  \"version\": \"" << json_escape(RECHAIN_VERSION) << "\",\n";
+    t_out << "  \"results\": [";
+
+    for(size_t i = 0; i < results.size(); ++i){
+        auto& result = results[i];
+
+        t_out << ((i == 0) ? "\n" : ",\n");
+        t_out << "    {\"set\": \"" << json_escape(result.set) << "\", "
+              << "\"name\": \"" << json_escape(result.name) << "\", "
+              << "\"iterations\": " << result.iterations << ", "
+              << "\"seconds\": " << result.seconds;
+
+        for(auto& metric : result.metrics){
+            t_out << ", \"" << json_escape(metric.first) << "\": " << metric.second;
+        }
+
+        t_out << "}";
+    }
+
+    t_out << "\n  ]\n}" << std::endl;
+}
+
+// ------------------------------------------------------------------
+// FUNCTIONS
+// ------------------------------------------------------------------
+std::string get_path( std::string partial ){
+    std::string path = TEST_ROOT;
+
+    if(!path.empty() && path.back() == '/') path.pop_back();
+    if(!partial.empty() && partial.front() == '/') partial.erase(0,1);
+
+    return path + "/" + partial;
+}
+
+std::string json_escape( std::string s ){
+    std::string result;
+
+    for(auto c : s){
+        switch(c){
+            case '"':  result.append("\\\""); break;
+            case '\\': result.append("\\\\"); break;
+            case '\n': result.append("\\n");  break;
+            default:   result.push_back(c);   break;
+        }
+    }
+
+    return result;
+}
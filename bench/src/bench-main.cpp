@@ -0,0 +1,27 @@
+#include <iostream>
+#include <fstream>
+
+#include "bench-framework.hpp"
+
+#ifndef TEST_ROOT
+    static_assert(0,"TEST_ROOT isn't set!");
+#endif
+
+int main( int argc, char** argv ){
+
+    // no logs are configured, so logging
+    // stays out of the timings
+    bench_framework bf;
+    bf.run();
+
+    // write json to a file if one is given, stdout otherwise
+    if(argc > 1){
+        std::ofstream ofs(argv[1]);
+        bf.report(ofs);
+    }
+    else {
+        bf.report(std::cout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <climits>
+
+#include <cryptopp/filters.h>
+#include <cryptopp/hex.h>
+#include <cryptopp/sha.h>
+#include <cryptopp/osrng.h>
+#include <cryptopp/integer.h>
+
+#include "bench-framework.hpp"
+
+#include "miner.hpp"
+#include "lane_hasher.hpp"
+#include "publication_record.hpp"
+#include "keys.hpp"
+
+static void mine_with( bench_result& t_result, size_t t_threads ){
+
+    std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+    Miner miner(t_threads);
+
+    uint64_t attempts = 0;
+    double seconds = 0;
+
+    for(int i = 0; i < 3; ++i){
+        std::shared_ptr<PublicationRecord> record(new PublicationRecord());
+        record->set_reference(std::to_string(i));
+
+        private_key->sign(record);
+        miner.mine(record);
+
+        for(auto& count : miner.get_attempts()){
+            attempts += count;
+        }
+
+        seconds += miner.get_seconds();
+    }
+
+    t_result.iterations = attempts;
+    t_result.seconds    = seconds;
+
+    t_result.metrics["threads"] = miner.get_threads();
+    t_result.metrics["difficulty"] = BaseRecord::get_difficulty();
+    t_result.metrics["hashes_per_second_per_thread"] = (attempts/seconds)/miner.get_threads();
+}
+
+static std::shared_ptr<PublicationRecord> signed_record(){
+
+    std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+    std::shared_ptr<PublicationRecord> record(new PublicationRecord());
+    record->set_reference("BED278D778BE345238760E7090AF97A569769DE324EB9748A41636A569B3C0BF");
+
+    private_key->sign(record);
+    return record;
+}
+
+static void lanes_with( bench_result& t_result, LaneHasher::Backend t_backend ){
+
+    LaneHasher::Backend backend = LaneHasher::get_backend();
+
+    t_result.metrics["supported"] = LaneHasher::set_backend(t_backend);
+    t_result.metrics["lanes"] = LaneHasher::get_lanes();
+
+    auto record = signed_record();
+    MidState state(record.get());
+
+    std::vector<uint32_t> counters(LaneHasher::get_lanes());
+    std::vector<unsigned char> digests(counters.size() * DIGEST_SIZE);
+
+    bench_timer timer;
+    for(t_result.iterations = 0; t_result.iterations < 20000; t_result.iterations += counters.size()){
+        for(size_t i = 0; i < counters.size(); ++i){
+            counters[i] = (uint32_t)(t_result.iterations + i);
+        }
+        state.digest(1,1,counters,digests.data());
+    }
+    t_result.seconds = timer.elapsed();
+
+    LaneHasher::set_backend(backend);
+}
+
+static std::vector< std::shared_ptr<BaseRecord> > signed_records( size_t t_count ){
+
+    std::vector< std::shared_ptr<BaseRecord> > records;
+    auto record = signed_record();
+
+    for(size_t i = 0; i < t_count; ++i){
+        auto copy = record->clone();
+        copy->set_previous(std::to_string(i));
+        records.push_back(copy);
+    }
+
+    return records;
+}
+
+bench_set mining_benches("mining",{
+
+    {"hash attempt by re-serializing the record",[]( bench_result& result ){
+
+        auto record = signed_record();
+
+        bench_timer timer;
+        for(result.iterations = 0; result.iterations < 20000; ++result.iterations){
+            std::string data = record->to_string();
+            std::string hash;
+
+            CryptoPP::SHA256 hasher;
+            CryptoPP::StringSource ss(data,true,
+                new CryptoPP::HashFilter(hasher,
+                    new CryptoPP::HexEncoder(
+                        new CryptoPP::StringSink(hash))));
+        }
+        result.seconds = timer.elapsed();
+    }},
+
+    {"legacy attempt with a new entropy pool and clock read",[]( bench_result& result ){
+
+        // the loop BaseRecord::mine used to run, kept as a reference
+        auto record = signed_record();
+
+        bench_timer timer;
+        for(result.iterations = 0; result.iterations < 2000; ++result.iterations){
+            CryptoPP::AutoSeededRandomPool rng;
+            long nonce = CryptoPP::Integer(rng,
+                CryptoPP::Integer(1),
+                CryptoPP::Integer(LONG_MAX)).ConvertToLong();
+
+            auto e = std::chrono::system_clock::now().time_since_epoch();
+            long timestamp = (long)std::chrono::duration_cast<std::chrono::seconds>(e).count();
+
+            std::string data = record->to_string();
+            std::string hash;
+
+            CryptoPP::SHA256 hasher;
+            CryptoPP::StringSource ss(data,true,
+                new CryptoPP::HashFilter(hasher,
+                    new CryptoPP::HexEncoder(
+                        new CryptoPP::StringSink(hash))));
+
+            (void)nonce;
+            (void)timestamp;
+        }
+        result.seconds = timer.elapsed();
+    }},
+
+    {"hash attempt from a midstate",[]( bench_result& result ){
+
+        auto record = signed_record();
+        MidState state(record.get());
+
+        bench_timer timer;
+        for(result.iterations = 0; result.iterations < 20000; ++result.iterations){
+            state.hash(1,1,(uint32_t)result.iterations);
+        }
+        result.seconds = timer.elapsed();
+    }},
+
+    {"hash attempts from a midstate with scalar lanes",[]( bench_result& result ){
+        lanes_with(result,LaneHasher::Backend::Scalar);
+    }},
+
+    {"hash attempts from a midstate with avx2 lanes",[]( bench_result& result ){
+        lanes_with(result,LaneHasher::Backend::AVX2);
+    }},
+
+    {"hash attempts from a midstate with avx512 lanes",[]( bench_result& result ){
+        lanes_with(result,LaneHasher::Backend::AVX512);
+    }},
+
+    {"hash 1000 records one at a time",[]( bench_result& result ){
+
+        auto records = signed_records(1000);
+
+        bench_timer timer;
+        for(auto& record : records){
+            record->hash();
+        }
+        result.seconds = timer.elapsed();
+        result.iterations = records.size();
+    }},
+
+    {"hash 1000 records in a batch",[]( bench_result& result ){
+
+        auto records = signed_records(1000);
+
+        bench_timer timer;
+        BaseRecord::hash_batch(records);
+        result.seconds = timer.elapsed();
+        result.iterations = records.size();
+
+        result.metrics["lanes"] = LaneHasher::get_lanes();
+    }},
+
+    {"mine with one thread",[]( bench_result& result ){
+        mine_with(result,1);
+    }},
+
+    {"mine with one thread per core",[]( bench_result& result ){
+        mine_with(result,0);
+    }},
+
+    {"mine at 8 bits",[]( bench_result& result ){
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(8);
+        mine_with(result,0);
+        BaseRecord::set_difficulty(difficulty);
+        result.metrics["difficulty"] = 8;
+    }},
+
+    {"mine at 12 bits",[]( bench_result& result ){
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(12);
+        mine_with(result,0);
+        BaseRecord::set_difficulty(difficulty);
+        result.metrics["difficulty"] = 12;
+    }},
+
+    {"mine at 16 bits",[]( bench_result& result ){
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(16);
+        mine_with(result,0);
+        BaseRecord::set_difficulty(difficulty);
+        result.metrics["difficulty"] = 16;
+    }},
+
+});
@@ -0,0 +1,285 @@
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "bench-framework.hpp"
+
+#include "genesis_record.hpp"
+#include "publication_record.hpp"
+#include "signature_record.hpp"
+#include "keys.hpp"
+#include "key_cache.hpp"
+#include "validator.hpp"
+
+static std::shared_ptr<BaseRecord> signed_record( RecordType t_type ){
+
+    std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+    std::shared_ptr<BaseRecord> record;
+
+    switch(t_type){
+        case RecordType::Genesis: {
+            std::shared_ptr<GenesisRecord> genesis(new GenesisRecord());
+            genesis->set_distribution({
+                std::shared_ptr<PublicKey>(PublicKey::load_file(get_path("keys/rsa.public")))->to_string(),
+                std::shared_ptr<PublicKey>(PublicKey::load_file(get_path("keys/user1.public")))->to_string()
+            });
+            record = genesis;
+            break;
+        }
+        case RecordType::Publication: {
+            std::shared_ptr<PublicationRecord> publication(new PublicationRecord());
+            publication->set_reference("BED278D778BE345238760E7090AF97A569769DE324EB9748A41636A569B3C0BF");
+            record = publication;
+            break;
+        }
+        default:
+            record.reset(new SignatureRecord("BED278D778BE345238760E7090AF97A569769DE324EB9748A41636A569B3C0BF"));
+            break;
+    }
+
+    private_key->sign(record);
+    return record;
+}
+
+static void hash_with( bench_result& t_result, RecordType t_type, HashFormat t_format = HashFormat::Binary ){
+
+    auto record = signed_record(t_type);
+    std::string previous = record->get_previous();
+
+    record->set_format(t_format);
+
+    bench_timer timer;
+    for(t_result.iterations = 0; t_result.iterations < 20000; ++t_result.iterations){
+        // setting a field drops the cached digest
+        record->set_previous(previous);
+        record->hash();
+    }
+    t_result.seconds = timer.elapsed();
+
+    t_result.metrics["bytes"] = record->encode().size();
+}
+
+static void encode_with( bench_result& t_result, HashFormat t_format ){
+
+    auto record = signed_record(RecordType::Publication);
+    record->set_format(t_format);
+
+    size_t bytes = 0;
+
+    bench_timer timer;
+    for(t_result.iterations = 0; t_result.iterations < 20000; ++t_result.iterations){
+        bytes += record->encode().size();
+    }
+    t_result.seconds = timer.elapsed();
+
+    t_result.metrics["bytes"] = bytes/t_result.iterations;
+}
+
+// keygen, signing and verifying with a new key of one type, and
+// the size of the records it signs
+static void scheme_with( bench_result& t_result, KeyType t_type ){
+
+    const size_t KEYS = 4;
+    const size_t SIGNS = 200;
+
+    std::shared_ptr<PrivateKey> private_key(PrivateKey::empty());
+
+    bench_timer keygen;
+    for(size_t i = 0; i < KEYS; ++i){
+        private_key->generate(t_type);
+    }
+    t_result.metrics["keygen_seconds"] = keygen.elapsed() / KEYS;
+
+    std::shared_ptr<PublicKey> public_key(private_key->get_public());
+    std::shared_ptr<PublicationRecord> record(new PublicationRecord());
+    record->set_reference("BED278D778BE345238760E7090AF97A569769DE324EB9748A41636A569B3C0BF");
+
+    bench_timer signing;
+    for(size_t i = 0; i < SIGNS; ++i){
+        private_key->sign(record);
+    }
+    t_result.metrics["signs_per_second"] = SIGNS / signing.elapsed();
+
+    public_key->prepare();
+    bool valid = true;
+
+    bench_timer timer;
+    for(t_result.iterations = 0; t_result.iterations < 2000; ++t_result.iterations){
+        valid &= public_key->verify(record.get());
+    }
+    t_result.seconds = timer.elapsed();
+
+    t_result.metrics["valid"] = valid;
+    t_result.metrics["public_key_chars"] = record->get_public_key().size();
+    t_result.metrics["signature_chars"] = record->get_signature().size();
+    t_result.metrics["bytes"] = record->encode().size();
+}
+
+bench_set record_benches("records",{
+
+    {"hash a genesis record",[]( bench_result& result ){
+        hash_with(result,RecordType::Genesis);
+    }},
+
+    {"hash a publication record",[]( bench_result& result ){
+        hash_with(result,RecordType::Publication);
+    }},
+
+    {"hash a signature record",[]( bench_result& result ){
+        hash_with(result,RecordType::Signature);
+    }},
+
+    {"hash a publication record in the text format",[]( bench_result& result ){
+        hash_with(result,RecordType::Publication,HashFormat::Text);
+    }},
+
+    {"encode a publication record in the text format",[]( bench_result& result ){
+        encode_with(result,HashFormat::Text);
+    }},
+
+    {"encode a publication record in the binary format",[]( bench_result& result ){
+        encode_with(result,HashFormat::Binary);
+    }},
+
+    {"sign a publication record",[]( bench_result& result ){
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+        std::shared_ptr<PublicationRecord> record(new PublicationRecord());
+        record->set_reference("BED278D778BE345238760E7090AF97A569769DE324EB9748A41636A569B3C0BF");
+
+        bench_timer timer;
+        for(result.iterations = 0; result.iterations < 200; ++result.iterations){
+            private_key->sign(record);
+        }
+        result.seconds = timer.elapsed();
+    }},
+
+    {"sign a batch of publication records",[]( bench_result& result ){
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+        const size_t RECORDS = 400;
+
+        std::vector< std::shared_ptr<BaseRecord> > records;
+        for(size_t i = 0; i < RECORDS; ++i){
+            std::shared_ptr<PublicationRecord> record(new PublicationRecord());
+            record->set_reference("BATCH" + std::to_string(i));
+            records.push_back(record);
+        }
+
+        // a key without a context builds one for every record, the
+        // way each sign used to derive its public key and signer
+        bench_timer fresh;
+        for(size_t i = 0; i < RECORDS / 4; ++i){
+            std::shared_ptr<PrivateKey> key(PrivateKey::empty());
+            key->set_key(private_key->get_key());
+            key->sign(records[i]);
+        }
+        result.metrics["fresh_signs_per_second"] = (RECORDS / 4) / fresh.elapsed();
+
+        bench_timer single;
+        for(auto& record : records){
+            private_key->sign(record);
+        }
+        result.metrics["one_thread_signs_per_second"] = RECORDS / single.elapsed();
+
+        bench_timer timer;
+        private_key->sign(records);
+        result.seconds = timer.elapsed();
+        result.iterations = RECORDS;
+
+        result.metrics["threads"] = std::thread::hardware_concurrency();
+    }},
+
+    {"verify a publication record",[]( bench_result& result ){
+
+        std::shared_ptr<PublicKey> public_key(PublicKey::load_file(get_path("keys/rsa.public")));
+        auto record = signed_record(RecordType::Publication);
+
+        bool valid = true;
+
+        bench_timer timer;
+        for(result.iterations = 0; result.iterations < 2000; ++result.iterations){
+            valid &= public_key->verify(record.get());
+        }
+        result.seconds = timer.elapsed();
+
+        result.metrics["valid"] = valid;
+    }},
+
+    {"sign and verify with a new RSA key",[]( bench_result& result ){
+        scheme_with(result,KeyType::RSAKey);
+    }},
+
+    {"sign and verify with a new Ed25519 key",[]( bench_result& result ){
+        scheme_with(result,KeyType::Ed25519Key);
+    }},
+
+    {"turn away publication records that aren't mined",[]( bench_result& result ){
+
+        auto record = signed_record(RecordType::Publication);
+        std::string previous = record->get_previous();
+
+        // no record meets this, so every check stops at the work
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(64);
+
+        const size_t CHECKS = 2000;
+
+        // the order checks used to run in, signature first
+        bench_timer first;
+        for(size_t i = 0; i < CHECKS; ++i){
+            record->set_previous(previous);
+            KeyCache::get(record->get_public_key())->verify(record.get()) && record->is_mined();
+        }
+        result.metrics["signature_first_per_second"] = CHECKS / first.elapsed();
+
+        Validator::reset();
+
+        bench_timer timer;
+        for(result.iterations = 0; result.iterations < CHECKS * 10; ++result.iterations){
+            // setting a field drops the cached digest
+            record->set_previous(previous);
+            Validator::check(record.get());
+        }
+        result.seconds = timer.elapsed();
+
+        result.metrics["rejected_at_work"] = Validator::get_rejected(Validator::Work);
+
+        BaseRecord::set_difficulty(difficulty);
+    }},
+
+    {"check a publication record with cached keys",[]( bench_result& result ){
+
+        auto record = signed_record(RecordType::Publication);
+        const size_t CHECKS = 2000;
+
+        // the record isn't mined, so the work is left out to reach the key
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(0);
+
+        // every check parses and validates the key
+        size_t capacity = KeyCache::get_capacity();
+        KeyCache::set_capacity(0);
+
+        bench_timer uncached;
+        for(size_t i = 0; i < CHECKS; ++i){
+            record->is_valid();
+        }
+        result.metrics["uncached_seconds"] = uncached.elapsed();
+
+        KeyCache::set_capacity(capacity);
+        KeyCache::clear();
+
+        bench_timer timer;
+        for(result.iterations = 0; result.iterations < CHECKS; ++result.iterations){
+            record->is_valid();
+        }
+        result.seconds = timer.elapsed();
+
+        result.metrics["hits"] = KeyCache::get_hits();
+        result.metrics["misses"] = KeyCache::get_misses();
+
+        BaseRecord::set_difficulty(difficulty);
+    }},
+
+});
@@ -28,6 +28,10 @@
 
 // system includes
 #include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
 
 // dependency includes
 #include <boost/serialization/string.hpp>
@@ -37,19 +41,33 @@
 // local includes
 #include "enums.hpp"
 
-/* Maximum hash value (smaller increases difficulty) */
+namespace cereal {
+    class PortableBinaryOutputArchive;
+    class PortableBinaryInputArchive;
+}
+
+/* Default difficulty (larger increases difficulty) */
 #ifndef NDEBUG
 
-    /** The maximum size of a mined hash */
-    #define HASH_MAX "000FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF"
+    /** The default number of leading zero bits in a mined hash */
+    #define DEFAULT_DIFFICULTY 12
 
 #else
 
-    /** The maximum size of a hash for release */
-    #define HASH_MAX "0000FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF"
+    /** The default number of leading zero bits in a mined hash for release */
+    #define DEFAULT_DIFFICULTY 16
 
 #endif
 
+/** The size of a raw SHA256 digest in bytes */
+#define DIGEST_SIZE 32
+
+/** The most hex characters in a public key (RSA keys up to 4096 bits) */
+#define MAX_KEY_SIZE 2048
+
+/** The most hex characters in a signature (RSA keys up to 4096 bits) */
+#define MAX_SIGNATURE_SIZE 1024
+
 /** \brief The BaseRecord class acts as an abstract base class
            for other kinds of records.
 */
@@ -60,12 +78,29 @@ class BaseRecord {
         /** Make access a friend for serialization */
         friend class boost::serialization::access;
 
+        /** Make Miner a friend so workers can update hashing variables */
+        friend class Miner;
+
+        /** Make MiningServer a friend so remote solutions can be written back */
+        friend class MiningServer;
+
+        /** The number of leading zero bits a mined hash must have */
+        static std::atomic<unsigned int> s_difficulty;
+
         /** \brief Serialize BaseRecord to an archive
             \param t_archive The archive to serialize to
             \param int The version of the serialize record
         */
         template <class Archive>
         void serialize( Archive& t_archive, const unsigned int /* version */ ){
+            if(Archive::is_loading::value){
+                materialize();
+                invalidate();
+            }
+            else {
+                decode();
+            }
+
             t_archive & m_previous;
             t_archive & m_public_key;
             t_archive & m_signature;
@@ -79,6 +114,9 @@ class BaseRecord {
         /** The type of record */
         RecordType m_type;
 
+        /** The encoding the record is hashed in */
+        HashFormat m_format;
+
         // data variables
         std::string m_public_key;         /**< The public key of the owner */
         std::string m_signature;		  /**< The signature */
@@ -89,6 +127,75 @@ class BaseRecord {
         long m_timestamp;			      /**< A timestamp */
         uint32_t m_counter;               /**< Counter to modify hash output */
 
+        // cached hashing results
+        std::string m_digest;             /**< The cached raw digest (empty if stale) */
+        std::string m_hash;               /**< The cached hex encoded digest (empty if stale) */
+
+        // an encoded record in a mapped segment
+        std::shared_ptr<const char> m_source;   /**< The encoded fields (null if the record isn't a view) */
+        size_t m_source_size;                   /**< The length of the encoded fields */
+        uint32_t m_source_crc;                  /**< The crc32 of the encoded fields */
+        bool m_decoded;                         /**< True if the fields are in memory */
+
+        /** \brief Clear the cached digest and hash. Called whenever
+                   a value that is hashed is changed.
+        */
+        void invalidate(){ m_digest.clear(); m_hash.clear(); }
+
+        /** \brief Decode the fields of a view the first time they're used
+        */
+        void decode(){ if(!m_decoded){ decode_source(); } }
+
+        /** \brief Decode the fields of a view and stop being a view,
+                   because a field is about to change
+        */
+        void materialize(){ decode(); m_source.reset(); }
+
+        /** \brief Read the fields from m_source, checking the crc32
+        */
+        void decode_source();
+
+        /** \brief Clear the fields of a record type when a view is released
+        */
+        virtual void release_fields(){}
+
+        /** \brief Append a little-endian integer to a binary encoding
+            \param t_out The encoding to append to
+            \param t_value The integer to append
+            \param t_bytes The number of bytes to append
+        */
+        static void encode_integer( std::string& t_out, uint64_t t_value, size_t t_bytes );
+
+        /** \brief Append a length-prefixed string to a binary encoding
+            \param t_out The encoding to append to
+            \param t_value The string to append
+        */
+        static void encode_string( std::string& t_out, const std::string& t_value );
+
+        /** \brief Append a hex encoded digest to a binary encoding as
+                   its raw 32 bytes, or as a string if it isn't one
+            \param t_out The encoding to append to
+            \param t_value The hex encoded digest to append
+        */
+        static void encode_digest( std::string& t_out, const std::string& t_value );
+
+        /** \brief Write a string to a binary chain file, as raw bytes if it's hex
+            \param t_archive The archive to write to
+            \param t_value The string to write
+        */
+        static void save_hex( cereal::PortableBinaryOutputArchive& t_archive, const std::string& t_value );
+
+        /** \brief Read a string written by save_hex
+            \param t_archive The archive to read from
+            \param t_value Set to the string that was written
+        */
+        static void load_hex( cereal::PortableBinaryInputArchive& t_archive, std::string& t_value );
+
+        /** \brief Append the fields of a record type to its binary encoding
+            \param t_out The encoding to append to
+        */
+        virtual void encode_fields( std::string& /* t_out */ ){}
+
 
 	public:
 
@@ -98,26 +205,162 @@ class BaseRecord {
         /** \brief Empty destructor */
         virtual ~BaseRecord(){};
 
-        /** Get the hash of this BaseRecord
+        /** \brief Create an empty record of a given type
+            \param t_type The type of record to create
+            \returns The new record, or null for an unknown type
+        */
+        static std::shared_ptr<BaseRecord> create( RecordType t_type );
+
+        /** \brief Make the record a view over encoded bytes, such as a
+                   record in a mapped segment. The fields are decoded the
+                   first time they're used, and the record stops being a
+                   view when one of them is changed. Like the cached hash,
+                   decoding isn't thread safe.
+            \param t_source The bytes written by save_binary, after a
+                            portable binary archive header and the type
+            \param t_size The length of the bytes
+            \param t_crc The crc32 of the bytes
+        */
+        void set_source( std::shared_ptr<const char> t_source, size_t t_size, uint32_t t_crc );
+
+        /** \brief Check if the fields of the record are in memory
+            \returns False if the record is a view that hasn't been decoded
+        */
+        bool is_decoded(){ return m_decoded; }
+
+        /** \brief Drop the decoded fields of a view that hasn't changed,
+                   keeping the cached hash. Does nothing to other records.
+        */
+        void release();
+
+        /** Get the hash of this BaseRecord. The hash is cached
+            until a hashed value changes.
             \returns The current hash of the BaseRecord
         */
         std::string hash();
 
-        /** \brief Re-hash until the hash is valid
+        /** Get the raw SHA256 digest of this BaseRecord. The digest
+            is cached until a hashed value changes.
+            \returns The DIGEST_SIZE bytes of the current digest
+        */
+        std::string digest();
+
+        /** \brief Fill the cached digests of several records at once
+                   using the LaneHasher. Records that already have a
+                   cached digest are skipped.
+            \param t_records The records to hash
+        */
+        static void hash_batch( const std::vector< std::shared_ptr<BaseRecord> >& t_records );
+
+        /** \brief Check if the current hash meets the difficulty
+            \returns True if the BaseRecord has been mined
+        */
+        bool is_mined();
+
+        /** \brief Check if the current hash meets a given difficulty
+            \param t_bits The number of leading zero bits it must have
+            \returns True if the BaseRecord has been mined to t_bits
+        */
+        bool is_mined( unsigned int t_bits );
+
+        /** \brief Set the difficulty that records are mined and validated at
+            \param t_bits The number of leading zero bits a hash must have
+        */
+        static void set_difficulty( unsigned int t_bits );
+
+        /** \brief Get the difficulty that records are mined and validated at
+            \returns The number of leading zero bits a hash must have
+        */
+        static unsigned int get_difficulty();
+
+        /** \brief Check a raw digest against a difficulty
+            \param t_digest The DIGEST_SIZE bytes of a digest
+            \param t_bits The number of leading zero bits it must have
+            \returns True if the digest has at least t_bits leading zero bits
+        */
+        static bool meets_difficulty( const unsigned char* t_digest, unsigned int t_bits );
+
+        /** \brief Get the bytes that are hashed, in the format of the record
+            \returns The text archive or the binary encoding of the record
+        */
+        std::string encode();
+
+        /** \brief Get the canonical binary encoding of the record. Fields
+                   are length-prefixed, integers are little-endian and
+                   digests are raw, with the hashing variables last.
+            \returns The binary encoding of the record
+        */
+        std::string encode_binary();
+
+        /** \brief Get the encoding the record is hashed in
+            \returns The HashFormat of the record
+        */
+        HashFormat get_format(){ decode(); return m_format; }
+
+        /** \brief Set the encoding the record is hashed in
+            \param t_format The HashFormat to use
+        */
+        void set_format( HashFormat t_format ){ materialize(); m_format = t_format; invalidate(); }
+
+        /** \brief Split the encoded Record around the hashing
+                   variables so that the data before them can be
+                   hashed once and reused while mining.
+            \param t_prefix Set to the serialized data before the nonce
+            \param t_suffix Set to the serialized data after the counter
+            \returns True if the Record could be split
+        */
+        bool split( std::string& t_prefix, std::string& t_suffix );
+
+        /** \brief Serialize the hashing variables the same way that
+                   encode does, to be placed between the prefix
+                   and suffix given by split.
+            \param t_nonce The nonce to serialize
+            \param t_timestamp The timestamp to serialize
+            \param t_counter The counter to serialize
+            \param t_format The encoding to serialize them in
+            \returns The serialized hashing variables
+        */
+        static std::string hashing_data( long t_nonce, long t_timestamp, uint32_t t_counter, HashFormat t_format );
+
+        /** \brief Re-hash until the hash is valid, using
+                   one mining thread per core
             \returns A valid hash
         */
         std::string mine();
 
-        /** \brief Check if BaseRecord is internally valid
+        /** \brief Re-hash until the hash is valid
+            \param t_threads The number of mining threads to use
+            \returns A valid hash
+        */
+        std::string mine( size_t t_threads );
+
+        /** \brief Check if BaseRecord is internally valid, running the
+                   Validator stages without a chain
             \returns True if BaseRecord is valid
         */
         virtual bool is_valid();
 
+        /** \brief Check that the fields are present and not too large,
+                   without hashing or parsing anything
+            \returns True if the record is well formed
+        */
+        virtual bool is_well_formed();
+
         /** \brief Get the concatenated data for hashing/signing
             \returns The data of the record as a string
         */
         virtual std::string get_data();
 
+        /** \brief Write the record to a binary chain file
+            \param t_archive The archive to write to
+        */
+        virtual void save_binary( cereal::PortableBinaryOutputArchive& t_archive );
+
+        /** \brief Read the record from a binary chain file
+            \param t_archive The archive to read from
+        */
+        virtual void load_binary( cereal::PortableBinaryInputArchive& t_archive );
+
         /** \brief Get the RecordType of this Record
             \returns The RecordType of this Record
         */
@@ -128,50 +371,55 @@ class BaseRecord {
         */
         virtual std::string to_string() = 0;
 
+        /** \brief Get a copy of the Record
+            \returns A pointer to the new copy
+        */
+        virtual std::shared_ptr<BaseRecord> clone() = 0;
+
         /** \brief Get the hash of the previous record 
             \returns The hash of the previous record
         */
-        std::string get_previous(){ return m_previous; }
+        std::string get_previous(){ decode(); return m_previous; }
 
         /** \brief Set the hash of the previous record
             \param t_previous The hash to set
         */
-        void set_previous( std::string t_previous ){ m_previous = t_previous; }
+        void set_previous( std::string t_previous ){ materialize(); m_previous = t_previous; invalidate(); }
 
         /** \brief Get the public key
             \returns The value of m_public_key
         */
-        std::string get_public_key(){ return m_public_key; }
+        std::string get_public_key(){ decode(); return m_public_key; }
 
         /** \brief Set the public key
             \param t_key The public key to use
         */
-        void set_public_key( std::string t_key ){ m_public_key = t_key; }
+        void set_public_key( std::string t_key ){ materialize(); m_public_key = t_key; invalidate(); }
 
         /** \brief Get the signature
             \returns The value of m_signature
         */
-        std::string get_signature(){ return m_signature; }
+        std::string get_signature(){ decode(); return m_signature; }
 
         /** \brief Set the signature
             \param t_signature The signature to use
         */
-        void set_signature( std::string t_signature ){ m_signature = t_signature; }
+        void set_signature( std::string t_signature ){ materialize(); m_signature = t_signature; invalidate(); }
 
         /** \brief Get the random number used in hashing
             \returns The nonce
         */
-        long get_nonce(){ return m_nonce; }
+        long get_nonce(){ decode(); return m_nonce; }
 
         /** \brief Get the timestamp of the BaseRecord
             \returns The raw posix timestamp
         */
-        long get_timestamp(){ return m_timestamp; }
+        long get_timestamp(){ decode(); return m_timestamp; }
 
         /** \brief Get the counter used in hashing
             \returns The counter
         */
-        uint32_t get_counter(){ return m_counter; }
+        uint32_t get_counter(){ decode(); return m_counter; }
 
 };
 
@@ -32,10 +32,15 @@
 #include <vector>
 #include <memory>
 #include <map>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
 
 // dependency includes
 #include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
@@ -46,6 +51,9 @@
 #include "publication_record.hpp"
 #include "signature_record.hpp"
 #include "keys.hpp"
+#include "mining_job.hpp"
+#include "segment_store.hpp"
+#include "loader.hpp"
 
 /** The Blockchain class manages a collection of 
     BaseRecord objects.
@@ -65,8 +73,182 @@ class Blockchain {
         /** Minimum trust in the Blockchain */
         double min_trust;
 
-		/** Update the trust_map */	
-		void update_trust();	
+        /** Guards the end of the chain against mining jobs */
+        std::mutex m_mutex;
+
+        /** Mining jobs that may still be running */
+        std::vector< std::weak_ptr<MiningJob> > m_jobs;
+
+        /** Shares mining with remote workers, if set */
+        std::shared_ptr<MiningServer> m_server;
+
+        /** The format the Blockchain is saved in */
+        FileFormat m_format;
+
+        /** Appended records are written here, if it's open */
+        std::shared_ptr<SegmentStore> m_store;
+
+        /** Links publication hashes to the authors that gave them trust */
+        std::map<std::string,std::string> m_authors;
+
+        /** The trust the owners started with */
+        double m_trust_basis;
+
+        /** Trust given to records, which can't be spent */
+        double m_lost_trust;
+
+        /** \brief Lookups into the chain, which are also what the in-order
+                   checks need to know about the records before the next one
+        */
+        struct ChainIndex {
+            std::string previous;                                       /**< The hash of the last record */
+            std::map<std::string,uint64_t> records;                     /**< The position of each record by hash */
+            std::map<std::string,uint64_t> references;                  /**< The first publication with each reference */
+            std::set<std::string> publications;                         /**< The hashes of publications */
+            std::map<std::string,std::vector<uint64_t>> signatures;     /**< The signatures of each publication hash */
+        };
+
+        /** The index of the records in the Blockchain */
+        ChainIndex m_index;
+
+        /** \brief A copy of the state a snapshot is written from, so the
+                   chain can change while the snapshot is written
+        */
+        struct SnapshotState {
+            uint64_t height;                                /**< The number of records */
+            double trust_basis;                             /**< The trust the owners started with */
+            double lost_trust;                              /**< Trust given to records */
+            std::map<std::string,double> trust;             /**< The trust of each author */
+            std::map<std::string,std::string> authors;      /**< The authors of each publication */
+            ChainIndex index;                               /**< The lookups into the chain */
+        };
+
+        /** The path snapshots are written to, if set */
+        std::string m_snapshot;
+
+        /** The number of appended records between snapshots */
+        size_t m_snapshot_interval;
+
+        /** The number of records in the last snapshot written or read */
+        uint64_t m_snapshot_height;
+
+        /** True while a snapshot is written outside the lock */
+        bool m_snapshotting;
+
+        /** Check every record when opening, even if there's a snapshot */
+        bool m_full_check;
+
+        /** Compress sealed segments and snapshots */
+        bool m_compressed;
+
+        /** True while a sync is flushing the open segment */
+        bool m_syncing;
+
+        /** Signalled when a sync finishes */
+        std::condition_variable m_sync_done;
+
+        /** The position of the first record that failed the last check */
+        uint64_t m_invalid;
+
+        /** The number of records at the start of the chain known to be valid */
+        uint64_t m_validated;
+
+        /** \brief Check that a record follows the records before it
+            \param t_record The next record in the chain
+            \param t_index The index of the records before it
+            \returns True if the record links to the chain
+        */
+        bool check_link( std::shared_ptr<BaseRecord> t_record, const ChainIndex& t_index );
+
+        /** \brief Add a record to the end of an index
+            \param t_record The next record in the chain
+            \param t_position The position of the record in the chain
+            \param t_index The index to add it to
+        */
+        void index_record( std::shared_ptr<BaseRecord> t_record, uint64_t t_position, ChainIndex& t_index );
+
+        /** \brief Rebuild the index from the records */
+        void reindex();
+
+        /** \brief Throw std::logic_error if a mining job is still running */
+        void check_idle();
+
+        /** \brief Clear the trust and split it between the owners
+            \param t_genesis The genesis record of the chain
+            \param t_size The number of records in the chain
+        */
+        void begin_trust( std::shared_ptr<GenesisRecord> t_genesis, size_t t_size );
+
+        /** \brief Move trust for the next record in the chain
+            \param t_record The record to add
+        */
+        void add_trust( std::shared_ptr<BaseRecord> t_record );
+
+        /** \brief Update the maximum trust after records were added */
+        void end_trust();
+
+        /** \brief Replace the records with those from a source, checking
+                   them in a Loader and building the trust and index as
+                   they arrive
+            \param t_records Records that were already checked, with the
+                             trust and index for them (or empty)
+            \param t_total The number of records the source has
+            \param t_source The source to read records from
+            \param t_progress Called after each chunk, if set
+            \returns True if every record was read and the chain is valid
+        */
+        bool stream( std::vector< std::shared_ptr<BaseRecord> > t_records, uint64_t t_total, Loader::source_t t_source, Loader::progress_t t_progress );
+
+        /** \brief Copy the trust and index, then write them to the
+                   snapshot path with the lock released. Only one
+                   snapshot is written at a time.
+            \param t_lock The lock on m_mutex, which is held on return
+            \returns True if the snapshot was written
+        */
+        bool save_snapshot( std::unique_lock<std::mutex>& t_lock );
+
+        /** \brief Write a copy of the trust and index to the snapshot path
+            \param t_state The state to write
+            \returns True if the snapshot was written
+        */
+        bool write_snapshot( const SnapshotState& t_state );
+
+        /** \brief Read the trust and index from the snapshot path if the
+                   snapshot is of a prefix of some records
+            \param t_records The records the snapshot has to match
+            \returns The number of records the snapshot covers, or 0 if
+                     there's no snapshot or it doesn't match
+        */
+        uint64_t read_snapshot( const std::vector< std::shared_ptr<BaseRecord> >& t_records );
+
+        /** \brief Write the records after the binary header
+            \param t_stream The stream to write to
+        */
+        void write_binary( std::ostream& t_stream );
+
+        /** \brief Get a source that reads the records written by write_binary
+            \param t_stream The stream to read from, after the magic header
+            \param t_total Set to the number of records in the file
+            \returns The source, or null if the header can't be read
+        */
+        static Loader::source_t binary_source( std::istream& t_stream, uint64_t& t_total );
+
+        /** \brief Read records written by write_binary
+            \param t_stream The stream to read from, after the magic header
+            \returns True if the records were read
+        */
+        bool read_binary( std::istream& t_stream );
+
+        /** \brief Get the hash of the last record
+            \returns The hash of the last record or an empty string
+        */
+        std::string tip();
+
+        /** \brief Append a mined record if it is valid and built on the current tip
+            \param t_record The record to append
+            \returns Appended, Stale if the tip moved or Failed
+        */
+        AppendResult append( std::shared_ptr<BaseRecord> t_record );
 
         /** Make access a friend for serialization */
         friend class boost::serialization::access;
@@ -76,8 +258,28 @@ class Blockchain {
             \param int The version of the serialized Blockchain
         */
         template <class Archive>
-        void serialize( Archive& t_archive, const unsigned int /* version */ ){
+        void serialize( Archive& t_archive, const unsigned int t_version ){
             t_archive & m_blockchain;
+
+            // chains saved before the binary encoding only have text hashes
+            std::vector<int> formats;
+
+            if(!Archive::is_loading::value){
+                for(auto& record : m_blockchain){
+                    formats.push_back(static_cast<int>(record->get_format()));
+                }
+            }
+
+            if(t_version > 0){
+                t_archive & formats;
+            }
+
+            if(Archive::is_loading::value){
+                formats.resize(m_blockchain.size(),static_cast<int>(HashFormat::Text));
+                for(size_t i = 0; i < m_blockchain.size(); ++i){
+                    m_blockchain[i]->set_format(static_cast<HashFormat>(formats[i]));
+                }
+            }
         }
 
 	public:
@@ -89,7 +291,7 @@ class Blockchain {
 		*/
 		Blockchain();
 
-		/** Empty destructor
+		/** Cancels and waits for any running mining jobs
 		*/
 		~Blockchain();
 
@@ -100,6 +302,21 @@ class Blockchain {
         */
         bool publish( std::shared_ptr<BaseRecord> t_record, std::shared_ptr<PrivateKey> t_key );
 
+        /** \brief Sign, mine and add a record on a background thread. If
+                   another record is appended while mining, the job starts
+                   again on the new tip.
+            \param t_record The record to sign, mine and broadcast
+            \param t_key The key to publish the record with
+            \param t_threads The number of mining threads (0 for one per core)
+            \returns The running MiningJob
+        */
+        std::shared_ptr<MiningJob> publish_async( std::shared_ptr<BaseRecord> t_record, std::shared_ptr<PrivateKey> t_key, size_t t_threads = 0 );
+
+        /** \brief Share the mining of published records with remote workers
+            \param t_server A started MiningServer (or null to mine locally only)
+        */
+        void set_mining_server( std::shared_ptr<MiningServer> t_server ){ m_server = t_server; }
+
 		/** \brief Find a BaseRecord by the hash
 			\param t_hash The hash of the BaseRecord to return
 			\returns A pointer to a BaseRecord object
@@ -118,10 +335,47 @@ class Blockchain {
 		*/
 		std::vector< std::shared_ptr<SignatureRecord> > find_signatures( std::string t_reference );
 
-		/** Verify that the Blockchain is valid
+		/** Verify that the Blockchain is valid, checking signatures and
+		    proof of work on several threads
+			\param t_threads The number of threads to check records on (0 for one per core)
 			\returns True if Blockchain is valid
 		*/
-		bool is_valid();
+		bool is_valid( size_t t_threads = 0 );
+
+		/** Verify the records from a height to the tip, taking the records
+		    before it as valid. Appended records are checked against the
+		    chain before them as they arrive, so validating from the
+		    validated height only checks records that weren't. A height
+		    past the validated height starts from the validated height.
+			\param t_height The position of the first record to check
+			\param t_threads The number of threads to check records on (0 for one per core)
+			\returns True if the records from the height are valid
+		*/
+		bool validate_from( uint64_t t_height, size_t t_threads = 0 );
+
+		/** Get the number of records at the start of the chain that are
+		    known to be valid. Changing a record after it was checked
+		    isn't noticed until it's checked again.
+			\returns The validated height
+		*/
+		uint64_t get_validated(){
+			std::lock_guard<std::mutex> guard(m_mutex);
+			return m_validated;
+		}
+
+		/** Get the position of the first record that failed the last
+		    call to is_valid
+			\returns The position of the record, or the size of the
+			         chain if it was valid
+		*/
+		uint64_t get_invalid(){
+			std::lock_guard<std::mutex> guard(m_mutex);
+			return m_invalid;
+		}
+
+		/** Rebuild the trust for every published record and user
+		*/
+		void update_trust();
 
 		/** Get the trust for a published BaseRecord or user
 			\param t_identifier The BaseRecord hash or user public key
@@ -129,12 +383,15 @@ class Blockchain {
 		*/
 		double trust( std::string t_identifier );
 		
-		/** Return an iterator to the start of the Blockchain
+		/** Return an iterator to the start of the Blockchain. Appending
+		    invalidates iterators, so this throws std::logic_error while
+		    a publish_async job is still running.
 			\returns An iterator
 		*/
 		Blockchain::iterator begin();
 
-		/** Returns an iterator to the end of the Blockchain
+		/** Returns an iterator to the end of the Blockchain. Throws
+		    std::logic_error while a publish_async job is still running.
 		\returns A vector iterator
 		*/ 
 		Blockchain::iterator end();
@@ -144,18 +401,97 @@ class Blockchain {
 		*/
 		size_t size();	
 
+        /** \brief Set the format used by save
+            \param t_format The FileFormat to save in
+        */
+        void set_file_format( FileFormat t_format ){ m_format = t_format; }
+
+        /** \brief Get the format used by save. After a load this
+                   is the format of the loaded file.
+            \returns The FileFormat that save writes
+        */
+        FileFormat get_file_format(){ return m_format; }
+
 		/** Save the Blockchain to a given location
 			\param t_path The path to save to
 			\returns True if the Blockchain was saved
 		*/
 		bool save( std::string t_path );
 		
-		/** Load the Blockchain from a given location
+		/** Read the Blockchain from a given location without
+		    checking it or updating the trust. Fails once segments
+		    are open, since they wouldn't match the records read.
+			\param t_path The path to read from
+			\returns True if the Blockchain file could be read
+		*/
+		bool read( std::string t_path );
+
+		/** Load the Blockchain from a given location. Fails once
+		    segments are open, like read.
 			\param t_path The path to load from
 			\returns True if the Blockchain was loaded and is valid
 		*/
 		bool load( std::string t_path );
 
+		/** Load the Blockchain from a given location, checking records
+		    while the rest of the file is read. A file that can be
+		    read but isn't valid is still read, without the trust.
+			\param t_path The path to load from
+			\param t_progress Called with the records checked so far
+			\returns True if the Blockchain was loaded and is valid
+		*/
+		bool load( std::string t_path, Loader::progress_t t_progress );
+
+		/** Open the segments in a directory and write every record
+		    appended after this to them. If there are no segments yet,
+		    the records already in the Blockchain are written first.
+			\param t_directory The directory that holds the segments
+			\param t_mapped Map sealed segments and keep their records
+			                as views once they've been checked
+			\param t_progress Called with the records checked so far
+			\returns True if the segments were opened and are valid
+		*/
+		bool open( std::string t_directory, bool t_mapped = true, Loader::progress_t t_progress = nullptr );
+
+		/** Check if segments are open for the Blockchain
+			\returns True if appended records are written to segments
+		*/
+		bool has_store(){
+			std::lock_guard<std::mutex> guard(m_mutex);
+			return m_store != nullptr;
+		}
+
+		/** Flush appended records to the open segments. Syncs from
+		    several threads at once share one flush.
+			\returns True if every record appended before the call is on disk
+		*/
+		bool sync();
+
+		/** Write snapshots of the trust and index to a path. Open reads
+		    the snapshot back and only checks the records after it.
+			\param t_path The path of the snapshot file
+			\param t_interval Write a new snapshot after this many appended records
+		*/
+		void set_snapshot( std::string t_path, size_t t_interval = 1000 );
+
+		/** Check every record when opening, even if there's a snapshot
+			\param t_full True to ignore snapshots when opening
+		*/
+		void set_full_check( bool t_full ){ m_full_check = t_full; }
+
+		/** Compress sealed segments when they're opened, and snapshots
+		    when they're written. Compressed files are read either way.
+			\param t_compressed True to compress segments and snapshots
+		*/
+		void set_compressed( bool t_compressed ){ m_compressed = t_compressed; }
+
+		/** Write a snapshot of the trust and index now
+			\returns True if a snapshot path is set and it was written
+		*/
+		bool snapshot();
+
 };
 
+BOOST_CLASS_VERSION(Blockchain,1)
+
 #endif
@@ -0,0 +1,107 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+
+/**	\file  compressor.hpp
+    \brief Defines the Compressor class that deflates segments and
+           snapshots, optionally with a shared dictionary
+*/
+
+#ifndef _RECHAIN_COMPRESSOR_HPP_
+#define _RECHAIN_COMPRESSOR_HPP_
+
+// system includes
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/** \brief The Compressor class deflates and inflates whole buffers
+           with zlib. A dictionary primes the compression window with
+           data the buffers are likely to repeat (public keys, mostly),
+           so even the first records of a buffer compress well. The
+           same dictionary has to be given to inflate what was deflated
+           with it.
+*/
+class Compressor {
+
+    private:
+
+        /** The preset dictionary (or empty for none) */
+        std::string m_dictionary;
+
+        /** The deflate level from 1 (fastest) to 9 (smallest) */
+        int m_level;
+
+    public:
+
+        /** The largest dictionary zlib can use */
+        static const size_t max_dictionary = 32768;
+
+        /** The most deflate can shrink its input by, which bounds the
+            length a compressed buffer can claim to inflate to */
+        static const size_t max_ratio = 1032;
+
+        /** \brief Constructor
+            \param t_dictionary The preset dictionary, or empty for none
+            \param t_level The deflate level from 1 to 9
+        */
+        Compressor( std::string t_dictionary = "", int t_level = 6 );
+
+        /** \brief Build a dictionary from samples, most useful first. The
+                   most useful samples are put at the end, where they're
+                   closest to the data and cheapest to refer to.
+            \param t_samples The samples to include
+            \param t_size The largest dictionary to build
+            \returns The dictionary
+        */
+        static std::string train( const std::vector<std::string>& t_samples, size_t t_size = max_dictionary );
+
+        /** \brief Deflate a buffer
+            \param t_data The data to compress
+            \param t_size The length of the data
+            \param t_output Set to the compressed data
+            \returns True if the data was compressed
+        */
+        bool compress( const char* t_data, size_t t_size, std::string& t_output );
+
+        /** \brief Inflate a buffer compressed with the same dictionary
+            \param t_data The compressed data
+            \param t_size The length of the compressed data
+            \param t_output A buffer for the uncompressed data
+            \param t_length The exact length of the uncompressed data
+            \returns True if the data inflated to exactly t_length bytes
+        */
+        bool decompress( const char* t_data, size_t t_size, char* t_output, size_t t_length );
+
+        /** \brief Get the dictionary
+            \returns The preset dictionary or an empty string
+        */
+        std::string get_dictionary(){ return m_dictionary; }
+
+        /** \brief Get the id zlib gives the dictionary, so that data can
+                   be matched with the dictionary it needs
+            \returns The adler32 of the dictionary, or 0 if there is none
+        */
+        uint32_t get_id();
+
+};
+
+#endif
@@ -27,4 +27,29 @@ enum RecordType {
     Signature 
 };
 
+/** The encodings records are hashed in. */
+enum class HashFormat {
+    Text,       /**< The boost text archive of the record */
+    Binary      /**< The canonical binary encoding of the record */
+};
+
+/** The signature schemes a key can use. */
+enum class KeyType {
+    RSAKey,     /**< RSA-3072 with PSS and Whirlpool */
+    Ed25519Key  /**< Ed25519 */
+};
+
+/** The outcomes of appending a mined record to a chain. */
+enum class AppendResult {
+    Appended,   /**< The record was added */
+    Stale,      /**< The tip moved while the record was mined */
+    Failed      /**< The record is invalid or couldn't be stored */
+};
+
+/** The formats a Blockchain can be saved in. */
+enum class FileFormat {
+    TextFile,   /**< A boost text archive */
+    BinaryFile  /**< A cereal portable binary archive after a magic header */
+};
+
 #endif
@@ -0,0 +1,113 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+
+/**	\file  generator.hpp
+    \brief Defines the Generator class that builds large, valid
+           chains for testing and benchmarks
+*/
+
+#ifndef _RECHAIN_GENERATOR_HPP_
+#define _RECHAIN_GENERATOR_HPP_
+
+// system includes
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// local includes
+#include "blockchain.hpp"
+#include "keys.hpp"
+
+/** \brief The Generator class builds a signed and mined chain of
+           synthetic publications and signatures from a number of
+           authors. Each record is signed against the one before it,
+           so records are built in order and mining uses every core.
+*/
+class Generator {
+
+    private:
+
+        /** The number of records to generate, including the genesis record */
+        size_t m_records;
+
+        /** The number of authors that publish and sign */
+        size_t m_authors;
+
+        /** The share of records after the genesis record that are publications */
+        double m_ratio;
+
+        /** The difficulty to mine at */
+        unsigned int m_difficulty;
+
+        /** The number of threads to mine and generate keys with */
+        size_t m_threads;
+
+        /** Seeds the choice of authors and signed publications */
+        uint32_t m_seed;
+
+        /** A directory to reuse keys from and save new keys to */
+        std::string m_directory;
+
+        /** \brief Load keys from the key directory and generate
+                   the rest on several threads
+            \returns One private key per author
+        */
+        std::vector< std::shared_ptr<PrivateKey> > keys();
+
+    public:
+
+        /** \brief Constructor
+            \param t_records The number of records (at least 1)
+            \param t_authors The number of authors (at least 1)
+            \param t_ratio The share of publications (more than 0, at most 1)
+            \param t_difficulty The difficulty to mine at
+            \param t_threads The number of threads (0 for one per core)
+        */
+        Generator( size_t t_records, size_t t_authors, double t_ratio, unsigned int t_difficulty, size_t t_threads = 0 );
+
+        /** \brief Reuse the private keys in a directory (in name order)
+                   and save any that have to be generated there
+            \param t_directory The directory to use
+        */
+        void set_keys( std::string t_directory ){ m_directory = t_directory; }
+
+        /** \brief Set the seed for choosing authors and signed publications
+            \param t_seed The seed to use
+        */
+        void set_seed( uint32_t t_seed ){ m_seed = t_seed; }
+
+        /** \brief Generate records into an empty chain
+            \param t_chain The chain to fill
+            \returns True if the chain was generated and is valid
+        */
+        bool generate( Blockchain& t_chain );
+
+        /** \brief Generate a chain and save it
+            \param t_path The path to save the chain to
+            \returns True if the chain was generated and saved
+        */
+        bool generate( std::string t_path );
+
+};
+
+#endif
@@ -75,6 +75,15 @@ class GenesisRecord : virtual public BaseRecord {
             t_archive & m_distribution;
         }
 
+        /** \brief Append the name and distribution list to a binary encoding
+            \param t_out The encoding to append to
+        */
+        void encode_fields( std::string& t_out );
+
+        /** \brief Free the fields of the record when a view is released
+        */
+        void release_fields();
+
 	public:
 
         /** \brief Empty constructor */
@@ -86,38 +95,53 @@ class GenesisRecord : virtual public BaseRecord {
         /** \brief Get the name for the Blockchain
             \returns The name of the Blockchain
         */
-        std::string get_name(){ return m_name; };
+        std::string get_name(){ decode(); return m_name; };
 
         /** \brief Set the name for the Blockchain
             \param t_name The name to set for the new Blockchain
         */
-        void set_name( std::string t_name ){ m_name = t_name; };
+        void set_name( std::string t_name ){ materialize(); m_name = t_name; invalidate(); };
 
         /** \brief Get the distribution list for the GenesisRecord
             \returns The distribution list for the GenesisRecord
         */
-        std::vector<std::string> get_distribution(){ return m_distribution; }
+        std::vector<std::string> get_distribution(){ decode(); return m_distribution; }
 
         /** \brief Set the distribution list for the GenesisRecord
             \param t_distribution The distribution list for the GenesisRecord
         */
-        void set_distribution( std::vector<std::string> t_distribution ){ m_distribution = t_distribution; }
+        void set_distribution( std::vector<std::string> t_distribution ){ materialize(); m_distribution = t_distribution; invalidate(); }
 
-        /** \brief Check if Record is internally valid
-            \returns True if Record is valid
+        /** \brief Check that the fields are present and not too large
+            \returns True if Record is well formed
         */
-        bool is_valid();
+        bool is_well_formed();
 
         /** \brief Get the concatenated data for signing
             \returns The data of the record as a string
         */
         std::string get_data();
 
+        /** \brief Write the record to a binary chain file
+            \param t_archive The archive to write to
+        */
+        void save_binary( cereal::PortableBinaryOutputArchive& t_archive );
+
+        /** \brief Read the record from a binary chain file
+            \param t_archive The archive to read from
+        */
+        void load_binary( cereal::PortableBinaryInputArchive& t_archive );
+
         /** \brief Get the serialized record as a string
             \returns The record as a string
         */
         std::string to_string();
 
+        /** \brief Get a copy of the Record
+            \returns A pointer to the new copy
+        */
+        std::shared_ptr<BaseRecord> clone();
+
 
 };
 
@@ -0,0 +1,134 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+
+/**	\file  key_cache.hpp
+    \brief Defines the KeyCache class that keeps parsed public keys
+           for the authors that are seen most
+*/
+
+#ifndef _RECHAIN_KEYCACHE_HPP_
+#define _RECHAIN_KEYCACHE_HPP_
+
+// system includes
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+
+// local includes
+#include "keys.hpp"
+
+/** \brief The KeyCache class keeps public keys that have been parsed,
+           validated and given a verifier, by their hex encoding. A
+           chain has many records from few authors, so most records
+           are checked with a key that's already here. The cache is
+           shared by every thread and drops the least recently used
+           key when it's full.
+*/
+class KeyCache {
+
+    private:
+
+        /** Encodings and their keys, the most recently used first */
+        typedef std::list< std::pair< std::string, std::shared_ptr<PublicKey> > > entries_t;
+
+        /** Guards the entries and lookup */
+        static std::mutex m_mutex;
+
+        /** The cached keys */
+        static entries_t m_entries;
+
+        /** The position of each encoding in m_entries */
+        static std::unordered_map< std::string, entries_t::iterator > m_lookup;
+
+        /** The most keys kept at once */
+        static size_t m_capacity;
+
+        /** The number of keys found in the cache */
+        static std::atomic<uint64_t> m_hits;
+
+        /** The number of keys that had to be parsed */
+        static std::atomic<uint64_t> m_misses;
+
+        /** \brief Add a key and drop the oldest keys past the capacity.
+                   The caller holds m_mutex.
+            \param t_encoding The hex encoding of the key
+            \param t_key The key, with its verifier ready
+            \returns The key that's cached for the encoding
+        */
+        static std::shared_ptr<PublicKey> insert( const std::string& t_encoding, std::shared_ptr<PublicKey> t_key );
+
+    public:
+
+        /** \brief Get the key for an encoding, parsing and validating it
+                   the first time it's seen
+            \param t_encoding The hex encoding of the key
+            \returns The key, ready to verify with
+            \throws std::invalid_argument (or a CryptoPP exception) if
+                    the key can't be parsed or isn't valid, the same as
+                    PublicKey::load_string
+        */
+        static std::shared_ptr<PublicKey> get( const std::string& t_encoding );
+
+        /** \brief Add a key that's known to be good, like the public half
+                   of a key that was just used to sign
+            \param t_encoding The hex encoding of the key
+            \param t_key The key
+        */
+        static void add( const std::string& t_encoding, std::shared_ptr<PublicKey> t_key );
+
+        /** \brief Set the most keys kept at once, dropping the oldest
+                   if there are more. Zero turns the cache off.
+            \param t_capacity The number of keys to keep
+        */
+        static void set_capacity( size_t t_capacity );
+
+        /** \brief Get the most keys kept at once
+            \returns The capacity
+        */
+        static size_t get_capacity();
+
+        /** \brief Get the number of keys in the cache
+            \returns The number of keys
+        */
+        static size_t size();
+
+        /** \brief Get the number of times a key was found in the cache
+            \returns The number of hits
+        */
+        static uint64_t get_hits(){ return m_hits; }
+
+        /** \brief Get the number of times a key had to be parsed
+            \returns The number of misses
+        */
+        static uint64_t get_misses(){ return m_misses; }
+
+        /** \brief Drop every key and reset the counters
+        */
+        static void clear();
+
+};
+
+#endif
@@ -22,21 +22,27 @@
 /** \file	keys.hpp
 	\brief	Defines the Key classes used to manage,
 			load, save and generate a public and
-			private pair of RSA256 keys.
+			private pair of RSA-3072 or Ed25519 keys.
 */
 
 // system includes
 #include <fstream>			    // File I/O
 #include <iostream>
 #include <stdexcept>
+#include <memory>
+#include <vector>
 
 // dependency includes
 #include <cryptopp/osrng.h>		// For AutoSeededRandomPool
 #include <cryptopp/hex.h>		// For HexEncoder/HexDecoder
 #include <cryptopp/rsa.h>		// For RSA:: namespace
+#include <cryptopp/pssr.h>		// For PSSR
+#include <cryptopp/whrlpool.h>	// For Whirlpool
+#include <cryptopp/xed25519.h>	// For ed25519
 
 // local includes
 #include "base_record.hpp"		// Data objects
+#include "enums.hpp"			// For KeyType
 
 #ifndef _RECHAIN_KEYS_HPP_
 #define _RECHAIN_KEYS_HPP_
@@ -44,6 +50,18 @@
 class PrivateKey;
 class PublicKey;
 
+/** Signs records with a PrivateKey */
+using Signer   = CryptoPP::RSASS<CryptoPP::PSSR, CryptoPP::Whirlpool>::Signer;
+
+/** Checks record signatures with a PublicKey */
+using Verifier = CryptoPP::RSASS<CryptoPP::PSSR, CryptoPP::Whirlpool>::Verifier;
+
+/** Signs records with an Ed25519 PrivateKey */
+using Ed25519Signer   = CryptoPP::ed25519Signer;
+
+/** Checks record signatures with an Ed25519 PublicKey */
+using Ed25519Verifier = CryptoPP::ed25519Verifier;
+
 /** The templated Key class acts as a base class for both
 	PrivateKey and PublicKey.
 */
@@ -132,7 +150,7 @@ class Key {
 		bool load( std::string fn ){
 			std::ifstream file(fn);
 			if( file.is_open() ){
-				this->from_string( std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()) );
+				static_cast<K*>(this)->from_string( std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()) );
 				return true;
 			}
 			return false;
@@ -145,17 +163,66 @@ class Key {
 		bool save( std::string fn ){
 			std::ofstream file(fn);
 			if( file.is_open() ){
-				file << this->to_string();
+				file << static_cast<K*>(this)->to_string();
 				return true;
 			}
 			return false;
 		}
 };
 
+/** The Ed25519PrivateKey class holds the private half of
+	an Ed25519 identity for PrivateKey.
+*/
+class Ed25519PrivateKey : public Key<CryptoPP::ed25519PrivateKey,Ed25519PrivateKey> {
+	public:
+		/** \brief Empty constructor */
+		Ed25519PrivateKey(){}
+
+		/** \brief Generate a new key */
+		void generate();
+};
+
+/** The Ed25519PublicKey class holds the public half of
+	an Ed25519 identity for PublicKey.
+*/
+class Ed25519PublicKey : public Key<CryptoPP::ed25519PublicKey,Ed25519PublicKey> {
+	public:
+		/** \brief Empty constructor */
+		Ed25519PublicKey(){}
+
+		/** \brief Generate a new Ed25519PublicKey from a private key
+			\param t_key The Ed25519PrivateKey to generate from
+		*/
+		void generate( Ed25519PrivateKey* t_key );
+};
+
+/** \brief The parts of signing that only depend on the key. A
+	       PrivateKey builds them for the first record it signs
+	       and shares them with every record after.
+*/
+struct SigningContext {
+	std::string encoding;							/**< The hex encoded public key */
+	std::shared_ptr<PublicKey> public_key;			/**< The public key */
+	std::shared_ptr<Signer> signer;					/**< The RSA signer (or null) */
+	std::shared_ptr<Ed25519Signer> ed25519_signer;	/**< The Ed25519 signer (or null) */
+};
+
 /** The PrivateKey class inherits from the templated
 	'Key' base class and adds private-key-specific methods.
+	It's an RSA key unless it was generated or loaded as
+	an Ed25519 key.
 */
 class PrivateKey : public Key<CryptoPP::RSA::PrivateKey,PrivateKey> {
+	private:
+		/** The key if it's an Ed25519 key (or null) */
+		std::shared_ptr<Ed25519PrivateKey> m_ed25519;
+
+		/** The signing context, built on first use (or null) */
+		std::shared_ptr<SigningContext> m_context;
+
+		/** \brief Forget the signing context after the key changes */
+		void reset_context();
+
 	public:
 		/** \brief Empty constructor */
 		PrivateKey(){}
@@ -165,10 +232,49 @@ class PrivateKey : public Key<CryptoPP::RSA::PrivateKey,PrivateKey> {
         */
 		PrivateKey( PrivateKey* t_key ){
             key = t_key->key;
+            m_ed25519 = t_key->m_ed25519;
+            m_context = std::atomic_load(&t_key->m_context);
         }
 
-		/** \brief Generate a new key */
-		void generate();
+		/** \brief Generate a new key
+			\param t_type The signature scheme to use
+		*/
+		void generate( KeyType t_type = KeyType::RSAKey );
+
+		/** \brief Get the signature scheme of the key
+			\returns The type of the key
+		*/
+		KeyType get_type(){ return m_ed25519 ? KeyType::Ed25519Key : KeyType::RSAKey; }
+
+		/** \brief Set an RSA CryptoPP object as key
+			\param t_key The key to use
+		*/
+		void set_key( CryptoPP::RSA::PrivateKey t_key ){
+			reset_context();
+			m_ed25519.reset();
+			key = t_key;
+		}
+
+		/** \brief Get the key if it's an Ed25519 key
+			\returns The Ed25519 key or null
+		*/
+		std::shared_ptr<Ed25519PrivateKey> get_ed25519(){ return m_ed25519; }
+
+		/** \brief Convert the key to a hex encoded string
+			\returns The hex encoded string
+		*/
+		std::string to_string();
+
+		/** \brief Build the key from a hex encoded string. The
+			       type is found from the algorithm in the encoding.
+			\param t_key The string to build
+		*/
+		void from_string( std::string t_key );
+
+		/** \brief Verify that the key is valid
+			\returns True if valid, false otherwise
+		*/
+		bool valid();
 
         /** \brief Get a public key
             \returns A pointer to a public key
@@ -185,12 +291,34 @@ class PrivateKey : public Key<CryptoPP::RSA::PrivateKey,PrivateKey> {
 		*/
 		void sign( std::shared_ptr<BaseRecord> t_record );
 
+		/** \brief Sign a number of records, sharing one signing context
+			\param t_records The records to sign
+			\param t_threads The number of threads to sign on (0 for one per core)
+		*/
+		void sign( const std::vector< std::shared_ptr<BaseRecord> >& t_records, size_t t_threads = 0 );
+
+		/** \brief Get the signing context, building it if this is the
+			       first time. Safe to call from several threads.
+			\returns The signing context
+		*/
+		std::shared_ptr<SigningContext> get_context();
+
 };
 
 /** The PublicKey class inherits from the templated
 	'Key' base class and adds public-key-specific methods.
 */
 class PublicKey: public Key<CryptoPP::RSA::PublicKey,PublicKey> {
+	private:
+		/** A verifier built once by prepare (or null) */
+		std::shared_ptr<Verifier> m_verifier;
+
+		/** The key if it's an Ed25519 key (or null) */
+		std::shared_ptr<Ed25519PublicKey> m_ed25519;
+
+		/** An Ed25519 verifier built once by prepare (or null) */
+		std::shared_ptr<Ed25519Verifier> m_ed25519_verifier;
+
 	public:
 		/** \brief Empty constructor */
 		PublicKey(){}
@@ -200,6 +328,7 @@ class PublicKey: public Key<CryptoPP::RSA::PublicKey,PublicKey> {
         */
 		PublicKey( PublicKey* t_key ){
             key = t_key->key;
+            m_ed25519 = t_key->m_ed25519;
         }
 
 		/** \brief Generate a new PublicKey from a PrivateKey
@@ -207,12 +336,39 @@ class PublicKey: public Key<CryptoPP::RSA::PublicKey,PublicKey> {
 		*/
 		void generate( PrivateKey* t_key );
 
+		/** \brief Get the signature scheme of the key
+			\returns The type of the key
+		*/
+		KeyType get_type(){ return m_ed25519 ? KeyType::Ed25519Key : KeyType::RSAKey; }
+
+		/** \brief Convert the key to a hex encoded string
+			\returns The hex encoded string
+		*/
+		std::string to_string();
+
+		/** \brief Build the key from a hex encoded string. The
+			       type is found from the algorithm in the encoding.
+			\param t_key The string to build
+		*/
+		void from_string( std::string t_key );
+
+		/** \brief Verify that the key is valid
+			\returns True if valid, false otherwise
+		*/
+		bool valid();
+
 		/** \brief Verify a Record to ensure that the
 		 	       signature attached to it is correct.
 			\param t_record A pointer to the Record to verify
 			\returns True if the Record is signed correctly
 		*/
 		bool verify( BaseRecord* t_record );
+
+		/** \brief Build the verifier once, instead of for every record
+		 	       that's verified. Keys are prepared before they're
+		 	       shared, since this isn't thread-safe.
+		*/
+		void prepare();
 };
 
 #endif
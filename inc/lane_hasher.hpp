@@ -0,0 +1,124 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+/**	\file  lane_hasher.hpp
+    \brief Defines the LaneHasher class that computes several
+           independent SHA256 digests at once
+*/
+
+#ifndef _RECHAIN_LANEHASHER_HPP_
+#define _RECHAIN_LANEHASHER_HPP_
+
+// system includes
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/** \brief The SHA256 state after hashing the whole 64 byte
+           blocks at the start of a message.
+*/
+struct LaneState {
+    uint32_t h[8];          /**< The chaining value */
+    uint64_t length;        /**< The number of bytes hashed so far */
+};
+
+/** \brief The LaneHasher class hashes independent messages in parallel
+           lanes of 8 (AVX2) or 16 (AVX-512) 32-bit words, and falls back
+           to one message at a time when neither is available. The
+           backend is chosen at runtime from the cpu features. Single
+           messages on the scalar backend go through CryptoPP, which
+           uses the SHA extensions where the cpu has them, so cpus with
+           SHA-NI use the scalar backend.
+*/
+class LaneHasher {
+
+    public:
+
+        /** The available hashing backends */
+        enum Backend {
+            Scalar,     /**< One message at a time */
+            AVX2,       /**< Eight messages at a time */
+            AVX512      /**< Sixteen messages at a time */
+        };
+
+    private:
+
+        /** The backend that is currently in use */
+        static Backend m_backend;
+
+    public:
+
+        /** \brief Find the best backend the cpu supports
+            \returns The fastest supported backend
+        */
+        static Backend detect();
+
+        /** \brief Check if the cpu can run a backend
+            \param t_backend The backend to check
+            \returns True if the backend can be used
+        */
+        static bool is_supported( Backend t_backend );
+
+        /** \brief Get the backend that is currently in use
+            \returns The current backend
+        */
+        static Backend get_backend();
+
+        /** \brief Use a different backend (mostly for tests and benchmarks)
+            \param t_backend The backend to use
+            \returns True if the cpu supports it and it was set
+        */
+        static bool set_backend( Backend t_backend );
+
+        /** \brief Get the name of a backend
+            \param t_backend The backend to name
+            \returns The name of the backend
+        */
+        static std::string get_name( Backend t_backend );
+
+        /** \brief Get the number of messages hashed per pass by the current backend
+            \returns The number of lanes
+        */
+        static size_t get_lanes();
+
+        /** \brief Hash the whole blocks of a message prefix
+            \param t_prefix The data to start hashing
+            \param t_remainder Set to the bytes after the last whole block
+            \returns The state after the whole blocks
+        */
+        static LaneState start( const std::string& t_prefix, std::string& t_remainder );
+
+        /** \brief Finish hashing a number of messages that share a state
+            \param t_state The state to continue from
+            \param t_tails The remaining data of each message
+            \param t_digests A buffer of 32 bytes per tail to write digests to
+        */
+        static void finish( const LaneState& t_state, const std::vector<std::string>& t_tails, unsigned char* t_digests );
+
+        /** \brief Hash a number of complete messages
+            \param t_messages The messages to hash
+            \param t_digests A buffer of 32 bytes per message to write digests to
+        */
+        static void digest( const std::vector<std::string>& t_messages, unsigned char* t_digests );
+
+};
+
+#endif
@@ -0,0 +1,128 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+
+/**	\file  loader.hpp
+    \brief Defines the Loader class that checks records in a
+           pipeline while they're being read
+*/
+
+#ifndef _RECHAIN_LOADER_HPP_
+#define _RECHAIN_LOADER_HPP_
+
+// system includes
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <functional>
+
+// local includes
+#include "base_record.hpp"
+
+/** \brief The Loader class runs records through a bounded pipeline.
+           One thread reads chunks of records from a source, worker
+           threads hash each chunk and check the signature and proof
+           of work of every record in it, and the calling thread hands
+           the checked records to a sink in chain order. Reading,
+           hashing and verifying overlap, so a load takes about as long
+           as its slowest stage.
+*/
+class Loader {
+
+    public:
+
+        /** A chunk of records in chain order */
+        typedef std::vector< std::shared_ptr<BaseRecord> > chunk_t;
+
+        /** Adds up to a number of records to a chunk, and none at the
+            end. Returns false if a record can't be read, with the
+            records before it in the chunk. */
+        typedef std::function<bool( chunk_t&, size_t )> source_t;
+
+        /** Takes each checked record in chain order. Returns false to
+            stop the load. */
+        typedef std::function<bool( std::shared_ptr<BaseRecord> )> sink_t;
+
+        /** Called with the number of records done and the total after
+            each chunk */
+        typedef std::function<void( uint64_t, uint64_t )> progress_t;
+
+    private:
+
+        /** The number of worker threads */
+        size_t m_threads;
+
+        /** The number of records in each chunk */
+        size_t m_chunk;
+
+        /** The number of chunks that can be in the pipeline at once */
+        size_t m_depth;
+
+        /** Called after each chunk, if set */
+        progress_t m_progress;
+
+        /** The index of the first record that failed (or the record count) */
+        uint64_t m_failed;
+
+    public:
+
+        /** \brief Constructor
+            \param t_threads The number of worker threads (0 for one per core)
+            \param t_chunk The number of records in each chunk
+        */
+        Loader( size_t t_threads = 0, size_t t_chunk = 256 );
+
+        /** \brief Report progress after each chunk
+            \param t_progress The function to call
+        */
+        void set_progress( progress_t t_progress ){ m_progress = t_progress; }
+
+        /** \brief Get the number of worker threads
+            \returns The number of worker threads
+        */
+        size_t get_threads(){ return m_threads; }
+
+        /** \brief Read, check and sink every record from a source. If
+                   the sink or progress function throws, the reader and
+                   workers are stopped before the exception is rethrown.
+            \param t_total The number of records expected, for progress
+            \param t_source The function that reads chunks
+            \param t_sink The function that takes checked records
+            \returns True if every record was read, checked and sunk
+        */
+        bool run( uint64_t t_total, source_t t_source, sink_t t_sink );
+
+        /** \brief Get the index of the first record that couldn't be read,
+                   wasn't valid or was refused by the sink
+            \returns The index of the record, or the number of records
+                     if the last run succeeded
+        */
+        uint64_t get_failed(){ return m_failed; }
+
+        /** \brief Get a source that hands out records already in memory
+            \param t_records The records to hand out
+            \returns A source over the records
+        */
+        static source_t source( const std::vector< std::shared_ptr<BaseRecord> >& t_records );
+
+};
+
+#endif
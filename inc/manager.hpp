@@ -35,6 +35,7 @@
 
 // local includes
 #include "blockchain.hpp"
+#include "mining_pool.hpp"
 #include "config.hpp"
 #include "enums.hpp"
 
@@ -50,6 +51,7 @@ class Manager {
 
 		std::shared_ptr<PrivateKey> m_private_key;      /**< A pointer to the current private key */
 		Blockchain m_blockchain;                        /**< A Blockchain to load data into */
+		std::shared_ptr<MiningServer> m_mining_server;  /**< Shares mining with remote workers, if configured */
 
         /** \brief Setup the home directory
             \returns True if setup was successful
@@ -117,6 +119,28 @@ class Manager {
         */
 		bool is_valid();
 
+        /** \brief Mine work units for another node until it goes away
+            \param t_address The host and port of the node ('host:port')
+            \returns True if the node could be reached
+        */
+        bool work( std::string t_address );
+
+        /** \brief Generate a signed and mined chain for testing
+            \param t_path The path to save the chain to
+            \param t_records The number of records
+            \param t_authors The number of authors
+            \param t_ratio The share of records that are publications
+            \param t_keys A directory of keys to reuse (empty to generate them all)
+            \returns True if the chain was generated and saved
+        */
+        bool generate( std::string t_path, size_t t_records, size_t t_authors, double t_ratio, std::string t_keys );
+
+        /** \brief Rewrite the Blockchain in another file format
+            \param t_format The format to write ('text' or 'binary')
+            \returns True if the Blockchain was saved in the new format
+        */
+        bool convert( std::string t_format );
+
 };
 
 #endif
@@ -82,6 +82,18 @@ class Message {
         */
         void read(boost::asio::ip::tcp::socket& socket);
 
+        /** \brief Parse the header, and any of the body after it, from
+                   a buffer read up to the blank line after the header
+            \param buffer The buffer to parse and empty
+            \returns The number of body bytes still to read
+        */
+        size_t read_header(boost::asio::streambuf& buffer);
+
+        /** \brief Add the rest of the body from a buffer
+            \param buffer The buffer to add and empty
+        */
+        void read_body(boost::asio::streambuf& buffer);
+
         /** \brief Writes http request data to a socket
             \param socket the open socket to write to
         */
@@ -0,0 +1,234 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+/**	\file  miner.hpp
+    \brief Defines the Miner class that searches for a valid
+           hash for a BaseRecord using several threads
+*/
+
+#ifndef _RECHAIN_MINER_HPP_
+#define _RECHAIN_MINER_HPP_
+
+// system includes
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+// dependency includes
+#include <cryptopp/sha.h>       // for SHA256
+
+// local includes
+#include "base_record.hpp"
+#include "lane_hasher.hpp"
+
+/** \brief The MidState class serializes the parts of a BaseRecord that
+           don't change while mining once, and keeps the SHA256 state
+           after hashing them so that each attempt only hashes the
+           hashing variables and whatever follows them.
+*/
+class MidState {
+
+    private:
+
+        /** The hasher after the prefix has been added */
+        CryptoPP::SHA256 m_hasher;
+
+        /** The LaneHasher state after the whole blocks of the prefix */
+        LaneState m_lanes;
+
+        /** The bytes of the prefix after the last whole block */
+        std::string m_remainder;
+
+        /** The serialized data after the counter */
+        std::string m_suffix;
+
+        /** The encoding the hashing variables are serialized in */
+        HashFormat m_format;
+
+        /** True if the record could be split */
+        bool m_valid;
+
+        /** \brief Hash the prefix with CryptoPP and the LaneHasher
+            \param t_prefix The serialized data before the nonce
+        */
+        void start( const std::string& t_prefix );
+
+    public:
+
+        /** \brief Split a record and hash the prefix
+            \param t_record The record to build the MidState for
+        */
+        MidState( BaseRecord* t_record );
+
+        /** \brief Build a MidState from a record that was already split
+            \param t_prefix The serialized data before the nonce
+            \param t_suffix The serialized data after the counter
+            \param t_format The encoding the record was split from
+        */
+        MidState( const std::string& t_prefix, const std::string& t_suffix, HashFormat t_format );
+
+        /** \brief Empty destructor */
+        ~MidState();
+
+        /** \brief Check if the record could be split
+            \returns True if hash can be used
+        */
+        bool is_valid(){ return m_valid; }
+
+        /** \brief Get the hash the record would have with the given values
+            \param t_nonce The nonce to hash with
+            \param t_timestamp The timestamp to hash with
+            \param t_counter The counter to hash with
+            \returns The same hash as BaseRecord::hash for those values
+        */
+        std::string hash( long t_nonce, long t_timestamp, uint32_t t_counter );
+
+        /** \brief Get the raw digest the record would have with the given values
+            \param t_nonce The nonce to hash with
+            \param t_timestamp The timestamp to hash with
+            \param t_counter The counter to hash with
+            \param t_digest A buffer of DIGEST_SIZE bytes to write the digest to
+        */
+        void digest( long t_nonce, long t_timestamp, uint32_t t_counter, unsigned char* t_digest );
+
+        /** \brief Get the raw digests for several counters at once using the LaneHasher
+            \param t_nonce The nonce to hash with
+            \param t_timestamp The timestamp to hash with
+            \param t_counters The counters to hash with
+            \param t_digests A buffer of DIGEST_SIZE bytes per counter to write the digests to
+        */
+        void digest( long t_nonce, long t_timestamp, const std::vector<uint32_t>& t_counters, unsigned char* t_digests );
+
+};
+
+/** \brief The Miner class splits the nonce/counter space of a
+           BaseRecord across a number of worker threads and
+           stops them all once one of them finds a valid hash.
+*/
+class Miner {
+
+    private:
+
+        /** The number of worker threads to mine with */
+        size_t m_threads;
+
+        /** The number of hashes tried by each worker */
+        std::vector<uint64_t> m_attempts;
+
+        /** The wall time of the last call to mine (in seconds) */
+        double m_seconds;
+
+        /** The hashes tried so far by all workers, updated while mining */
+        std::atomic<uint64_t> m_progress;
+
+        /** Checked while mining. Mining stops if it returns true */
+        std::function<bool()> m_interrupt;
+
+    public:
+
+        /** \brief Construct a Miner that uses one thread per core */
+        Miner();
+
+        /** \brief Construct a Miner with a number of threads
+            \param t_threads The number of worker threads (0 for one per core)
+        */
+        Miner( size_t t_threads );
+
+        /** \brief Empty destructor */
+        ~Miner();
+
+        /** \brief Mine a signed record until it has a valid hash
+            \param t_record The record to mine
+            \returns The valid hash of the record, or an empty
+                     string if mining was interrupted
+        */
+        std::string mine( BaseRecord* t_record );
+
+        /** \brief Mine a signed record until it has a valid hash
+            \param t_record The record to mine
+            \returns The valid hash of the record, or an empty
+                     string if mining was interrupted
+        */
+        std::string mine( std::shared_ptr<BaseRecord> t_record );
+
+        /** \brief Search a range of counters for a valid hash, splitting
+                   the range across the worker threads
+            \param t_state The MidState of the record being mined
+            \param t_nonce The nonce to hash with
+            \param t_timestamp The timestamp to hash with
+            \param t_first The first counter to try
+            \param t_count The number of counters to try
+            \param t_difficulty The number of leading zero bits to find
+            \param t_counter Set to the winning counter if one is found
+            \returns True if a counter gave a valid hash
+        */
+        bool search( MidState& t_state, long t_nonce, long t_timestamp, uint32_t t_first, uint64_t t_count,
+                     unsigned int t_difficulty, uint32_t& t_counter );
+
+        /** \brief Set a check that is called every few thousand attempts
+                   by each worker (from the worker threads). If it returns
+                   true, mining stops and the record is left unchanged.
+            \param t_interrupt The check to call
+        */
+        void set_interrupt( std::function<bool()> t_interrupt ){ m_interrupt = t_interrupt; }
+
+        /** \brief Get the current interrupt check
+            \returns The check set by set_interrupt
+        */
+        std::function<bool()> get_interrupt(){ return m_interrupt; }
+
+        /** \brief Get the hashes tried so far by the current (or last) mine.
+                   Safe to call from other threads while mining.
+            \returns The number of attempts so far
+        */
+        uint64_t get_progress(){ return m_progress.load(); }
+
+        /** \brief Get the number of worker threads
+            \returns The number of threads used to mine
+        */
+        size_t get_threads(){ return m_threads; }
+
+        /** \brief Get the hashes tried by each worker during the last mine
+            \returns A vector of attempts, one per thread
+        */
+        std::vector<uint64_t> get_attempts(){ return m_attempts; }
+
+        /** \brief Get the wall time of the last mine
+            \returns The time spent mining in seconds
+        */
+        double get_seconds(){ return m_seconds; }
+
+        /** \brief Get the hash rate of each worker during the last mine
+            \returns A vector of hashes/sec, one per thread
+        */
+        std::vector<double> get_thread_rates();
+
+        /** \brief Get the combined hash rate of the last mine
+            \returns The total hashes/sec of all threads
+        */
+        double get_hash_rate();
+
+};
+
+#endif
@@ -0,0 +1,176 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+/**	\file  mining_job.hpp
+    \brief Defines the MiningJob class that signs, mines and
+           appends a record on a background thread
+*/
+
+#ifndef _RECHAIN_MININGJOB_HPP_
+#define _RECHAIN_MININGJOB_HPP_
+
+// system includes
+#include <string>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <chrono>
+#include <functional>
+
+// local includes
+#include "base_record.hpp"
+#include "miner.hpp"
+#include "mining_pool.hpp"
+#include "keys.hpp"
+#include "enums.hpp"
+
+/** \brief The MiningJob class mines a record on a background thread
+           so that the caller can wait on it, watch its progress or
+           cancel it. The job is built on the chain tip it was given;
+           if the tip changes while mining, the record is re-signed
+           against the new tip and mining starts again. Any other
+           failure to append ends the job.
+*/
+class MiningJob {
+
+    private:
+
+        /** The record to sign, mine and append */
+        std::shared_ptr<BaseRecord> m_record;
+
+        /** The key to sign the record with */
+        std::shared_ptr<PrivateKey> m_key;
+
+        /** Gets the hash of the current chain tip */
+        std::function<std::string()> m_tip;
+
+        /** Appends the mined record and says if it was added, stale or failed */
+        std::function<AppendResult(std::shared_ptr<BaseRecord>)> m_append;
+
+        /** The miner used for every attempt */
+        Miner m_miner;
+
+        /** Hands work to remote workers as well, if set */
+        std::shared_ptr<MiningServer> m_server;
+
+        /** Set to stop the job */
+        std::atomic<bool> m_cancelled;
+
+        /** Set once the job has finished */
+        std::atomic<bool> m_finished;
+
+        /** Hashes tried by earlier (restarted) attempts */
+        std::atomic<uint64_t> m_attempts;
+
+        /** The number of times mining restarted on a new tip */
+        std::atomic<unsigned int> m_restarts;
+
+        /** When the job was started */
+        std::atomic<std::chrono::steady_clock::time_point> m_started;
+
+        /** The result of the job, true if the record was appended */
+        std::promise<bool> m_promise;
+
+        /** The future for m_promise */
+        std::shared_future<bool> m_result;
+
+        /** The thread that runs the job */
+        std::thread m_thread;
+
+        /** \brief Sign and mine until the record is appended,
+                   the record is invalid or the job is cancelled
+            \returns True if the record was appended
+        */
+        bool run();
+
+    public:
+
+        /** \brief Create a job, it won't run until start is called
+            \param t_record The record to sign, mine and append
+            \param t_key The key to sign the record with
+            \param t_tip Gets the hash of the current chain tip
+            \param t_append Appends the record, says if it was added, stale or failed
+            \param t_threads The number of mining threads (0 for one per core)
+            \param t_server A MiningServer to share the work with (may be null)
+        */
+        MiningJob( std::shared_ptr<BaseRecord> t_record,
+                   std::shared_ptr<PrivateKey> t_key,
+                   std::function<std::string()> t_tip,
+                   std::function<AppendResult(std::shared_ptr<BaseRecord>)> t_append,
+                   size_t t_threads = 0,
+                   std::shared_ptr<MiningServer> t_server = nullptr );
+
+        /** \brief Cancel the job and wait for it to stop */
+        ~MiningJob();
+
+        /** \brief Start mining on a background thread */
+        void start();
+
+        /** \brief Ask the job to stop. The record is not appended
+                   unless it already had been.
+        */
+        void cancel();
+
+        /** \brief Wait for the job to finish
+            \returns True if the record was appended
+        */
+        bool wait();
+
+        /** \brief Wait for the job to finish or for a timeout
+            \param t_seconds The longest time to wait
+            \returns True if the job finished in time
+        */
+        bool wait_for( double t_seconds );
+
+        /** \brief Get a future for the result of the job
+            \returns A future that is true if the record was appended
+        */
+        std::shared_future<bool> get_future(){ return m_result; }
+
+        /** \brief Check if the job has finished
+            \returns True if the job is done
+        */
+        bool is_finished(){ return m_finished; }
+
+        /** \brief Check if the job was cancelled
+            \returns True if cancel was called
+        */
+        bool is_cancelled(){ return m_cancelled; }
+
+        /** \brief Get the hashes tried so far
+            \returns The total attempts over every restart
+        */
+        uint64_t get_attempts();
+
+        /** \brief Get the hash rate since the job started
+            \returns The hashes/sec of the job
+        */
+        double get_hash_rate();
+
+        /** \brief Get the number of times mining restarted on a new tip
+            \returns The number of restarts
+        */
+        unsigned int get_restarts(){ return m_restarts; }
+
+};
+
+#endif
@@ -0,0 +1,301 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+/**	\file  mining_pool.hpp
+    \brief Defines the MiningServer and MiningWorker classes that
+           farm mining out to other machines over http
+*/
+
+#ifndef _RECHAIN_MININGPOOL_HPP_
+#define _RECHAIN_MININGPOOL_HPP_
+
+// system includes
+#include <string>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+// dependency includes
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+
+// local includes
+#include "base_record.hpp"
+#include "miner.hpp"
+#include "message.hpp"
+
+/** \brief The MiningServer class hands out work units for the record
+           being mined to MiningWorkers that connect over http, and
+           checks the solutions they send back. Each unit is a nonce
+           and a range of counters, so no two units overlap. Units use
+           nonces above LONG_MAX/2 and the local Miner uses nonces
+           below it, so local threads can mine at the same time.
+
+           Workers POST to "/work" to get a unit and to "/solution"
+           to return a valid counter. Both requests carry the attempts
+           and seconds of the last unit so that the server can report
+           the hash rate of the whole pool.
+*/
+class MiningServer {
+
+    private:
+
+        /** The port to listen on (0 picks a free port) */
+        unsigned short m_port;
+
+        /** The number of counters in each work unit */
+        uint64_t m_unit;
+
+        /** IO service for the acceptor */
+        boost::asio::io_service m_service;
+
+        /** The acceptor that listens for workers */
+        boost::shared_ptr<boost::asio::ip::tcp::acceptor> m_acceptor;
+
+        /** The thread that m_service runs in */
+        boost::shared_ptr<boost::thread> m_thread;
+
+        /** Guards the current job */
+        std::mutex m_mutex;
+
+        /** Signalled when a job is solved or the server stops */
+        std::condition_variable m_signal;
+
+        /** True if there is a job to hand out */
+        bool m_active;
+
+        /** True while the server is shutting down */
+        bool m_stopping;
+
+        /** The id of the current job */
+        uint64_t m_job;
+
+        /** The serialized record before the nonce */
+        std::string m_prefix;
+
+        /** The serialized record after the counter */
+        std::string m_suffix;
+
+        /** The encoding the record was split from */
+        HashFormat m_format;
+
+        /** The timestamp every unit of the job uses */
+        long m_timestamp;
+
+        /** The difficulty of the current job */
+        unsigned int m_difficulty;
+
+        /** The index of the next unit to hand out */
+        uint64_t m_next;
+
+        /** Used to check solutions */
+        std::shared_ptr<MidState> m_state;
+
+        /** Set when a worker returns a valid solution */
+        std::atomic<bool> m_solved;
+
+        /** The nonce of the solution */
+        long m_nonce;
+
+        /** The counter of the solution */
+        uint32_t m_counter;
+
+        /** The hash rate reported by each worker for the current job */
+        std::map<std::string,double> m_rates;
+
+        /** The hash rate of the local miner during the last job */
+        double m_local_rate;
+
+        /** Checked while waiting. Mining stops if it returns true */
+        std::function<bool()> m_interrupt;
+
+        /** \brief Accept the next connection */
+        void listen();
+
+        /** A worker's connection while its request is read */
+        struct Connection;
+
+        /** \brief Accept the next worker, then start reading the
+                   request from this one with a deadline
+            \param t_socket The connected socket
+        */
+        void handle( boost::shared_ptr<boost::asio::ip::tcp::socket> t_socket );
+
+        /** \brief Parse the header of a request and read the rest of it
+            \param t_connection The connection being read
+            \param t_error The result of reading up to the end of the header
+        */
+        void read_header( boost::shared_ptr<Connection> t_connection, const boost::system::error_code& t_error );
+
+        /** \brief Add the body to a request and respond to it
+            \param t_connection The connection being read
+            \param t_error The result of reading the body
+        */
+        void read_body( boost::shared_ptr<Connection> t_connection, const boost::system::error_code& t_error );
+
+        /** \brief Route a request that was read by url and write the response
+            \param t_connection The connection to respond on
+        */
+        void respond( boost::shared_ptr<Connection> t_connection );
+
+        /** \brief Save the hash rate a worker reported
+            \param t_request The request from the worker
+        */
+        void report( Request& t_request );
+
+        /** \brief Fill a response with the next work unit
+            \param t_response The response to fill
+        */
+        void work( Response& t_response );
+
+        /** \brief Check a solution sent by a worker
+            \param t_request The request with the solution
+            \param t_response The response to fill
+        */
+        void solution( Request& t_request, Response& t_response );
+
+    public:
+
+        /** \brief Create a MiningServer
+            \param t_port The port to listen on (0 picks a free port)
+            \param t_unit The number of counters in each work unit
+        */
+        MiningServer( unsigned short t_port = 0, uint64_t t_unit = (1 << 20) );
+
+        /** \brief Stop the server */
+        ~MiningServer();
+
+        /** \brief Start accepting workers */
+        void start();
+
+        /** \brief Stop accepting workers and end any mining */
+        void stop();
+
+        /** \brief Get the port the server is listening on
+            \returns The port number
+        */
+        unsigned short get_port(){ return m_port; }
+
+        /** \brief Mine a signed record with remote workers and,
+                   optionally, local threads
+            \param t_record The record to mine
+            \param t_local A Miner to mine with locally at the same time (may be null)
+            \returns The valid hash of the record, or an empty string
+                     if mining was interrupted or the server stopped
+        */
+        std::string mine( BaseRecord* t_record, Miner* t_local = nullptr );
+
+        /** \brief Set a check that is called while mining. If it returns
+                   true, mining stops and the record is left unchanged.
+            \param t_interrupt The check to call
+        */
+        void set_interrupt( std::function<bool()> t_interrupt ){ m_interrupt = t_interrupt; }
+
+        /** \brief Get the number of workers that reported during the current (or last) job
+            \returns The number of workers
+        */
+        size_t get_workers();
+
+        /** \brief Get the combined hash rate of the workers and the local miner
+            \returns The hashes/sec of the whole pool
+        */
+        double get_hash_rate();
+
+};
+
+/** \brief The MiningWorker class connects to a MiningServer, mines
+           the units it hands out and sends back any solutions.
+*/
+class MiningWorker {
+
+    private:
+
+        /** The address of the server */
+        std::string m_host;
+
+        /** The port of the server */
+        std::string m_port;
+
+        /** The name this worker reports as */
+        std::string m_name;
+
+        /** The miner used for each unit */
+        Miner m_miner;
+
+        /** Set to stop the worker */
+        std::atomic<bool> m_stopped;
+
+        /** The number of units mined */
+        std::atomic<uint64_t> m_units;
+
+        /** The number of solutions accepted */
+        std::atomic<uint64_t> m_solutions;
+
+        /** \brief Send a request to the server and read the response
+            \param t_request The request to send
+            \param t_response Set to the response
+            \returns False if the server couldn't be reached
+        */
+        bool exchange( Request& t_request, Response& t_response );
+
+    public:
+
+        /** \brief Create a worker for a server
+            \param t_host The address of the server
+            \param t_port The port of the server
+            \param t_threads The number of mining threads (0 for one per core)
+        */
+        MiningWorker( std::string t_host, std::string t_port, size_t t_threads = 0 );
+
+        /** \brief Empty destructor */
+        ~MiningWorker();
+
+        /** \brief Mine units until the server goes away or stop is called
+            \param t_units The most units to mine (0 for no limit)
+            \returns The number of units mined
+        */
+        uint64_t run( uint64_t t_units = 0 );
+
+        /** \brief Stop the worker after the current unit */
+        void stop();
+
+        /** \brief Get the number of units mined
+            \returns The number of units
+        */
+        uint64_t get_units(){ return m_units; }
+
+        /** \brief Get the number of solutions the server accepted
+            \returns The number of solutions
+        */
+        uint64_t get_solutions(){ return m_solutions; }
+
+        /** \brief Get the hash rate of the last unit
+            \returns The hashes/sec of this worker
+        */
+        double get_hash_rate(){ return m_miner.get_hash_rate(); }
+
+};
+
+#endif
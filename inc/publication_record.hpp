@@ -69,6 +69,15 @@ class PublicationRecord : virtual public BaseRecord {
             t_archive & m_reference;
         }
 
+        /** \brief Append the reference to a binary encoding
+            \param t_out The encoding to append to
+        */
+        void encode_fields( std::string& t_out );
+
+        /** \brief Free the fields of the record when a view is released
+        */
+        void release_fields();
+
 	public:
 
         /** \brief Empty constructor */
@@ -83,28 +92,43 @@ class PublicationRecord : virtual public BaseRecord {
         /** \brief Get the reference (hash) of a published document
             \returns The reference to the published document
         */
-        std::string get_reference(){ return m_reference; };
+        std::string get_reference(){ decode(); return m_reference; };
 
         /** \brief Set the reference (hash) of a published document
             \param t_reference The reference to the document
         */
-        void set_reference( std::string t_reference ){ m_reference = t_reference; };
+        void set_reference( std::string t_reference ){ materialize(); m_reference = t_reference; invalidate(); };
 
-        /** \brief Check if Record is internally valid
-            \returns True if Record is valid
+        /** \brief Check that the fields are present and not too large
+            \returns True if Record is well formed
         */
-        bool is_valid();
+        bool is_well_formed();
 
         /** \brief Get the concatenated data for signing
             \returns The data of the record as a string
         */
         std::string get_data();
 
+        /** \brief Write the record to a binary chain file
+            \param t_archive The archive to write to
+        */
+        void save_binary( cereal::PortableBinaryOutputArchive& t_archive );
+
+        /** \brief Read the record from a binary chain file
+            \param t_archive The archive to read from
+        */
+        void load_binary( cereal::PortableBinaryInputArchive& t_archive );
+
         /** \brief Get the serialized Record as a string
             \returns The Record as a string
         */
         std::string to_string();
 
+        /** \brief Get a copy of the Record
+            \returns A pointer to the new copy
+        */
+        std::shared_ptr<BaseRecord> clone();
+
 
 };
 
@@ -88,7 +88,10 @@ class Remote {
         */
         ~Remote();
 
-        /** \brief set the handler for received records 
+        /** \brief set the handler for received records. Records are
+                   only passed on after their structure, work and
+                   signature are checked; the handler has to check the
+                   link against its chain.
             \param function The function to pass received records too
         */
         void callback( const std::function<void(std::shared_ptr<BaseRecord>)>& function ){
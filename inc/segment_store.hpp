@@ -0,0 +1,277 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+
+/**	\file  segment_store.hpp
+    \brief Defines the SegmentStore class that keeps the records of
+           a Blockchain in an append-only log of segment files
+*/
+
+#ifndef _RECHAIN_SEGMENTSTORE_HPP_
+#define _RECHAIN_SEGMENTSTORE_HPP_
+
+// system includes
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// local includes
+#include "base_record.hpp"
+#include "compressor.hpp"
+
+/** \brief The position of a segment in the chain, as written
+           to the manifest
+*/
+struct Segment {
+    std::string name;       /**< The file name of the segment */
+    uint64_t first;         /**< The height of the first record in the segment */
+    uint64_t records;       /**< The number of records in the segment */
+    std::string tip;        /**< The hash of the last record in the segment */
+    bool sealed;            /**< True if the segment will never change again */
+};
+
+/** \brief The SegmentStore class appends records to segment files in
+           a directory. Each record is framed with its length and a
+           crc32, and is written once and never rewritten. Full segments
+           are sealed, and a small manifest tracks the segments and the
+           tip. A record that was only partly written when the process
+           stopped is cut off the open segment when it's next opened.
+           Sealed segments can be compressed whole with a dictionary
+           shared by the store, so reading one still only needs that one.
+           Compression happens when the store is opened, not when a
+           segment is sealed, so appending never waits on it.
+*/
+class SegmentStore {
+
+    private:
+
+        /** The directory that holds the segments and manifest */
+        std::string m_directory;
+
+        /** The number of records written to a segment before it's sealed */
+        size_t m_segment_size;
+
+        /** The number of records appended between each fsync */
+        size_t m_batch;
+
+        /** The segments in chain order, the last one is open */
+        std::vector<Segment> m_segments;
+
+        /** The file descriptor of the open segment (or -1) */
+        int m_fd;
+
+        /** The file descriptor of the locked lock file (or -1) */
+        int m_lock;
+
+        /** The length of the open segment in bytes */
+        uint64_t m_length;
+
+        /** The number of records known to be on disk */
+        uint64_t m_synced;
+
+        /** True if records were appended since the manifest was written */
+        bool m_stale;
+
+        /** True if sealed segments are mapped and read as views */
+        bool m_mapped;
+
+        /** True if sealed segments are compressed when the store is opened */
+        bool m_compressed;
+
+        /** Compresses sealed segments with the store's dictionary */
+        Compressor m_compressor;
+
+        /** \brief Get the full path of a file in the store
+            \param t_name The name of the file
+            \returns The path to the file
+        */
+        std::string path( std::string t_name );
+
+        /** \brief Lock the store for this writer
+            \returns True if the lock is held, false if another
+                     store already has it
+        */
+        bool lock();
+
+        /** \brief Read the manifest into m_segments
+            \returns True if there was a manifest and it could be read
+        */
+        bool read_manifest();
+
+        /** \brief Replace the manifest with the current segments
+            \returns True if the manifest was written
+        */
+        bool write_manifest();
+
+        /** \brief Read the records framed in a segment
+            \param t_segment The segment to read
+            \param t_records The records to append to
+            \param t_length Set to the length of the valid records, with the header
+            \param t_map Map the segment and add records as views, which
+                         check their crc32 when they're decoded
+            \returns True if every record in the segment was read
+        */
+        bool read_segment( const Segment& t_segment, std::vector< std::shared_ptr<BaseRecord> >& t_records, size_t& t_length, bool t_map );
+
+        /** \brief Open the last segment for appending, creating it if needed
+            \returns True if the segment is open
+        */
+        bool open_segment();
+
+        /** \brief Seal the open segment and start a new one
+            \returns True if the segment was sealed
+        */
+        bool seal();
+
+        /** \brief Read the store's dictionary, if it has one
+            \returns False if there is a dictionary that can't be read
+        */
+        bool read_dictionary();
+
+        /** \brief Build and write the store's dictionary from the
+                   records in a segment
+            \param t_segment The segment to sample
+            \returns True if the dictionary was written
+        */
+        bool train( const Segment& t_segment );
+
+        /** \brief Replace a sealed segment with a compressed copy
+            \param t_segment The segment to compress
+            \returns True if the segment was compressed
+        */
+        bool compress( Segment& t_segment );
+
+    public:
+
+        /** \brief Constructor
+            \param t_directory The directory to keep segments in
+            \param t_segment_size The number of records in each segment
+            \param t_batch The number of records appended between each fsync
+        */
+        SegmentStore( std::string t_directory, size_t t_segment_size = 10000, size_t t_batch = 64 );
+
+        /** \brief Syncs and closes the open segment
+        */
+        ~SegmentStore();
+
+        /** \brief Check if a directory holds a SegmentStore
+            \param t_directory The directory to check
+            \returns True if there is a manifest in the directory
+        */
+        static bool exists( std::string t_directory );
+
+        /** \brief Read every record in the store, creating the store if it
+                   doesn't exist yet and truncating a torn record at the
+                   end of the open segment
+            \param t_records The records that were read, in chain order
+            \returns True if the store was opened, false if a sealed
+                     segment is damaged, the directory can't be used or
+                     another store already has it open
+        */
+        bool open( std::vector< std::shared_ptr<BaseRecord> >& t_records );
+
+        /** \brief Append a record to the open segment
+            \param t_record The record to append
+            \returns True if the record was written
+        */
+        bool append( std::shared_ptr<BaseRecord> t_record );
+
+        /** \brief Flush appended records to disk. The manifest is only
+                   rewritten when a segment is sealed or the store is
+                   closed, since the open segment is read to its end.
+            \returns True if everything appended so far is on disk
+        */
+        bool sync();
+
+        /** \brief Start a sync that can finish while more records are
+                   appended, so several writers can share it
+            \param t_fd Set to a descriptor to give to flush, or -1 if
+                        everything is already on disk
+            \returns The number of records the sync will cover
+        */
+        uint64_t begin_sync( int& t_fd );
+
+        /** \brief Flush and close a descriptor from begin_sync. This
+                   doesn't use the store, so it doesn't need its lock.
+            \param t_fd The descriptor to flush (or -1)
+            \returns True if the descriptor was flushed
+        */
+        static bool flush( int t_fd );
+
+        /** \brief Finish a sync started by begin_sync
+            \param t_height The number of records it covered
+        */
+        void end_sync( uint64_t t_height );
+
+        /** \brief Get the number of records known to be on disk
+            \returns The number of synced records
+        */
+        uint64_t get_synced(){ return m_synced; }
+
+        /** \brief Get the number of records in the store
+            \returns The number of records
+        */
+        uint64_t size();
+
+        /** \brief Get the hash of the last record in the store
+            \returns The hash of the last record or an empty string
+        */
+        std::string tip();
+
+        /** \brief Choose whether sealed segments are mapped when the
+                   store is opened. Records in mapped segments are views
+                   that share the page cache and are only decoded when
+                   they're used. This is the default. Compressed
+                   segments aren't mapped: they're inflated into memory
+                   and their records are views into that copy.
+            \param t_mapped True to map sealed segments
+        */
+        void set_mapped( bool t_mapped ){ m_mapped = t_mapped; }
+
+        /** \brief Check whether sealed segments are mapped
+            \returns True if sealed segments are mapped
+        */
+        bool get_mapped(){ return m_mapped; }
+
+        /** \brief Choose whether sealed segments are compressed. They're
+                   compressed by open, so a segment sealed while appending
+                   stays uncompressed until the store is opened again.
+                   The open segment is never compressed, and compressed
+                   segments are read whatever this is set to. The
+                   default is to leave segments uncompressed.
+            \param t_compressed True to compress sealed segments
+        */
+        void set_compressed( bool t_compressed ){ m_compressed = t_compressed; }
+
+        /** \brief Check whether sealed segments are compressed
+            \returns True if sealed segments are compressed
+        */
+        bool get_compressed(){ return m_compressed; }
+
+        /** \brief Get the segments in chain order
+            \returns The segments, the last one is open
+        */
+        std::vector<Segment> get_segments(){ return m_segments; }
+
+};
+
+#endif
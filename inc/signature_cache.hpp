@@ -0,0 +1,158 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+
+/**	\file  signature_cache.hpp
+    \brief Defines the SignatureCache class that remembers signatures
+           that were verified on an earlier run
+*/
+
+#ifndef _RECHAIN_SIGNATURECACHE_HPP_
+#define _RECHAIN_SIGNATURECACHE_HPP_
+
+// system includes
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <unordered_set>
+
+// local includes
+#include "base_record.hpp"
+
+/** \brief The SignatureCache class remembers records whose signatures
+           have been verified, by a digest of the signed data and a
+           digest of the signature. It's kept in a file next to the
+           chain, so a restart only hashes records it already checked
+           instead of verifying them again. The file ends with an HMAC
+           keyed by a secret that never leaves the machine, and isn't
+           trusted if the HMAC doesn't match. Until the cache is
+           opened every signature is verified.
+*/
+class SignatureCache {
+
+    private:
+
+        /** Guards everything but the counters */
+        static std::mutex m_mutex;
+
+        /** The entries of verified signatures */
+        static std::unordered_set<std::string> m_entries;
+
+        /** The file the cache is read from and saved to */
+        static std::string m_path;
+
+        /** The key of the file's HMAC */
+        static std::string m_secret;
+
+        /** True once the cache is opened */
+        static std::atomic<bool> m_open;
+
+        /** True to verify every signature, even ones in the cache */
+        static std::atomic<bool> m_forced;
+
+        /** True if entries were added since the file was written */
+        static bool m_stale;
+
+        /** The number of signatures found in the cache */
+        static std::atomic<uint64_t> m_hits;
+
+        /** The number of signatures that had to be verified */
+        static std::atomic<uint64_t> m_misses;
+
+        /** \brief Compute the HMAC of the cache contents
+            \param t_data The contents to authenticate
+            \returns The raw HMAC
+        */
+        static std::string mac( const std::string& t_data );
+
+    public:
+
+        /** \brief Get the entry for a record's signature
+            \param t_record The record
+            \returns A digest of the signed data and a digest of the signature
+        */
+        static std::string entry( BaseRecord* t_record );
+
+        /** \brief Check if a signature was verified before
+            \param t_entry The entry from SignatureCache::entry
+            \returns True if the cache is open, not forced, and has the entry
+        */
+        static bool contains( const std::string& t_entry );
+
+        /** \brief Remember a signature that was verified
+            \param t_entry The entry from SignatureCache::entry
+        */
+        static void add( const std::string& t_entry );
+
+        /** \brief Start remembering signatures, reading the ones in a file
+                   if its HMAC matches
+            \param t_path The file to read and save to
+            \param t_secret The key of the HMAC
+            \returns True if the file was read or doesn't exist yet,
+                     false if it isn't trusted and was ignored
+        */
+        static bool open( std::string t_path, std::string t_secret );
+
+        /** \brief Write the cache to its file, if anything was added
+            \returns True if the cache is on disk
+        */
+        static bool save();
+
+        /** \brief Save the cache and stop using it, forgetting every entry
+        */
+        static void close();
+
+        /** \brief Check if the cache is in use
+            \returns True once the cache is opened
+        */
+        static bool is_open(){ return m_open; }
+
+        /** \brief Verify every signature, without looking in the cache.
+                   Signatures that pass are still remembered.
+            \param t_forced True to verify every signature
+        */
+        static void set_forced( bool t_forced ){ m_forced = t_forced; }
+
+        /** \brief Read the local secret, creating it the first time
+            \param t_path The file that holds the secret
+            \returns The secret, or an empty string if it can't be read or made
+        */
+        static std::string load_secret( std::string t_path );
+
+        /** \brief Get the number of entries
+            \returns The number of verified signatures
+        */
+        static size_t size();
+
+        /** \brief Get the number of signatures found in the cache
+            \returns The number of hits
+        */
+        static uint64_t get_hits(){ return m_hits; }
+
+        /** \brief Get the number of signatures that had to be verified
+            \returns The number of misses
+        */
+        static uint64_t get_misses(){ return m_misses; }
+
+};
+
+#endif
@@ -69,6 +69,15 @@ class SignatureRecord : virtual public BaseRecord {
             t_archive & m_record_hash;
         }
 
+        /** \brief Append the signed record hash to a binary encoding
+            \param t_out The encoding to append to
+        */
+        void encode_fields( std::string& t_out );
+
+        /** \brief Free the fields of the record when a view is released
+        */
+        void release_fields();
+
 	public:
 
         /** \brief Empty constructor */
@@ -83,28 +92,43 @@ class SignatureRecord : virtual public BaseRecord {
         /** \brief Get the reference-hash of a PublicationRecord
             \returns The reference to the PublicationRecord
         */
-        std::string get_record_hash(){ return m_record_hash; };
+        std::string get_record_hash(){ decode(); return m_record_hash; };
 
         /** \brief Set the hash of the referenced PublicationRecord
             \param t_record_hash The hash of the PublicationRecord
         */
-        void set_record_hash( std::string t_record_hash ){ m_record_hash = t_record_hash; };
+        void set_record_hash( std::string t_record_hash ){ materialize(); m_record_hash = t_record_hash; invalidate(); };
 
-        /** \brief Check if Record is internally valid
-            \returns True if Record is valid
+        /** \brief Check that the fields are present and not too large
+            \returns True if Record is well formed
         */
-        bool is_valid();
+        bool is_well_formed();
 
         /** \brief Get the concatenated data for signing
             \returns The data of the record as a string
         */
         std::string get_data();
 
+        /** \brief Write the record to a binary chain file
+            \param t_archive The archive to write to
+        */
+        void save_binary( cereal::PortableBinaryOutputArchive& t_archive );
+
+        /** \brief Read the record from a binary chain file
+            \param t_archive The archive to read from
+        */
+        void load_binary( cereal::PortableBinaryInputArchive& t_archive );
+
         /** \brief Get the serialized Record as a string
             \returns The Record as a string
         */
         std::string to_string();
 
+        /** \brief Get a copy of the Record
+            \returns A pointer to the new copy
+        */
+        std::shared_ptr<BaseRecord> clone();
+
 };
 
 BOOST_CLASS_EXPORT_KEY(SignatureRecord)
@@ -29,6 +29,12 @@
 #include <cctype>
 #include <stdio.h>
 #include <locale>
+#include <string>
+#include <fstream>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 // dependency includes
 #include <boost/filesystem/path.hpp>
@@ -110,6 +116,40 @@ namespace rechain {
     static inline bool copy_file( fs::path from, fs::path to, bool overwrite ){
         return copy_file(from.string(),to.string(),overwrite);
     }
+
+    /** \brief Sync a finished temporary file to disk and rename it over
+               a path, then sync the directory so the rename is on disk
+               too. A crash at any point leaves the old file or the new
+               one, never part of either.
+        \param temporary The full path of the temporary file
+        \param path The full path to replace
+        \returns True if the file was replaced
+    */
+    static inline bool replace_file( std::string temporary, std::string path ){
+        int fd = ::open(temporary.c_str(),O_RDONLY);
+        if(fd < 0)
+            return false;
+
+        bool synced = ::fsync(fd) == 0;
+        ::close(fd);
+
+        if(!synced || std::rename(temporary.c_str(),path.c_str()) != 0){
+            std::remove(temporary.c_str());
+            return false;
+        }
+
+        std::string directory = fs::path(path).parent_path().string();
+        if(directory.empty())
+            directory = ".";
+
+        int parent = ::open(directory.c_str(),O_RDONLY);
+        if(parent >= 0){
+            ::fsync(parent);
+            ::close(parent);
+        }
+
+        return true;
+    }
 }
 
 #endif
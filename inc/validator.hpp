@@ -0,0 +1,143 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+
+/**	\file  validator.hpp
+    \brief Defines the Validator class that checks records in
+           stages, cheapest first
+*/
+
+#ifndef _RECHAIN_VALIDATOR_HPP_
+#define _RECHAIN_VALIDATOR_HPP_
+
+// system includes
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+// local includes
+#include "base_record.hpp"
+
+/** The least work a record from a peer needs, in leading zero bits,
+    however low the local difficulty is set */
+#define MIN_REMOTE_DIFFICULTY 12
+
+/** \brief The Validator class checks a record in stages that each cost
+           more than the one before, and stops at the first one that
+           fails. A record that isn't mined is turned away after one
+           SHA256 instead of a key parse and signature check. Records
+           in the chain go through every stage. Records from peers
+           arrive with no chain to link against, so ingress checks
+           the structure, work and signature, and the link is checked
+           when the record is added to a chain. Their work is held to
+           at least MIN_REMOTE_DIFFICULTY. The number turned
+           away at each stage is counted.
+*/
+class Validator {
+
+    public:
+
+        /** The stages of a check, in the order they're run */
+        enum Stage {
+            Structure,  /**< The fields are present and not too large */
+            Work,       /**< The hash meets the difficulty */
+            Link,       /**< The record fits the chain it's joining */
+            Key,        /**< The public key can be parsed */
+            Signature,  /**< The signature matches the key */
+            Passed      /**< Every stage passed */
+        };
+
+        /** Checks a record against the chain it's joining */
+        typedef std::function<bool()> link_t;
+
+    private:
+
+        /** The number of records turned away at each stage */
+        static std::atomic<uint64_t> s_rejected[Passed];
+
+        /** The number of records that passed every stage */
+        static std::atomic<uint64_t> s_passed;
+
+        /** \brief Count a record turned away
+            \param t_stage The stage it failed
+            \returns The stage
+        */
+        static Stage reject( Stage t_stage );
+
+        /** \brief Check a record at a difficulty, stopping at the first
+                   stage it fails
+            \param t_record The record to check
+            \param t_link A check against the chain, or empty to skip it
+            \param t_difficulty The leading zero bits the work stage needs
+            \returns The stage that failed, or Passed
+        */
+        static Stage check( BaseRecord* t_record, const link_t& t_link, unsigned int t_difficulty );
+
+    public:
+
+        /** \brief Check a record, stopping at the first stage it fails
+            \param t_record The record to check
+            \param t_link A check against the chain, or empty to skip it
+            \returns The stage that failed, or Passed
+        */
+        static Stage check( BaseRecord* t_record, const link_t& t_link = link_t() );
+
+        /** \brief Check a record from a peer. The difficulty is set per
+                   process rather than by the chain, so a peer's record
+                   needs at least MIN_REMOTE_DIFFICULTY bits of work
+                   even if this node runs at a lower difficulty.
+            \param t_record The record to check
+            \returns The stage that failed, or Passed
+        */
+        static Stage check_remote( BaseRecord* t_record );
+
+        /** \brief Run only the link stage, for callers that check the
+                   other stages somewhere else
+            \param t_link A check against the chain
+            \returns True if the link is good
+        */
+        static bool check_link( const link_t& t_link );
+
+        /** \brief Get the number of records turned away at a stage
+            \param t_stage The stage
+            \returns The number rejected
+        */
+        static uint64_t get_rejected( Stage t_stage );
+
+        /** \brief Get the number of records that passed every stage
+            \returns The number passed
+        */
+        static uint64_t get_passed(){ return s_passed; }
+
+        /** \brief Get the name of a stage, for logging
+            \param t_stage The stage
+            \returns The name of the stage
+        */
+        static std::string get_name( Stage t_stage );
+
+        /** \brief Set every counter to zero
+        */
+        static void reset();
+
+};
+
+#endif
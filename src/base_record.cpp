@@ -22,21 +22,36 @@
 // system includes
 #include <string>
 #include <sstream>
-#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <istream>
+#include <cctype>
 
 // dependency includes
 #include <cryptopp/files.h>     // for FileSou
-#include <cryptopp/osrng.h>     // for the AutoSeededRandomPool
-#include <cryptopp/integer.h>   // for Integer data type
 #include <cryptopp/hex.h>       // for the HexEncoder
+#include <cryptopp/sha.h>       // for SHA256
 
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 
+#include <cereal/archives/portable_binary.hpp>
+#include <cereal/types/string.hpp>
+
+#include <boost/crc.hpp>
+
 // local includes
 #include "base_record.hpp"
 #include "enums.hpp"
 #include "keys.hpp"
+#include "validator.hpp"
+#include "miner.hpp"
+#include "lane_hasher.hpp"
+#include "genesis_record.hpp"
+#include "publication_record.hpp"
+#include "signature_record.hpp"
+#include "logger.hpp"
 
 // ----------------------------------------------------------------------------
 // Name:
@@ -45,98 +60,567 @@
 //      Constructor that inits default values
 // ----------------------------------------------------------------------------
 BaseRecord::BaseRecord()
-    : m_type(RecordType::Base), m_nonce(0), m_timestamp(0), m_counter(0) {}
+    : m_type(RecordType::Base), m_format(HashFormat::Binary), m_nonce(0), m_timestamp(0), m_counter(0),
+      m_source(), m_source_size(0), m_source_crc(0), m_decoded(true) {}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::create
+// Description:
+//      Create an empty record for a type read from a file
+// ----------------------------------------------------------------------------
+std::shared_ptr<BaseRecord> BaseRecord::create( RecordType t_type ){
+
+    switch(t_type){
+        case RecordType::Genesis:     return std::make_shared<GenesisRecord>();
+        case RecordType::Publication: return std::make_shared<PublicationRecord>();
+        case RecordType::Signature:   return std::make_shared<SignatureRecord>();
+        default:                      break;
+    }
+
+    return nullptr;
+}
+
+/** \brief A read-only stream buffer over bytes it doesn't own */
+class source_buffer : public std::streambuf {
+    public:
+        source_buffer( const char* t_data, size_t t_size ){
+            char* data = const_cast<char*>(t_data);
+            setg(data,data,data + t_size);
+        }
+};
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::set_source
+// Description:
+//      Make the record a view over encoded bytes, to be decoded
+//      when a field is first used
+// ----------------------------------------------------------------------------
+void BaseRecord::set_source( std::shared_ptr<const char> t_source, size_t t_size, uint32_t t_crc ){
+
+    m_source      = t_source;
+    m_source_size = t_size;
+    m_source_crc  = t_crc;
+    m_decoded     = true;
+
+    release();
+    invalidate();
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::decode_source
+// Description:
+//      Check the crc32 of the source and read the fields from it.
+//      A damaged source leaves the fields empty, so the record isn't
+//      valid.
+// ----------------------------------------------------------------------------
+void BaseRecord::decode_source(){
+
+    m_decoded = true;
+
+    // the same bytes give the same hash
+    std::string digest = m_digest;
+    std::string hash   = m_hash;
+
+    boost::crc_32_type checksum;
+    checksum.process_bytes(m_source.get(),m_source_size);
+
+    if(checksum.checksum() != m_source_crc){
+        RCERROR("mapped record is damaged");
+        invalidate();
+        return;
+    }
+
+    try {
+        source_buffer buffer(m_source.get(),m_source_size);
+        std::istream is(&buffer);
+
+        cereal::PortableBinaryInputArchive archive(is);
+
+        uint8_t type;
+        archive(type);
+
+        load_binary(archive);
+    } catch (const cereal::Exception& e){
+        RCERROR(std::string("mapped record is damaged: ") + e.what());
+        invalidate();
+        return;
+    }
+
+    m_digest = digest;
+    m_hash   = hash;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::release
+// Description:
+//      Free the decoded fields of an unchanged view. They're decoded
+//      again from the source if they're used.
+// ----------------------------------------------------------------------------
+void BaseRecord::release(){
+
+    if(!m_source || !m_decoded){
+        return;
+    }
+
+    std::string().swap(m_previous);
+    std::string().swap(m_public_key);
+    std::string().swap(m_signature);
+
+    release_fields();
+    m_decoded = false;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::s_difficulty
+// Description:
+//      The difficulty used to mine and validate all records
+// ----------------------------------------------------------------------------
+std::atomic<unsigned int> BaseRecord::s_difficulty(DEFAULT_DIFFICULTY);
 
 // ----------------------------------------------------------------------------
 // Name:
 //      BaseRecord::hash
 // Description:
 //      Hash the BaseRecord with current values (for nonce, count etc.)
+//      or return the cached hash if nothing has changed
 // ----------------------------------------------------------------------------
 std::string BaseRecord::hash(){
 
-    // get the record as a string
-	std::string data = to_string();
+    if(m_hash.empty()){
 
-	CryptoPP::SHA256 hasher;
-	std::string hash;
+        std::string data = digest();
 
-  // hash, hex encode and save to 'hash'
-	CryptoPP::StringSource ss(data,true,
-		new CryptoPP::HashFilter(hasher,
-			new CryptoPP::HexEncoder(
-				new CryptoPP::StringSink(hash))));
+        // hex encode and save to 'm_hash'
+        CryptoPP::StringSource ss(data,true,
+            new CryptoPP::HexEncoder(
+                new CryptoPP::StringSink(m_hash)));
 
-	// return hash
-	return hash;
+    }
+
+	return m_hash;
 
 }
 
 // ----------------------------------------------------------------------------
 // Name:
-//      BaseRecord::mine
+//      BaseRecord::digest
 // Description:
-//      Mine the BaseRecord
+//      Get the raw SHA256 digest of the BaseRecord, or the cached
+//      digest if nothing has changed
 // ----------------------------------------------------------------------------
-std::string BaseRecord::mine(){
+std::string BaseRecord::digest(){
+
+    if(m_digest.empty()){
+
+        // get the record as it's hashed
+        std::string data = encode();
+
+        CryptoPP::SHA256 hasher;
+
+        // hash and save to 'm_digest'
+        CryptoPP::StringSource ss(data,true,
+            new CryptoPP::HashFilter(hasher,
+                new CryptoPP::StringSink(m_digest)));
 
-    if(m_signature.empty()){
-        throw std::invalid_argument("record has not been signed");
     }
 
-	// mine the record until it has a valid hash
-	while(hash() > HASH_MAX){
+	return m_digest;
 
-		// update the random nonce
-		CryptoPP::AutoSeededRandomPool rng;
-		m_nonce = CryptoPP::Integer(rng,
-			CryptoPP::Integer(1),
-			CryptoPP::Integer(LONG_MAX)).ConvertToLong();
+}
 
-		// update the timestamp
-		auto e = std::chrono::system_clock::now().time_since_epoch();
-		auto seconds = std::chrono::duration_cast<std::chrono::seconds>(e).count();
-		m_timestamp = (long)seconds;
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::hash_batch
+// Description:
+//      Serialize every record without a cached digest and hash
+//      them together, several lanes at a time
+// ----------------------------------------------------------------------------
+void BaseRecord::hash_batch( const std::vector< std::shared_ptr<BaseRecord> >& t_records ){
 
-        // update the counter
-        m_counter++;
+    std::vector<BaseRecord*> stale;
+    std::vector<std::string> messages;
 
-	}
+    for(auto& record : t_records){
+        if(record->m_digest.empty()){
+            stale.push_back(record.get());
+            messages.push_back(record->encode());
+        }
+    }
+
+    if(stale.empty()){
+        return;
+    }
 
-	return hash();
+    std::vector<unsigned char> digests(stale.size() * DIGEST_SIZE);
+    LaneHasher::digest(messages,digests.data());
+
+    for(size_t i = 0; i < stale.size(); ++i){
+        stale[i]->m_digest.assign((const char*)&digests[i * DIGEST_SIZE],DIGEST_SIZE);
+    }
 
 }
 
 // ----------------------------------------------------------------------------
 // Name:
-//      BaseRecord::is_valid
+//      BaseRecord::is_mined
 // Description:
-//      Checks BaseRecord-specific values and that the Record is
-//      signed and mined correctly.
+//      Check the current digest against the difficulty
 // ----------------------------------------------------------------------------
-bool BaseRecord::is_valid(){
-  bool valid = true;
+bool BaseRecord::is_mined(){
+    return is_mined(get_difficulty());
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::is_mined
+// Description:
+//      Check the current digest against a given difficulty
+// ----------------------------------------------------------------------------
+bool BaseRecord::is_mined( unsigned int t_bits ){
+    std::string data = digest();
+    return meets_difficulty((const unsigned char*)data.data(),t_bits);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::set_difficulty
+// Description:
+//      Set the number of leading zero bits for mining and validation
+// ----------------------------------------------------------------------------
+void BaseRecord::set_difficulty( unsigned int t_bits ){
+
+    if(t_bits > DIGEST_SIZE*8){
+        throw std::invalid_argument("difficulty is larger than the digest");
+    }
+
+    s_difficulty = t_bits;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::get_difficulty
+// Description:
+//      Get the number of leading zero bits for mining and validation
+// ----------------------------------------------------------------------------
+unsigned int BaseRecord::get_difficulty(){
+    return s_difficulty;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::meets_difficulty
+// Description:
+//      Compare the digest one big-endian 32-bit word at a time: every
+//      whole word covered by the difficulty must be zero, and the
+//      remaining high bits of the next word must be zero.
+// ----------------------------------------------------------------------------
+bool BaseRecord::meets_difficulty( const unsigned char* t_digest, unsigned int t_bits ){
+
+    for(unsigned int i = 0; i < DIGEST_SIZE && t_bits > 0; i += 4){
+
+        uint32_t word = ((uint32_t)t_digest[i]   << 24) |
+                        ((uint32_t)t_digest[i+1] << 16) |
+                        ((uint32_t)t_digest[i+2] << 8)  |
+                        ((uint32_t)t_digest[i+3]);
+
+        if(t_bits < 32){
+            return (word >> (32 - t_bits)) == 0;
+        }
+
+        if(word != 0){
+            return false;
+        }
+
+        t_bits -= 32;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::encode_integer
+// Description:
+//      Append the low bytes of an integer, least significant first
+// ----------------------------------------------------------------------------
+void BaseRecord::encode_integer( std::string& t_out, uint64_t t_value, size_t t_bytes ){
+    for(size_t i = 0; i < t_bytes; ++i){
+        t_out.push_back((char)(t_value >> (8*i)));
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::encode_string
+// Description:
+//      Append a 32-bit little-endian length and the bytes of a string
+// ----------------------------------------------------------------------------
+void BaseRecord::encode_string( std::string& t_out, const std::string& t_value ){
+    encode_integer(t_out,t_value.size(),4);
+    t_out.append(t_value);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      hex_decode
+// Description:
+//      Decode uppercase hex digits in pairs into raw bytes. Only hex
+//      that the HexEncoder could have written is decoded, so that
+//      encoding the bytes again gives back the same string.
+// ----------------------------------------------------------------------------
+static bool hex_decode( const std::string& t_value, std::string& t_result ){
+
+    // the value of each hex digit, or 0xFF for anything else
+    static const std::vector<unsigned char> digits = []{
+        std::vector<unsigned char> table(256,0xFF);
+        for(int i = 0; i < 10; ++i) table['0' + i] = i;
+        for(int i = 0; i < 6; ++i)  table['A' + i] = 10 + i;
+        return table;
+    }();
+
+    if(t_value.size() % 2 != 0){
+        return false;
+    }
+
+    t_result.resize(t_value.size()/2);
+
+    unsigned char invalid = 0;
+    for(size_t i = 0; i < t_result.size(); ++i){
+        unsigned char high = digits[(unsigned char)t_value[2*i]];
+        unsigned char low  = digits[(unsigned char)t_value[2*i+1]];
+
+        invalid |= high | low;
+        t_result[i] = (char)((high << 4) | (low & 0x0F));
+    }
+
+    return !(invalid & 0xF0);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      hex_encode
+// Description:
+//      Encode raw bytes the same way as the HexEncoder
+// ----------------------------------------------------------------------------
+static std::string hex_encode( const std::string& t_value ){
+
+    static const char* digits = "0123456789ABCDEF";
+    std::string result(2*t_value.size(),'0');
 
-  try {
+    for(size_t i = 0; i < t_value.size(); ++i){
+        result[2*i]   = digits[(unsigned char)t_value[i] >> 4];
+        result[2*i+1] = digits[(unsigned char)t_value[i] & 0x0F];
+    }
+
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::encode_digest
+// Description:
+//      Append a tag byte and the raw 32 bytes of a digest. Only hex that
+//      the HexEncoder could have written is decoded, so every value has
+//      one encoding; anything else (or an empty value) is appended as a
+//      tagged string.
+// ----------------------------------------------------------------------------
+void BaseRecord::encode_digest( std::string& t_out, const std::string& t_value ){
+
+    std::string raw;
+
+    if(t_value.size() == 2*DIGEST_SIZE && hex_decode(t_value,raw)){
+        t_out.push_back(0);
+        t_out.append(raw);
+    }
+    else {
+        t_out.push_back(1);
+        encode_string(t_out,t_value);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::encode
+// Description:
+//      Get the bytes that are hashed for the format of the record
+// ----------------------------------------------------------------------------
+std::string BaseRecord::encode(){
+    decode();
+    return (m_format == HashFormat::Text) ? to_string() : encode_binary();
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::encode_binary
+// Description:
+//      Encode the format and type, the previous hash, the public key,
+//      the fields of the record type, the signature and last of all
+//      the hashing variables
+// ----------------------------------------------------------------------------
+std::string BaseRecord::encode_binary(){
+
+    decode();
+
+    std::string data;
+    data.reserve(1024);
+
+    data.push_back((char)HashFormat::Binary);
+    data.push_back((char)m_type);
+
+    encode_digest(data,m_previous);
+    encode_string(data,m_public_key);
+    encode_fields(data);
+    encode_string(data,m_signature);
+
+    data.append(hashing_data(m_nonce,m_timestamp,m_counter,HashFormat::Binary));
+
+    return data;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::split
+// Description:
+//      Encode the record with two different sets of hashing values
+//      and use the first and last bytes that differ to find where the
+//      nonce starts and the counter ends. The text values must have
+//      the same length and the binary values must differ in their
+//      first and last bytes.
+// ----------------------------------------------------------------------------
+bool BaseRecord::split( std::string& t_prefix, std::string& t_suffix ){
+
+    decode();
+
+    long nonce       = m_nonce;
+    long timestamp   = m_timestamp;
+    uint32_t counter = m_counter;
+
+    m_nonce = 1; m_timestamp = 1; m_counter = 1;
+    std::string first = encode();
+
+    if(m_format == HashFormat::Text){
+        m_nonce = 2; m_timestamp = 2; m_counter = 2;
+    }
+    else {
+        m_nonce = -1; m_timestamp = -1; m_counter = UINT32_MAX;
+    }
+    std::string second = encode();
 
-      // if the public key is bad this will throw
-      std::shared_ptr<PublicKey> key(PublicKey::load_string(m_public_key));
+    m_nonce     = nonce;
+    m_timestamp = timestamp;
+    m_counter   = counter;
 
-      // check if the signature is valid
-      if(!key->verify( this )){
-          valid = false;
-      }
+    if(first.size() != second.size()){
+        return false;
+    }
+
+    auto diff = std::mismatch(first.begin(),first.end(),second.begin());
+    if(diff.first == first.end()){
+        return false;
+    }
 
-      // check if the Record has been mined
-      if(hash() > HASH_MAX){
-          valid = false;
-      }
+    size_t start = diff.first - first.begin();
 
-  } catch (const CryptoPP::InvalidArgument& e){
-      valid = false;
-  }
+    auto rdiff = std::mismatch(first.rbegin(),first.rend(),second.rbegin());
+    size_t end = first.size() - (rdiff.first - first.rbegin());
+
+    // the bytes between should be exactly the serialized values
+    if(first.substr(start,end - start) != hashing_data(1,1,1,m_format)){
+        return false;
+    }
 
-  return valid;
+    t_prefix = first.substr(0,start);
+    t_suffix = first.substr(end);
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::hashing_data
+// Description:
+//      Serialize the hashing values as they appear in the encoding:
+//      decimal in the text archive, or 64, 64 and 32-bit little-endian
+//      integers in the binary encoding
+// ----------------------------------------------------------------------------
+std::string BaseRecord::hashing_data( long t_nonce, long t_timestamp, uint32_t t_counter, HashFormat t_format ){
+
+    if(t_format == HashFormat::Text){
+        return std::to_string(t_nonce) + " " + 
+               std::to_string(t_timestamp) + " " + 
+               std::to_string(t_counter);
+    }
+
+    std::string data;
+
+    encode_integer(data,(uint64_t)t_nonce,8);
+    encode_integer(data,(uint64_t)t_timestamp,8);
+    encode_integer(data,t_counter,4);
+
+    return data;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::mine
+// Description:
+//      Mine the BaseRecord
+// ----------------------------------------------------------------------------
+std::string BaseRecord::mine(){
+    return mine(0);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::mine
+// Description:
+//      Mine the BaseRecord with a given number of threads
+// ----------------------------------------------------------------------------
+std::string BaseRecord::mine( size_t t_threads ){
+    materialize();
+    Miner miner(t_threads);
+    return miner.mine(this);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::is_valid
+// Description:
+//      Checks that the Record is well formed, mined and signed
+//      correctly, cheapest first.
+// ----------------------------------------------------------------------------
+bool BaseRecord::is_valid(){
+    return Validator::check(this) == Validator::Passed;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      is_hex
+// Description:
+//      Check that a field is hex and no longer than a limit
+// ----------------------------------------------------------------------------
+static bool is_hex( const std::string& t_field, size_t t_limit ){
+    return !t_field.empty() && t_field.size() <= t_limit &&
+           std::all_of(t_field.begin(),t_field.end(),[]( unsigned char c ){ return std::isxdigit(c) != 0; });
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::is_well_formed
+// Description:
+//      Checks that the key and signature look like a key and a
+//      signature, before anything is hashed or parsed
+// ----------------------------------------------------------------------------
+bool BaseRecord::is_well_formed(){
+
+    decode();
+
+    return is_hex(m_public_key,MAX_KEY_SIZE) && is_hex(m_signature,MAX_SIGNATURE_SIZE);
 }
 
 
@@ -149,6 +633,8 @@ bool BaseRecord::is_valid(){
 std::string BaseRecord::get_data(){
     std::string data;
 
+    decode();
+
     data.append(m_public_key);
     data.append(m_previous);
 
@@ -165,3 +651,83 @@ RecordType BaseRecord::get_type(){
     return m_type;
 }
 
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::save_hex
+// Description:
+//      Write a flag and the string, decoded to half its size if it's hex
+// ----------------------------------------------------------------------------
+void BaseRecord::save_hex( cereal::PortableBinaryOutputArchive& t_archive, const std::string& t_value ){
+
+    std::string raw;
+    bool decoded = hex_decode(t_value,raw);
+
+    t_archive(decoded);
+    t_archive(decoded ? raw : t_value);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::load_hex
+// Description:
+//      Read the flag and string written by save_hex
+// ----------------------------------------------------------------------------
+void BaseRecord::load_hex( cereal::PortableBinaryInputArchive& t_archive, std::string& t_value ){
+
+    bool raw;
+    std::string value;
+
+    t_archive(raw,value);
+    t_value = raw ? hex_encode(value) : value;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::save_binary
+// Description:
+//      Write the hash format and the BaseRecord fields, with the
+//      hashing variables at a fixed width
+// ----------------------------------------------------------------------------
+void BaseRecord::save_binary( cereal::PortableBinaryOutputArchive& t_archive ){
+
+    decode();
+
+    t_archive(static_cast<uint8_t>(m_format));
+
+    save_hex(t_archive,m_previous);
+    save_hex(t_archive,m_public_key);
+    save_hex(t_archive,m_signature);
+
+    t_archive((int64_t)m_nonce,
+              (int64_t)m_timestamp,
+              m_counter);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      BaseRecord::load_binary
+// Description:
+//      Read the fields written by save_binary
+// ----------------------------------------------------------------------------
+void BaseRecord::load_binary( cereal::PortableBinaryInputArchive& t_archive ){
+
+    uint8_t format;
+    int64_t nonce;
+    int64_t timestamp;
+
+    t_archive(format);
+
+    load_hex(t_archive,m_previous);
+    load_hex(t_archive,m_public_key);
+    load_hex(t_archive,m_signature);
+
+    t_archive(nonce,
+              timestamp,
+              m_counter);
+
+    m_format    = static_cast<HashFormat>(format);
+    m_nonce     = (long)nonce;
+    m_timestamp = (long)timestamp;
+
+    invalidate();
+}
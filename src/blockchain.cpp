@@ -21,15 +21,28 @@
 
 // system includes
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
 #include <utility>
 #include <math.h>
 #include <climits>
+#include <stdexcept>
+#include <algorithm>
 
 // dependency includes
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/serialization/shared_ptr.hpp>
 
+#include <boost/crc.hpp>
+
+#include <cereal/archives/portable_binary.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+#include <cereal/types/map.hpp>
+#include <cereal/types/set.hpp>
+
 // local includes
 #include "blockchain.hpp"
 #include "base_record.hpp"
@@ -39,6 +52,27 @@
 #include "logger.hpp"
 #include "keys.hpp"
 #include "enums.hpp"
+#include "utility.hpp"
+#include "compressor.hpp"
+#include "validator.hpp"
+
+/** The first bytes of a binary chain file */
+#define BINARY_MAGIC "RCHN"
+
+/** The length of BINARY_MAGIC */
+#define BINARY_MAGIC_SIZE 4
+
+/** The layout version of binary chain files written by this build */
+#define BINARY_VERSION 1
+
+/** The first bytes of a snapshot file */
+#define SNAPSHOT_MAGIC "RCSN"
+
+/** The length of SNAPSHOT_MAGIC */
+#define SNAPSHOT_MAGIC_SIZE 4
+
+/** The layout version of snapshots written by this build */
+#define SNAPSHOT_VERSION 2
 
 // ----------------------------------------------------------------------------
 // Name: 
@@ -46,7 +80,7 @@
 // Description:
 //      Construct a Blockchain
 // ----------------------------------------------------------------------------
-Blockchain::Blockchain() : max_trust(1), min_trust(0) {
+Blockchain::Blockchain() : max_trust(1), min_trust(0), m_server(), m_format(FileFormat::TextFile), m_store(), m_authors(), m_trust_basis(1), m_lost_trust(0), m_index(), m_snapshot(), m_snapshot_interval(1000), m_snapshot_height(0), m_snapshotting(false), m_full_check(false), m_compressed(false), m_syncing(false), m_invalid(0), m_validated(0) {
 }
 
 // ----------------------------------------------------------------------------
@@ -55,7 +89,16 @@ Blockchain::Blockchain() : max_trust(1), min_trust(0) {
 // Description:
 //      Called when the Blockchain is deleted
 // ----------------------------------------------------------------------------
-Blockchain::~Blockchain(){}
+Blockchain::~Blockchain(){
+
+    for(auto& job : m_jobs){
+        if(auto running = job.lock()){
+            running->cancel();
+            running->get_future().wait();
+        }
+    }
+
+}
 
 // ----------------------------------------------------------------------------
 // Name: 
@@ -65,135 +108,175 @@ Blockchain::~Blockchain(){}
 // ----------------------------------------------------------------------------
 void Blockchain::update_trust(){
 
-    if(m_blockchain.size() > 0){
-
-        // clear the trust map and set the maximum available
-        // trust to the length of the blockchain.
-        m_trust.clear();
+    std::lock_guard<std::mutex> guard(m_mutex);
 
-        // lost trust is the trust that is given
-        // to the records. they can't spend it, so it
-        // is subtracted from max trust after the trust
-        // calculation.
-        double lost_trust = 0;
+    if(m_blockchain.size() > 0){
 
         // get the distribution list from the genesis record and
         // split the max_trust between them.
-
         auto genesis = std::dynamic_pointer_cast<GenesisRecord>(m_blockchain[0]);
 
         // should have a genesis block at all times
         assert(genesis);
 
-        // get the owners of the blockchain and split the
-        // starting trust between them.
-        auto distribution = genesis->get_distribution();
-        max_trust = static_cast<double>(m_blockchain.size());
+        begin_trust(genesis,m_blockchain.size());
 
-        double partial = max_trust/distribution.size();
-        for(auto& identifier : distribution){
-            m_trust.emplace(identifier,partial);
+        for(auto& record : m_blockchain){
+            add_trust(record);
         }
 
-        // a reference map to link record hashes to authors
-        std::map<std::string,std::string> reference;
+        end_trust();
 
-        for(auto& record : m_blockchain){
-       
-            switch(record->get_type()){
-            
-                case RecordType::Publication:
-                {
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      begin_trust
+// Description:
+//      Clear the trust map and split the starting trust between
+//      the owners of the blockchain
+// ----------------------------------------------------------------------------
+void Blockchain::begin_trust( std::shared_ptr<GenesisRecord> t_genesis, size_t t_size ){
+
+    // clear the trust map and set the maximum available
+    // trust to the length of the blockchain.
+    m_trust.clear();
+    m_authors.clear();
+
+    // lost trust is the trust that is given
+    // to the records. they can't spend it, so it
+    // is subtracted from max trust after the trust
+    // calculation.
+    m_lost_trust = 0;
+
+    // get the owners of the blockchain and split the
+    // starting trust between them.
+    auto distribution = t_genesis->get_distribution();
+    max_trust = static_cast<double>(t_size);
+    m_trust_basis = max_trust;
+
+    double partial = max_trust/distribution.size();
+    for(auto& identifier : distribution){
+        m_trust.emplace(identifier,partial);
+    }
+
+}
 
-                    auto pub_record = std::dynamic_pointer_cast<PublicationRecord>(record);
+// ----------------------------------------------------------------------------
+// Name: 
+//      add_trust
+// Description:
+//      Move trust from the author or signer of a record to the
+//      record, in chain order
+// ----------------------------------------------------------------------------
+void Blockchain::add_trust( std::shared_ptr<BaseRecord> t_record ){
 
-                    if(pub_record){
+    switch(t_record->get_type()){
+    
+        case RecordType::Publication:
+        {
 
-                        std::string author = pub_record->get_public_key();
-                        std::string hash   = pub_record->hash();
+            auto pub_record = std::dynamic_pointer_cast<PublicationRecord>(t_record);
 
-                        // get a reference to the trust of both
-                        // the author and the record
-                        double& author_trust = m_trust[author];
-                        double& record_trust = m_trust[hash];
+            if(pub_record){
 
-                        // check the author has trust to give
-                        if(author_trust > 0){
+                std::string author = pub_record->get_public_key();
+                std::string hash   = pub_record->hash();
 
-                            double half_trust = (author_trust/2);
-                           
-                            // give the record half of the author's
-                            // trust
-                            author_trust = half_trust;
-                            record_trust = half_trust;
+                // get a reference to the trust of both
+                // the author and the record
+                double& author_trust = m_trust[author];
+                double& record_trust = m_trust[hash];
 
-                            // save the lost half that went 
-                            // to the record.
-                            lost_trust  += half_trust;
+                // check the author has trust to give
+                if(author_trust > 0){
 
-                            // link the hash to the author
-                            reference.emplace(hash,author);
-                        }
+                    double half_trust = (author_trust/2);
+                   
+                    // give the record half of the author's
+                    // trust
+                    author_trust = half_trust;
+                    record_trust = half_trust;
 
-                    }
+                    // save the lost half that went 
+                    // to the record.
+                    m_lost_trust += half_trust;
 
+                    // link the hash to the author
+                    m_authors.emplace(hash,author);
                 }
-                break;
 
-                case RecordType::Signature:
-                {
-
-                    auto sig_record = std::dynamic_pointer_cast<SignatureRecord>(record);
+            }
 
-                    if(sig_record){
+        }
+        break;
 
-                        // get the signer and the signer's trust
-                        std::string signer   = sig_record->get_public_key();
-                        double& signer_trust = m_trust[signer];
+        case RecordType::Signature:
+        {
 
-                        // check that they have trust to give
-                        if(signer_trust > 0){
+            auto sig_record = std::dynamic_pointer_cast<SignatureRecord>(t_record);
 
-                            std::string hash   = sig_record->get_record_hash();
-                            std::string signee = reference[hash];
+            if(sig_record){
 
-                            // remove one-half of the signer's trust
-                            double quarter_trust = (signer_trust/4);
-                            signer_trust = quarter_trust*2;
+                // get the signer and the signer's trust
+                std::string signer   = sig_record->get_public_key();
+                double& signer_trust = m_trust[signer];
 
-                            // signee and the record each get one
-                            // quarter of the signer's trust
-                            m_trust[signee] += quarter_trust;
-                            m_trust[hash]   += quarter_trust;
+                // check that they have trust to give
+                if(signer_trust > 0){
 
-                            // save the lost quarter that went 
-                            // to the record.
-                            lost_trust   += quarter_trust;
+                    std::string hash   = sig_record->get_record_hash();
+                    std::string signee = m_authors[hash];
 
-                        }
+                    // remove one-half of the signer's trust
+                    double quarter_trust = (signer_trust/4);
+                    signer_trust = quarter_trust*2;
 
-                    }
+                    // signee and the record each get one
+                    // quarter of the signer's trust
+                    m_trust[signee] += quarter_trust;
+                    m_trust[hash]   += quarter_trust;
 
-                }
-                break;
+                    // save the lost quarter that went 
+                    // to the record.
+                    m_lost_trust += quarter_trust;
 
-                default:
-                {
-                    // genesis
                 }
-                break;
 
             }
-        
+
         }
+        break;
 
-        // max_trust is used for normalizing trust values
-        // when they are requested. removing lost trust
-        // means that the normalization is relative to free
-        // trust in the system only.
-        max_trust -= lost_trust;
+        default:
+        {
+            // genesis
+        }
+        break;
 
     }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      end_trust
+// Description:
+//      Remove the trust given to records from the maximum. More
+//      records can be added after this, since trust only moves
+//      between identities and records. Every value is relative to
+//      the starting trust, so the chain growing past the size it
+//      started with doesn't change the normalized trust.
+// ----------------------------------------------------------------------------
+void Blockchain::end_trust(){
+
+    // max_trust is used for normalizing trust values
+    // when they are requested. removing lost trust
+    // means that the normalization is relative to free
+    // trust in the system only.
+    max_trust = m_trust_basis - m_lost_trust;
+
 }
 
 // ----------------------------------------------------------------------------
@@ -206,28 +289,125 @@ void Blockchain::update_trust(){
 bool Blockchain::publish( std::shared_ptr<BaseRecord> t_record, std::shared_ptr<PrivateKey> t_key ){
 
     RCDEBUG("publishing record");
+    return publish_async(t_record,t_key)->wait();
 
-    if(m_blockchain.size() > 0){
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::publish_async
+// Description:
+//      Start a MiningJob that signs and mines the record against the
+//      current tip and appends it when it's done
+// ----------------------------------------------------------------------------
+std::shared_ptr<MiningJob> Blockchain::publish_async( std::shared_ptr<BaseRecord> t_record, std::shared_ptr<PrivateKey> t_key, size_t t_threads ){
+
+    RCDEBUG("publishing record in the background");
+
+    auto job = std::make_shared<MiningJob>(t_record,t_key,
+        [this]{ return tip(); },
+        [this]( std::shared_ptr<BaseRecord> t_mined ){ return append(t_mined); },
+        t_threads,m_server);
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        // forget jobs that have already finished
+        m_jobs.erase(std::remove_if(m_jobs.begin(),m_jobs.end(),
+            []( const std::weak_ptr<MiningJob>& t_job ){ return t_job.expired(); }),
+            m_jobs.end());
+
+        m_jobs.push_back(job);
+    }
 
-        auto& last = m_blockchain.back();
-        t_record->set_previous(last->hash());
+    job->start();
+    return job;
 
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::tip
+// Description:
+//      Get the hash of the last record in the chain
+// ----------------------------------------------------------------------------
+std::string Blockchain::tip(){
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    if(m_blockchain.empty()){
+        return "";
     }
 
-    t_key->sign(t_record);
-    std::string hash = t_record->mine();
+    return m_blockchain.back()->hash();
 
-    if(t_record->is_valid()){
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::append
+// Description:
+//      Add a mined record if it's valid, unless another record
+//      was added after the one it references
+// ----------------------------------------------------------------------------
+AppendResult Blockchain::append( std::shared_ptr<BaseRecord> t_record ){
 
-        m_blockchain.push_back(t_record);
-        // remote->send( t_record );
+    std::unique_lock<std::mutex> lock(m_mutex);
 
-        RCINFO("record was published: " + hash);
-        return true;
+    std::string previous = m_blockchain.empty() ? "" : m_blockchain.back()->hash();
+
+    if(t_record->get_previous() != previous){
+        RCWARNING("record was mined on a stale tip");
+        return AppendResult::Stale;
+    }
+
+    // a chain that wasn't checked up to the tip can't vouch for the
+    // trust and links the new record is checked against
+    if(m_validated != m_blockchain.size()){
+        RCERROR("records before this one haven't been checked");
+        return AppendResult::Failed;
+    }
+
+    // the index is the state of the records before this one, so only
+    // the new record is checked, and it's checked before anything is
+    // written. the link is checked after the work and before the signature.
+    Validator::Stage stage = Validator::check(t_record.get(),[&]{ return check_link(t_record,m_index); });
+
+    if(stage != Validator::Passed){
+        RCERROR("record was rejected at the " + Validator::get_name(stage) + " stage");
+        return AppendResult::Failed;
+    }
+
+    if(m_store && !m_store->append(t_record)){
+        RCERROR("record couldn't be written to the segments");
+        return AppendResult::Failed;
+    }
+
+    if(m_blockchain.empty()){
+        auto genesis = std::dynamic_pointer_cast<GenesisRecord>(t_record);
+        if(genesis){
+            begin_trust(genesis,1);
+        }
+    }
+
+    index_record(t_record,m_blockchain.size(),m_index);
+    add_trust(t_record);
+    end_trust();
+
+    m_blockchain.push_back(t_record);
+    // remote->send( t_record );
+
+    m_validated = m_blockchain.size();
+
+    // snapshots are only of records that are on disk, and are
+    // written after the lock is released
+    if(!m_snapshot.empty() && m_store && m_blockchain.size() >= m_snapshot_height + m_snapshot_interval){
+        if(m_store->sync()){
+            save_snapshot(lock);
+        }
     }
 
-    RCERROR("record was not valid: " + hash);
-    return false;
+    return AppendResult::Appended;
 
 }
 
@@ -240,13 +420,13 @@ bool Blockchain::publish( std::shared_ptr<BaseRecord> t_record, std::shared_ptr<
 std::shared_ptr<BaseRecord> Blockchain::find_record( std::string t_hash ){
     
     RCDEBUG("searching for record with hash: " + t_hash );
-   
-    for(auto& record : m_blockchain){
-        if(record->hash() == t_hash){
+    std::lock_guard<std::mutex> guard(m_mutex);
 
-            RCDEBUG("record was found");
-            return record;
-        }
+    auto it = m_index.records.find(t_hash);
+    if(it != m_index.records.end()){
+
+        RCDEBUG("record was found");
+        return m_blockchain[it->second];
     }
 
     RCDEBUG("record not found");
@@ -263,16 +443,13 @@ std::shared_ptr<BaseRecord> Blockchain::find_record( std::string t_hash ){
 std::shared_ptr<PublicationRecord> Blockchain::find_publication( std::string t_reference ){
 
     RCDEBUG("searching for record with reference: " + t_reference);
-   
-    for(auto& record : m_blockchain){
+    std::lock_guard<std::mutex> guard(m_mutex);
 
-        auto pub_record = std::dynamic_pointer_cast<PublicationRecord>(record);
+    auto it = m_index.references.find(t_reference);
+    if(it != m_index.references.end()){
 
-        if( pub_record && pub_record->get_reference() == t_reference ){
-
-            RCDEBUG("record was found");
-            return pub_record;
-        }
+        RCDEBUG("record was found");
+        return std::dynamic_pointer_cast<PublicationRecord>(m_blockchain[it->second]);
     }
 
     RCDEBUG("record not found");
@@ -291,20 +468,17 @@ std::vector< std::shared_ptr<SignatureRecord> > Blockchain::find_signatures( std
     RCDEBUG("searching for signatures with reference: " + t_reference);
     std::vector< std::shared_ptr<SignatureRecord> > results;
 
-    auto publication = find_publication(t_reference);
-
-    if(publication){
-
-        std::string hash = publication->hash();
+    std::lock_guard<std::mutex> guard(m_mutex);
 
-        for(auto& record : m_blockchain){
+    auto reference = m_index.references.find(t_reference);
 
-            auto sig_record = std::dynamic_pointer_cast<SignatureRecord>(record);
+    if(reference != m_index.references.end()){
 
-            if( sig_record && sig_record->get_record_hash() == hash ){
+        auto it = m_index.signatures.find(m_blockchain[reference->second]->hash());
 
-                results.push_back(sig_record);
-            
+        if(it != m_index.signatures.end()){
+            for(auto position : it->second){
+                results.push_back(std::dynamic_pointer_cast<SignatureRecord>(m_blockchain[position]));
             }
         }
 
@@ -321,87 +495,269 @@ std::vector< std::shared_ptr<SignatureRecord> > Blockchain::find_signatures( std
 // Description:
 //      Check that currently loaded blockchain is valid
 // ----------------------------------------------------------------------------
-bool Blockchain::is_valid(){
+bool Blockchain::is_valid( size_t t_threads ){
     RCDEBUG("checking if blockchain is valid");
+    return validate_from(0,t_threads);
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::validate_from
+// Description:
+//      Check the records from a height to the tip. Signatures and
+//      proof of work are checked on a pool of workers, and the links
+//      and duplicates in chain order as checked records come back,
+//      so the first bad record is the same for any number of threads.
+// ----------------------------------------------------------------------------
+bool Blockchain::validate_from( uint64_t t_height, size_t t_threads ){
 
-	std::set<std::string> references;
-	std::set<std::string> hashes;
-    std::string previous;
+    // the records are copied so jobs can append while they're checked
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::vector< std::shared_ptr<BaseRecord> > records(m_blockchain);
+
+    m_invalid = 0;
 
     // check that there is a genesis record
-    if(m_blockchain.size() == 0){
+    if(records.size() == 0){
         return false;
     }
 
-    int count = 0;
+    // records after the validated height haven't been checked
+    uint64_t height = std::min(t_height,m_validated);
 
-    for(auto& record : m_blockchain){
+    if(height >= records.size()){
+        m_invalid = records.size();
+        return true;
+    }
+
+    lock.unlock();
+
+    // the records before the height are only indexed, so the
+    // rest are linked against them
+    ChainIndex index;
+    uint64_t position = 0;
+
+    for(; position < height; ++position){
+        index_record(records[position],position,index);
+    }
+
+    std::vector< std::shared_ptr<BaseRecord> > remaining(records.begin() + height,records.end());
+
+    Loader loader(t_threads);
+
+    bool valid = loader.run(remaining.size(),Loader::source(remaining),[&]( std::shared_ptr<BaseRecord> t_record ){
+
+        // the other stages ran on the workers, and links need the
+        // records before them so they're checked here
+        if(!Validator::check_link([&]{ return check_link(t_record,index); })){
+            return false;
+        }
+
+        index_record(t_record,position++,index);
+        return true;
+    });
+
+    lock.lock();
+
+    // records appended since the copy were checked by append
+    m_invalid   = valid ? m_blockchain.size() : height + loader.get_failed();
+    m_validated = m_invalid;
+
+    if(!valid){
+        RCERROR("record " + std::to_string(m_invalid) + " isn't valid");
+    }
+
+    return valid;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::check_link
+// Description:
+//      Check that a record references the one before it, that
+//      publications aren't duplicated and that signatures are for
+//      publications earlier in the chain
+// ----------------------------------------------------------------------------
+bool Blockchain::check_link( std::shared_ptr<BaseRecord> t_record, const ChainIndex& t_index ){
+
+    if(t_record->get_previous() != t_index.previous){
+        RCERROR("record doesn't reference previous");
+        return false;
+    }
+
+    switch(t_record->get_type()){
+
+        case RecordType::Publication:
+        {	
+
+            auto pub_record = std::dynamic_pointer_cast<PublicationRecord>(t_record);
+            
+            if(!pub_record){
+                RCERROR("record type is publication, record is not");
+                return false;
+            }
+
+            // a record is only a duplicate if both its reference
+            // and its hash were already published
+            if(t_index.references.count(pub_record->get_reference()) && 
+               t_index.publications.count(pub_record->hash())){
+                RCERROR("duplicate records in blockchain");
+                return false;
+            }
+
+        }	
+        break;
+
+        case RecordType::Signature:
+        {
+
+            auto sig_record = std::dynamic_pointer_cast<SignatureRecord>(t_record);
+
+            if(!sig_record){
+                RCERROR("record type is signature, record is not");
+                return false;
+            }
+
+            // try to find the referenced record by reference
+            if(!t_index.publications.count(sig_record->get_record_hash())){
+                RCERROR("signature doesn't reference pre-existing publication");
+                return false;
+            }
 
-		if(record->get_previous() != previous){
-            RCERROR("record doesn't reference previous");
-			return false;
         }
+        break;
+
+        default:
+        break;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::index_record
+// Description:
+//      Add a record to the end of an index, without checking it
+// ----------------------------------------------------------------------------
+void Blockchain::index_record( std::shared_ptr<BaseRecord> t_record, uint64_t t_position, ChainIndex& t_index ){
+
+    std::string hash = t_record->hash();
+
+    t_index.previous = hash;
+    t_index.records.emplace(hash,t_position);
 
-        count++;
+    switch(t_record->get_type()){
 
-        if(!record->is_valid()){
-            RCERROR("record isn't valid");
-			return false;
+        case RecordType::Publication:
+        {
+            auto pub_record = std::dynamic_pointer_cast<PublicationRecord>(t_record);
+
+            if(pub_record){
+                t_index.references.emplace(pub_record->get_reference(),t_position);
+                t_index.publications.insert(hash);
+            }
         }
+        break;
 
-        // update previous for the next iteration
-        previous = record->hash();
+        case RecordType::Signature:
+        {
+            auto sig_record = std::dynamic_pointer_cast<SignatureRecord>(t_record);
 
-        switch(record->get_type()){
+            if(sig_record){
+                t_index.signatures[sig_record->get_record_hash()].push_back(t_position);
+            }
+        }
+        break;
 
-            case RecordType::Publication:
-            {	
+        default:
+        break;
+    }
 
-                auto pub_record = std::dynamic_pointer_cast<PublicationRecord>(record);
-                
-                if(!pub_record){
-                    RCERROR("record type is publication, record is not");
-                    return false;
-                }
+}
 
-                // try to insert the reference and hash
-                auto r_pair = references.insert(pub_record->get_reference());
-                auto h_pair = hashes.insert(pub_record->hash());
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::reindex
+// Description:
+//      Rebuild the index for records that weren't checked
+// ----------------------------------------------------------------------------
+void Blockchain::reindex(){
 
-                // second item in pair is false if insert failed,
-                // and both pairs should insert successfully
-                if(!r_pair.second && !h_pair.second){
-                    RCERROR("duplicate records in blockchain");
-                    return false;
-                }
+    m_index = ChainIndex();
+    m_validated = 0;
 
-            }	
-            break;
+    for(size_t i = 0; i < m_blockchain.size(); ++i){
+        index_record(m_blockchain[i],i,m_index);
+    }
 
-            case RecordType::Signature:
-            {
+}
 
-                auto sig_record = std::dynamic_pointer_cast<SignatureRecord>(record);
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::stream
+// Description:
+//      Check records from a source in a Loader, then link them and
+//      build the trust and index in chain order as the checked
+//      records arrive. The records only replace the chain if all of
+//      them were good.
+// ----------------------------------------------------------------------------
+bool Blockchain::stream( std::vector< std::shared_ptr<BaseRecord> > t_records, uint64_t t_total, Loader::source_t t_source, Loader::progress_t t_progress ){
 
-                if(!sig_record){
-                    RCERROR("record type is signature, record is not");
-                    return false;
-                }
+    if(t_records.empty()){
+        m_index = ChainIndex();
+    }
 
-                // try to find the referenced record by reference
-                auto it = hashes.find(sig_record->get_record_hash());
+    // the starting trust is the size the chain will have
+    size_t expected = t_records.size() + t_total;
+    t_records.reserve(expected);
 
-                if(it == hashes.end()){
-                    RCERROR("signature doesn't reference pre-existing publication");
-                    return false;
-                }
+    Loader loader;
+    loader.set_progress(t_progress);
+
+    bool loaded = loader.run(t_total,t_source,[&]( std::shared_ptr<BaseRecord> t_record ){
+
+        if(!Validator::check_link([&]{ return check_link(t_record,m_index); })){
+            return false;
+        }
+
+        if(t_records.empty()){
+            auto genesis = std::dynamic_pointer_cast<GenesisRecord>(t_record);
 
+            if(!genesis){
+                RCERROR("blockchain doesn't start with a genesis record");
+                return false;
             }
-            break;
+
+            begin_trust(genesis,expected);
         }
+
+        add_trust(t_record);
+        index_record(t_record,t_records.size(),m_index);
+
+        // mapped records only keep their hash in memory until they're used again
+        t_record->release();
+
+        t_records.push_back(t_record);
+        return true;
+
+    });
+
+    if(!loaded || t_records.empty()){
+
+        // put back the trust and index for the records that are still here
+        m_trust.clear();
+        update_trust();
+        reindex();
+
+        return false;
     }
 
-    // all tests passed
+    end_trust();
+
+    // records before the stream were checked when they were snapshot
+    m_blockchain = t_records;
+    m_validated  = m_blockchain.size();
     return true;
 }
 
@@ -413,6 +769,7 @@ bool Blockchain::is_valid(){
 // ----------------------------------------------------------------------------
 double Blockchain::trust( std::string t_identifier ){
 
+    std::lock_guard<std::mutex> guard(m_mutex);
     auto it = m_trust.find(t_identifier);
 
     if( it != m_trust.end() ){
@@ -432,6 +789,7 @@ double Blockchain::trust( std::string t_identifier ){
 //      Get iterator to the beginning of the blockchain
 // ----------------------------------------------------------------------------
 Blockchain::iterator Blockchain::begin(){
+	check_idle();
 	return m_blockchain.begin();
 }
 
@@ -442,6 +800,7 @@ Blockchain::iterator Blockchain::begin(){
 //      Get iterator to the end of the blockchain
 // ----------------------------------------------------------------------------
 Blockchain::iterator Blockchain::end(){
+	check_idle();
 	return m_blockchain.end();
 }
 
@@ -452,62 +811,703 @@ Blockchain::iterator Blockchain::end(){
 //      Get the size of the current blockchain
 // ----------------------------------------------------------------------------
 size_t Blockchain::size(){
+	std::lock_guard<std::mutex> guard(m_mutex);
 	return m_blockchain.size();
 }
 
 // ----------------------------------------------------------------------------
 // Name: 
-//      Blockchain::save
+//      Blockchain::check_idle
 // Description:
-//      Serialize the blockchain to disk
+//      Throw if a mining job could still append, since iterators
+//      into the chain would be invalidated under the caller
 // ----------------------------------------------------------------------------
-bool Blockchain::save( std::string t_path ){
+void Blockchain::check_idle(){
 
-    RCDEBUG("saving to location: " + t_path);
-    std::ofstream os(t_path);
+    std::lock_guard<std::mutex> guard(m_mutex);
 
-    if(os.is_open()){
+    for(auto& job : m_jobs){
+        auto running = job.lock();
+        if(running && !running->is_finished()){
+            throw std::logic_error("blockchain can't be iterated while a record is being published");
+        }
+    }
 
-        boost::archive::text_oarchive archive(os);
-        archive << *this;
+}
 
-        RCINFO("blockchain was saved");
-        return true;
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::write_binary
+// Description:
+//      Write the magic header, then the layout version, the record
+//      count and each record's type and fields in a portable binary
+//      archive
+// ----------------------------------------------------------------------------
+void Blockchain::write_binary( std::ostream& t_stream ){
+
+    t_stream.write(BINARY_MAGIC,BINARY_MAGIC_SIZE);
+
+    cereal::PortableBinaryOutputArchive archive(t_stream);
+    archive((uint32_t)BINARY_VERSION,(uint64_t)m_blockchain.size());
 
+    for(auto& record : m_blockchain){
+        archive((uint8_t)record->get_type());
+        record->save_binary(archive);
     }
 
-    RCWARNING("blockchain failed to save");
-	return false;
 }
 
 // ----------------------------------------------------------------------------
 // Name: 
-//      Blockchain::load
+//      Blockchain::binary_source
 // Description:
-//      Load a serialized blockchain to memory
+//      Read the layout version and record count written by
+//      write_binary and return a source for the records after them,
+//      failing on unknown versions, unknown record types or a
+//      truncated file. The stream has to outlive the source.
 // ----------------------------------------------------------------------------
-bool Blockchain::load( std::string t_path ){
+Loader::source_t Blockchain::binary_source( std::istream& t_stream, uint64_t& t_total ){
 
-    RCDEBUG("loading from location: " + t_path);
-    std::ifstream is(t_path);
+    auto archive = std::make_shared<cereal::PortableBinaryInputArchive>(t_stream);
 
-    if(is.is_open()){
+    uint32_t version;
+    uint64_t count;
 
-        boost::archive::text_iarchive archive(is);
-        archive >> *this;
+    try {
+        (*archive)(version,count);
+    } catch (const cereal::Exception& e){
+        RCERROR(e.what());
+        return nullptr;
+    }
 
-        if(is_valid()){
-            update_trust();
+    if(version > BINARY_VERSION){
+        RCERROR("blockchain file version " + std::to_string(version) + " is newer than this build");
+        return nullptr;
+    }
 
-            RCINFO("blockchain was loaded");
-            return true;
-        }
-        else {
-            RCWARNING("blockchain loaded, but is corrupted");
+    t_total = count;
+    auto remaining = std::make_shared<uint64_t>(count);
+
+    return [archive,remaining]( Loader::chunk_t& t_chunk, size_t t_count ){
+
+        try {
+
+            for(size_t i = 0; i < t_count && *remaining > 0; ++i){
+
+                uint8_t type;
+                (*archive)(type);
+
+                auto record = BaseRecord::create((RecordType)type);
+                if(!record){
+                    RCERROR("unknown record type in blockchain file");
+                    return false;
+                }
+
+                record->load_binary(*archive);
+                t_chunk.push_back(record);
+
+                --(*remaining);
+            }
+
+        } catch (const cereal::Exception& e){
+            RCERROR(e.what());
             return false;
         }
-    }
 
-    RCWARNING("blockchain failed to load");
-	return false;
+        return true;
+    };
+
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::read_binary
+// Description:
+//      Read the records written by write_binary, failing on unknown
+//      versions, unknown record types or a truncated file
+// ----------------------------------------------------------------------------
+bool Blockchain::read_binary( std::istream& t_stream ){
+
+    uint64_t total = 0;
+    auto source = binary_source(t_stream,total);
+
+    if(!source){
+        return false;
+    }
+
+    std::vector< std::shared_ptr<BaseRecord> > records;
+    Loader::chunk_t chunk;
+
+    do {
+        chunk.clear();
+
+        if(!source(chunk,1024)){
+            return false;
+        }
+
+        records.insert(records.end(),chunk.begin(),chunk.end());
+    } while(!chunk.empty());
+
+    m_blockchain = records;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::save
+// Description:
+//      Serialize the blockchain to disk in the current file format
+// ----------------------------------------------------------------------------
+bool Blockchain::save( std::string t_path ){
+
+    RCDEBUG("saving to location: " + t_path);
+
+    // the chain is written beside the old file and renamed over it,
+    // so a crash or a full disk never leaves half a chain
+    std::string temporary = t_path + ".tmp";
+    std::ofstream os(temporary,std::ios::binary | std::ios::trunc);
+
+    if(os.is_open()){
+
+        if(m_format == FileFormat::BinaryFile){
+            write_binary(os);
+        }
+        else {
+            boost::archive::text_oarchive archive(os);
+            archive << *this;
+        }
+
+        os.close();
+
+        if(os && rechain::replace_file(temporary,t_path)){
+            RCINFO("blockchain was saved");
+            return true;
+        }
+
+        std::remove(temporary.c_str());
+    }
+
+    RCWARNING("blockchain failed to save");
+	return false;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::read
+// Description:
+//      Read a serialized blockchain to memory, in whichever format
+//      the file was written in
+// ----------------------------------------------------------------------------
+bool Blockchain::read( std::string t_path ){
+
+    RCDEBUG("reading from location: " + t_path);
+
+    if(has_store()){
+        RCWARNING("blockchain segments are open, so a file can't be read over them");
+        return false;
+    }
+
+    std::ifstream is(t_path,std::ios::binary);
+
+    if(!is.is_open()){
+        return false;
+    }
+
+    char magic[BINARY_MAGIC_SIZE] = {0};
+    is.read(magic,BINARY_MAGIC_SIZE);
+
+    if(is && std::equal(magic,magic + BINARY_MAGIC_SIZE,BINARY_MAGIC)){
+        if(!read_binary(is)){
+            return false;
+        }
+
+        m_format = FileFormat::BinaryFile;
+    }
+    else {
+        is.clear();
+        is.seekg(0);
+
+        boost::archive::text_iarchive archive(is);
+        archive >> *this;
+
+        m_format = FileFormat::TextFile;
+    }
+
+    reindex();
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::load
+// Description:
+//      Read a serialized blockchain and check that it's valid
+// ----------------------------------------------------------------------------
+bool Blockchain::load( std::string t_path ){
+    return load(t_path,nullptr);
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::load
+// Description:
+//      Read a serialized blockchain and check it in a Loader. Binary
+//      files are checked while the rest of the file is read, text
+//      archives can only be read whole so they're checked after.
+// ----------------------------------------------------------------------------
+bool Blockchain::load( std::string t_path, Loader::progress_t t_progress ){
+
+    RCDEBUG("loading from location: " + t_path);
+
+    // the records would no longer match the segments they're appended to
+    if(has_store()){
+        RCWARNING("blockchain segments are open, so a file can't be loaded over them");
+        return false;
+    }
+
+    std::ifstream is(t_path,std::ios::binary);
+
+    if(!is.is_open()){
+        RCWARNING("blockchain failed to load");
+        return false;
+    }
+
+    char magic[BINARY_MAGIC_SIZE] = {0};
+    is.read(magic,BINARY_MAGIC_SIZE);
+
+    bool loaded = false;
+    FileFormat format;
+
+    if(is && std::equal(magic,magic + BINARY_MAGIC_SIZE,BINARY_MAGIC)){
+
+        uint64_t total = 0;
+        auto source = binary_source(is,total);
+
+        if(!source){
+            RCWARNING("blockchain failed to load");
+            return false;
+        }
+
+        loaded = stream({},total,source,t_progress);
+        format = FileFormat::BinaryFile;
+    }
+    else {
+        is.clear();
+        is.seekg(0);
+
+        Blockchain text;
+        boost::archive::text_iarchive archive(is);
+        archive >> text;
+
+        loaded = stream({},text.size(),Loader::source(text.m_blockchain),t_progress);
+        format = FileFormat::TextFile;
+    }
+
+    if(!loaded){
+
+        // the records are still read, like they were before they
+        // were checked while reading, but the trust isn't updated
+        is.close();
+        read(t_path);
+
+        RCWARNING("blockchain loaded, but is corrupted");
+        return false;
+    }
+
+    // the snapshot wouldn't match the records loaded
+    m_snapshot_height = 0;
+    m_format = format;
+
+    RCINFO("blockchain was loaded");
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::open
+// Description:
+//      Read the records in a segment directory, or write the current
+//      records to it if it's new, and append to it from now on
+// ----------------------------------------------------------------------------
+bool Blockchain::open( std::string t_directory, bool t_mapped, Loader::progress_t t_progress ){
+
+    RCDEBUG("opening segments in: " + t_directory);
+
+    auto store = std::make_shared<SegmentStore>(t_directory);
+    std::vector< std::shared_ptr<BaseRecord> > records;
+
+    store->set_mapped(t_mapped);
+    store->set_compressed(m_compressed);
+
+    if(!store->open(records)){
+        RCWARNING("blockchain segments failed to open");
+        return false;
+    }
+
+    if(records.empty() && !m_blockchain.empty()){
+
+        for(auto& record : m_blockchain){
+            if(!store->append(record)){
+                return false;
+            }
+        }
+
+        if(!store->sync()){
+            return false;
+        }
+
+        update_trust();
+
+        RCINFO("imported " + std::to_string(m_blockchain.size()) + " records into segments");
+    }
+    else if(records.empty()){
+        m_blockchain.clear();
+        m_trust.clear();
+        m_index = ChainIndex();
+        m_validated = 0;
+    }
+    else {
+
+        // only the records after a matching snapshot are checked
+        uint64_t height = m_full_check ? 0 : read_snapshot(records);
+
+        std::vector< std::shared_ptr<BaseRecord> > checked(records.begin(),records.begin() + height);
+        std::vector< std::shared_ptr<BaseRecord> > remaining(records.begin() + height,records.end());
+
+        if(!stream(checked,remaining.size(),Loader::source(remaining),t_progress)){
+            m_blockchain = records;
+            reindex();
+
+            RCWARNING("blockchain segments opened, but are corrupted");
+            return false;
+        }
+
+        if(height > 0){
+            RCINFO("resumed from a snapshot of " + std::to_string(height) + " records");
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_store = store;
+
+    // the next start only has to check records appended after this
+    if(!m_snapshot.empty() && m_snapshot_height != m_blockchain.size()){
+        save_snapshot(lock);
+    }
+
+    RCINFO("blockchain segments were opened");
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::sync
+// Description:
+//      Flush appended records to disk. Jobs that sync at the same
+//      time share one fsync: whoever comes first flushes everything
+//      written so far, and the others only wait for it.
+// ----------------------------------------------------------------------------
+bool Blockchain::sync(){
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if(!m_store){
+        return true;
+    }
+
+    auto store = m_store;
+    uint64_t target = store->size();
+
+    // a sync that's already running may cover these records too
+    m_sync_done.wait(lock,[this]{ return !m_syncing; });
+
+    if(store->get_synced() >= target){
+        return true;
+    }
+
+    // this sync covers every record written so far, including those
+    // from other jobs, and records can still be appended while it runs
+    int fd = -1;
+    uint64_t height = store->begin_sync(fd);
+    m_syncing = true;
+
+    lock.unlock();
+    bool flushed = SegmentStore::flush(fd);
+    lock.lock();
+
+    if(flushed){
+        store->end_sync(height);
+    }
+
+    m_syncing = false;
+    m_sync_done.notify_all();
+
+    return store->get_synced() >= target;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::set_snapshot
+// Description:
+//      Set where snapshots are written and how often
+// ----------------------------------------------------------------------------
+void Blockchain::set_snapshot( std::string t_path, size_t t_interval ){
+
+    if(t_interval == 0){
+        throw std::invalid_argument("snapshot interval must be at least one record");
+    }
+
+    m_snapshot = t_path;
+    m_snapshot_interval = t_interval;
+
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::snapshot
+// Description:
+//      Write a snapshot of the current trust and index
+// ----------------------------------------------------------------------------
+bool Blockchain::snapshot(){
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return !m_snapshot.empty() && save_snapshot(lock);
+
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::save_snapshot
+// Description:
+//      Copy the state under the lock, then serialize and write it
+//      without the lock so appends don't wait on the disk
+// ----------------------------------------------------------------------------
+bool Blockchain::save_snapshot( std::unique_lock<std::mutex>& t_lock ){
+
+    // another snapshot is being written, and the next append will
+    // write one if this state still isn't covered
+    if(m_snapshotting){
+        return false;
+    }
+
+    SnapshotState state;
+    state.height      = m_blockchain.size();
+    state.trust_basis = m_trust_basis;
+    state.lost_trust  = m_lost_trust;
+    state.trust       = m_trust;
+    state.authors     = m_authors;
+    state.index       = m_index;
+
+    m_snapshotting = true;
+    t_lock.unlock();
+
+    bool written = write_snapshot(state);
+
+    t_lock.lock();
+    m_snapshotting = false;
+
+    if(written){
+        m_snapshot_height = state.height;
+        RCDEBUG("wrote a snapshot of " + std::to_string(m_snapshot_height) + " records");
+    }
+
+    return written;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::write_snapshot
+// Description:
+//      Write the magic header, the layout version, a crc32 of the
+//      body and whether it's compressed, then the height, tip, trust
+//      and index in a portable binary archive. The file is written next to the old one and
+//      renamed over it, so a crash leaves one or the other.
+// ----------------------------------------------------------------------------
+bool Blockchain::write_snapshot( const SnapshotState& t_state ){
+
+    std::ostringstream body;
+
+    {
+        cereal::PortableBinaryOutputArchive archive(body);
+
+        // authors are mostly the same few public keys, so they're
+        // written once and referred to by number
+        std::map<std::string,uint32_t> ids;
+        std::vector<std::string> keys;
+        std::map<std::string,uint32_t> authors;
+
+        for(auto& author : t_state.authors){
+            auto id = ids.emplace(author.second,(uint32_t)keys.size());
+            if(id.second){
+                keys.push_back(author.second);
+            }
+            authors.emplace(author.first,id.first->second);
+        }
+
+        archive(t_state.height,t_state.index.previous,
+                t_state.trust_basis,t_state.lost_trust,t_state.trust,keys,authors,
+                t_state.index.records,t_state.index.references,t_state.index.publications,t_state.index.signatures);
+    }
+
+    std::string data = body.str();
+    uint64_t length  = data.size();
+
+    // the trust and index are mostly hex, which deflates to about half
+    std::string compressed;
+    bool deflated = m_compressed && Compressor().compress(data.data(),data.size(),compressed);
+    if(deflated){
+        data.swap(compressed);
+    }
+
+    boost::crc_32_type crc;
+    crc.process_bytes(data.data(),data.size());
+
+    std::string temporary = m_snapshot + ".tmp";
+    std::ofstream os(temporary,std::ios::binary | std::ios::trunc);
+
+    if(!os.is_open()){
+        RCWARNING("snapshot failed to save: " + m_snapshot);
+        return false;
+    }
+
+    os.write(SNAPSHOT_MAGIC,SNAPSHOT_MAGIC_SIZE);
+
+    {
+        cereal::PortableBinaryOutputArchive archive(os);
+        archive((uint32_t)SNAPSHOT_VERSION,(uint32_t)crc.checksum(),deflated,length);
+    }
+
+    os.write(data.data(),data.size());
+    os.close();
+
+    if(!os || !rechain::replace_file(temporary,m_snapshot)){
+        std::remove(temporary.c_str());
+
+        RCWARNING("snapshot failed to save: " + m_snapshot);
+        return false;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Blockchain::read_snapshot
+// Description:
+//      Read the trust and index written by write_snapshot, if the
+//      snapshot's tip is the record at its height. Anything that
+//      doesn't match leaves the trust and index alone, so the whole
+//      chain is checked instead.
+// ----------------------------------------------------------------------------
+uint64_t Blockchain::read_snapshot( const std::vector< std::shared_ptr<BaseRecord> >& t_records ){
+
+    if(m_snapshot.empty()){
+        return 0;
+    }
+
+    std::ifstream is(m_snapshot,std::ios::binary);
+    if(!is.is_open()){
+        return 0;
+    }
+
+    uint64_t height = 0;
+    double basis    = 0;
+    double lost     = 0;
+
+    std::map<std::string,double> trust;
+    std::vector<std::string> keys;
+    std::map<std::string,uint32_t> authors;
+    ChainIndex index;
+
+    try {
+
+        char magic[SNAPSHOT_MAGIC_SIZE] = {0};
+        is.read(magic,SNAPSHOT_MAGIC_SIZE);
+
+        if(!is || !std::equal(magic,magic + SNAPSHOT_MAGIC_SIZE,SNAPSHOT_MAGIC)){
+            RCWARNING("snapshot isn't a snapshot: " + m_snapshot);
+            return 0;
+        }
+
+        uint32_t version;
+        uint32_t checksum;
+        bool deflated   = false;
+        uint64_t length = 0;
+
+        {
+            cereal::PortableBinaryInputArchive archive(is);
+            archive(version,checksum);
+
+            if(version > SNAPSHOT_VERSION){
+                RCWARNING("snapshot version " + std::to_string(version) + " is newer than this build");
+                return 0;
+            }
+
+            // the first version was never compressed
+            if(version > 1){
+                archive(deflated,length);
+            }
+        }
+
+        std::string data((std::istreambuf_iterator<char>(is)),std::istreambuf_iterator<char>());
+
+        boost::crc_32_type crc;
+        crc.process_bytes(data.data(),data.size());
+
+        if(crc.checksum() != checksum){
+            RCWARNING("snapshot is damaged: " + m_snapshot);
+            return 0;
+        }
+
+        if(deflated){
+
+            // the length is only trusted as far as deflate can shrink
+            if(length > data.size() * Compressor::max_ratio){
+                RCWARNING("snapshot is damaged: " + m_snapshot);
+                return 0;
+            }
+
+            std::string inflated(length,'\0');
+            if(!Compressor().decompress(data.data(),data.size(),&inflated[0],length)){
+                RCWARNING("snapshot is damaged: " + m_snapshot);
+                return 0;
+            }
+            data.swap(inflated);
+        }
+
+        std::istringstream body(data);
+        cereal::PortableBinaryInputArchive archive(body);
+
+        archive(height,index.previous,basis,lost,trust,keys,authors,
+                index.records,index.references,index.publications,index.signatures);
+
+    } catch (const std::exception& e){
+        RCWARNING("snapshot couldn't be read: " + std::string(e.what()));
+        return 0;
+    }
+
+    // the snapshot has to be of these records, up to its height
+    if(height == 0 || height > t_records.size() || t_records[height - 1]->hash() != index.previous){
+        RCINFO("snapshot doesn't match the chain, checking every record");
+        return 0;
+    }
+
+    std::map<std::string,std::string> linked;
+    for(auto& author : authors){
+        if(author.second >= keys.size()){
+            RCWARNING("snapshot is damaged: " + m_snapshot);
+            return 0;
+        }
+        linked.emplace(author.first,keys[author.second]);
+    }
+
+    m_authors     = linked;
+    m_trust       = trust;
+    m_trust_basis = basis;
+    m_lost_trust  = lost;
+    m_index       = index;
+
+    m_snapshot_height = height;
+
+    return height;
 }
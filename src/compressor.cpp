@@ -0,0 +1,178 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+
+
+// system includes
+#include <set>
+#include <limits>
+#include <stdexcept>
+
+// dependency includes
+#include <zlib.h>
+
+// local includes
+#include "compressor.hpp"
+
+const size_t Compressor::max_dictionary;
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Compressor::Compressor
+// Description:
+//      Construct a Compressor with a dictionary
+// ----------------------------------------------------------------------------
+Compressor::Compressor( std::string t_dictionary, int t_level ) : m_dictionary(t_dictionary), m_level(t_level) {
+
+    if(t_level < 1 || t_level > 9){
+        throw std::invalid_argument("compression level must be from 1 to 9");
+    }
+
+    // zlib only uses the end of a longer dictionary
+    if(m_dictionary.size() > max_dictionary){
+        m_dictionary = m_dictionary.substr(m_dictionary.size() - max_dictionary);
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Compressor::train
+// Description:
+//      Join samples into a dictionary, skipping repeats, with the
+//      first (most useful) sample last
+// ----------------------------------------------------------------------------
+std::string Compressor::train( const std::vector<std::string>& t_samples, size_t t_size ){
+
+    std::set<std::string> seen;
+    std::string dictionary;
+
+    t_size = std::min(t_size,max_dictionary);
+
+    for(auto& sample : t_samples){
+
+        if(sample.empty() || !seen.insert(sample).second){
+            continue;
+        }
+
+        if(dictionary.size() + sample.size() > t_size){
+            break;
+        }
+
+        dictionary.insert(0,sample);
+    }
+
+    return dictionary;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Compressor::compress
+// Description:
+//      Deflate a whole buffer in one call
+// ----------------------------------------------------------------------------
+bool Compressor::compress( const char* t_data, size_t t_size, std::string& t_output ){
+
+    if(t_size > std::numeric_limits<uInt>::max()){
+        return false;
+    }
+
+    z_stream stream = {};
+    if(deflateInit(&stream,m_level) != Z_OK){
+        return false;
+    }
+
+    if(!m_dictionary.empty() &&
+       deflateSetDictionary(&stream,(const Bytef*)m_dictionary.data(),m_dictionary.size()) != Z_OK){
+        deflateEnd(&stream);
+        return false;
+    }
+
+    t_output.resize(deflateBound(&stream,t_size));
+
+    stream.next_in   = (Bytef*)t_data;
+    stream.avail_in  = t_size;
+    stream.next_out  = (Bytef*)&t_output[0];
+    stream.avail_out = t_output.size();
+
+    int result = deflate(&stream,Z_FINISH);
+    t_output.resize(stream.total_out);
+
+    deflateEnd(&stream);
+    return result == Z_STREAM_END;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Compressor::decompress
+// Description:
+//      Inflate a whole buffer in one call, giving zlib the
+//      dictionary when it asks for it
+// ----------------------------------------------------------------------------
+bool Compressor::decompress( const char* t_data, size_t t_size, char* t_output, size_t t_length ){
+
+    if(t_size > std::numeric_limits<uInt>::max() || t_length > std::numeric_limits<uInt>::max()){
+        return false;
+    }
+
+    z_stream stream = {};
+    if(inflateInit(&stream) != Z_OK){
+        return false;
+    }
+
+    stream.next_in   = (Bytef*)t_data;
+    stream.avail_in  = t_size;
+    stream.next_out  = (Bytef*)t_output;
+    stream.avail_out = t_length;
+
+    int result = inflate(&stream,Z_FINISH);
+
+    // the stream names the dictionary it was deflated with
+    if(result == Z_NEED_DICT){
+        if(m_dictionary.empty() || stream.adler != get_id() ||
+           inflateSetDictionary(&stream,(const Bytef*)m_dictionary.data(),m_dictionary.size()) != Z_OK){
+            inflateEnd(&stream);
+            return false;
+        }
+        result = inflate(&stream,Z_FINISH);
+    }
+
+    bool complete = (result == Z_STREAM_END && stream.total_out == t_length);
+
+    inflateEnd(&stream);
+    return complete;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Compressor::get_id
+// Description:
+//      Get the adler32 of the dictionary, which zlib writes to
+//      streams that were deflated with it
+// ----------------------------------------------------------------------------
+uint32_t Compressor::get_id(){
+
+    if(m_dictionary.empty()){
+        return 0;
+    }
+
+    return adler32(adler32(0,Z_NULL,0),(const Bytef*)m_dictionary.data(),m_dictionary.size());
+}
@@ -74,6 +74,10 @@ bool Config::initialize(){
             fs::path public_key  = home / "current.public";
             fs::path private_key = home / "current.private";
             fs::path blockchain  = home / "rechain.blockchain";
+            fs::path segments    = home / "segments";
+            fs::path snapshot    = home / "rechain.snapshot";
+            fs::path verified    = home / "rechain.verified";
+            fs::path secret      = home / "rechain.secret";
 
             fs::path logs        = home / "logs";
             fs::path files       = home / "files";
@@ -86,6 +90,10 @@ bool Config::initialize(){
             setting("private_key",private_key.string());
             setting("log",log.string());
             setting("blockchain",blockchain.string());
+            setting("segments",segments.string());
+            setting("snapshot",snapshot.string());
+            setting("verified",verified.string());
+            setting("secret",secret.string());
 
             setting("logs",logs.string());
             setting("files",files.string());
@@ -113,15 +121,25 @@ void Config::setting( std::string key, std::string value ){
 
 bool Config::save( std::string path ){
     setting("config",path);
-    std::ofstream ofs(path);
+
+    // written beside the old file and renamed over it
+    std::string temporary = path + ".tmp";
+    std::ofstream ofs(temporary,std::ios::trunc);
     if(ofs.is_open()){
 
         // serialize settings to the file
-        boost::archive::text_oarchive archive(ofs);
-        archive << *this;
+        {
+            boost::archive::text_oarchive archive(ofs);
+            archive << *this;
+        }
+
+        ofs.close();
 
         // saved
-        return true;
+        if(ofs && rechain::replace_file(temporary,path))
+            return true;
+
+        std::remove(temporary.c_str());
     }
 
     // couldn't save
@@ -0,0 +1,257 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+
+// system includes
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+
+// dependency includes
+#include <boost/filesystem.hpp>
+
+// local includes
+#include "generator.hpp"
+#include "mining_job.hpp"
+#include "genesis_record.hpp"
+#include "publication_record.hpp"
+#include "signature_record.hpp"
+#include "logger.hpp"
+
+namespace fs = boost::filesystem;
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Generator::Generator
+// Description:
+//      Check and save the shape of the chain to generate
+// ----------------------------------------------------------------------------
+Generator::Generator( size_t t_records, size_t t_authors, double t_ratio, unsigned int t_difficulty, size_t t_threads )
+    : m_records(t_records),
+      m_authors(t_authors),
+      m_ratio(t_ratio),
+      m_difficulty(t_difficulty),
+      m_threads(t_threads),
+      m_seed(0),
+      m_directory() {
+
+    if(m_records == 0){
+        throw std::invalid_argument("a chain needs at least a genesis record");
+    }
+
+    if(m_authors == 0){
+        throw std::invalid_argument("a chain needs at least one author");
+    }
+
+    if(!(m_ratio > 0 && m_ratio <= 1)){
+        throw std::invalid_argument("publication ratio must be more than 0 and at most 1");
+    }
+
+    if(m_threads == 0){
+        m_threads = std::max(std::thread::hardware_concurrency(),1u);
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Generator::keys
+// Description:
+//      Reuse the private keys in the key directory and generate the
+//      rest. Key generation is slow, so missing keys are generated
+//      on every thread.
+// ----------------------------------------------------------------------------
+std::vector< std::shared_ptr<PrivateKey> > Generator::keys(){
+
+    std::vector< std::shared_ptr<PrivateKey> > keys(m_authors);
+    std::vector<std::string> paths;
+
+    if(!m_directory.empty() && fs::is_directory(m_directory)){
+        for(auto& entry : fs::directory_iterator(m_directory)){
+            if(entry.path().extension() == ".private"){
+                paths.push_back(entry.path().string());
+            }
+        }
+    }
+
+    std::sort(paths.begin(),paths.end());
+
+    size_t loaded = std::min(paths.size(),m_authors);
+    for(size_t i = 0; i < loaded; ++i){
+        keys[i].reset(PrivateKey::load_file(paths[i]));
+    }
+
+    std::atomic<size_t> next(loaded);
+    std::vector<std::thread> threads;
+
+    for(size_t i = 0; i < std::min(m_threads,m_authors - loaded); ++i){
+        threads.emplace_back([&]{
+            for(size_t j = next++; j < m_authors; j = next++){
+                keys[j].reset(PrivateKey::empty());
+                keys[j]->generate();
+            }
+        });
+    }
+
+    for(auto& thread : threads){
+        thread.join();
+    }
+
+    // keep new keys so the next chain has the same authors
+    if(!m_directory.empty() && loaded < m_authors){
+        fs::create_directories(m_directory);
+
+        for(size_t i = loaded; i < m_authors; ++i){
+            std::string path = (fs::path(m_directory) / ("author" + std::to_string(i))).string();
+            std::shared_ptr<PublicKey> public_key(keys[i]->get_public());
+
+            keys[i]->save(path + ".private");
+            public_key->save(path + ".public");
+        }
+    }
+
+    RCINFO("reused " + std::to_string(loaded) + " keys, generated " + std::to_string(m_authors - loaded));
+    return keys;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Generator::generate
+// Description:
+//      Publish a genesis record that distributes trust to every
+//      author, then publications and signatures of earlier
+//      publications until the chain is long enough
+// ----------------------------------------------------------------------------
+bool Generator::generate( Blockchain& t_chain ){
+
+    if(t_chain.size() > 0){
+        RCERROR("can only generate into an empty chain");
+        return false;
+    }
+
+    unsigned int difficulty = BaseRecord::get_difficulty();
+    BaseRecord::set_difficulty(m_difficulty);
+
+    bool valid = false;
+
+    // the difficulty is global, so it's put back even if publishing throws
+    try {
+
+        auto authors = keys();
+        std::mt19937 generator(m_seed);
+        std::uniform_int_distribution<size_t> pick_author(0,m_authors - 1);
+
+        std::vector<std::string> distribution;
+        for(auto& author : authors){
+            std::shared_ptr<PublicKey> public_key(author->get_public());
+            distribution.push_back(public_key->to_string());
+        }
+
+        std::shared_ptr<GenesisRecord> genesis(new GenesisRecord());
+        genesis->set_distribution(distribution);
+
+        bool published = t_chain.publish_async(genesis,authors[0],m_threads)->wait();
+
+        // publications with their authors, for signatures to pick from
+        std::vector< std::pair<std::string,size_t> > publications;
+
+        for(size_t i = 1; published && i < m_records; ++i){
+
+            size_t author = pick_author(generator);
+            std::shared_ptr<BaseRecord> record;
+
+            if(publications.size() < m_ratio * i){
+                std::shared_ptr<PublicationRecord> publication(new PublicationRecord());
+                publication->set_reference("GENERATED" + std::to_string(m_seed) + "-" + std::to_string(i));
+                record = publication;
+            }
+            else {
+                std::uniform_int_distribution<size_t> pick_publication(0,publications.size() - 1);
+                auto& signed_record = publications[pick_publication(generator)];
+
+                // authors don't sign their own publications
+                if(author == signed_record.second && m_authors > 1){
+                    author = (author + 1) % m_authors;
+                }
+
+                record.reset(new SignatureRecord(signed_record.first));
+            }
+
+            published = t_chain.publish_async(record,authors[author],m_threads)->wait();
+
+            if(record->get_type() == RecordType::Publication){
+                publications.push_back(std::make_pair(record->hash(),author));
+            }
+
+            if((i + 1) % 1000 == 0){
+                RCINFO("generated " + std::to_string(i + 1) + " of " + std::to_string(m_records) + " records");
+            }
+        }
+
+        // every record was checked as it was appended
+        valid = published && t_chain.validate_from(t_chain.get_validated());
+        if(valid){
+            t_chain.update_trust();
+        }
+
+    } catch (...){
+        BaseRecord::set_difficulty(difficulty);
+        throw;
+    }
+
+    BaseRecord::set_difficulty(difficulty);
+
+    if(!valid){
+        RCERROR("generated chain is not valid");
+    }
+
+    return valid;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Generator::generate
+// Description:
+//      Generate a chain and save it where Blockchain::load can read it
+// ----------------------------------------------------------------------------
+bool Generator::generate( std::string t_path ){
+
+    Blockchain chain;
+
+    if(!generate(chain)){
+        return false;
+    }
+
+    if(!chain.save(t_path)){
+        return false;
+    }
+
+    // the file doesn't say what it was mined at, and records are
+    // checked against the difficulty they're loaded with
+    RCINFO("chain was mined at a difficulty of " + std::to_string(m_difficulty) +
+           ", load it with the \"difficulty\" setting at " + std::to_string(m_difficulty));
+
+    return true;
+}
@@ -26,6 +26,9 @@
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 
+#include <cereal/archives/portable_binary.hpp>
+#include <cereal/types/string.hpp>
+
 // local includes
 #include "genesis_record.hpp"
 #include "enums.hpp"
@@ -51,13 +54,13 @@ GenesisRecord::~GenesisRecord(){}
 
 // ----------------------------------------------------------------------------
 // Name:
-//      GenesisRecord::is_valid
+//      GenesisRecord::is_well_formed
 // Description:
-//      Checks GenesisRecord-specific values and that the Record is
-//      signed and mined correctly.
+//      Checks GenesisRecord-specific values, before the Record is
+//      checked for work and a signature
 // ----------------------------------------------------------------------------
-bool GenesisRecord::is_valid(){
-  bool valid = BaseRecord::is_valid();
+bool GenesisRecord::is_well_formed(){
+  bool valid = BaseRecord::is_well_formed();
 
   if(m_distribution.size() == 0){
     valid = false;
@@ -85,6 +88,71 @@ std::string GenesisRecord::get_data(){
     return data;
 }
 
+// ----------------------------------------------------------------------------
+// Name:
+//      GenesisRecord::encode_fields
+// Description:
+//      Append the name and a count followed by each distribution entry
+// ----------------------------------------------------------------------------
+void GenesisRecord::encode_fields( std::string& t_out ){
+
+    encode_string(t_out,m_name);
+    encode_integer(t_out,m_distribution.size(),4);
+
+    for(auto& id : m_distribution){
+        encode_string(t_out,id);
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      GenesisRecord::release_fields
+// Description:
+//      Free the name and distribution of a released view
+// ----------------------------------------------------------------------------
+void GenesisRecord::release_fields(){
+    std::string().swap(m_name);
+    std::vector<std::string>().swap(m_distribution);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      GenesisRecord::save_binary
+// Description:
+//      Write the BaseRecord fields and then the name and distribution list
+// ----------------------------------------------------------------------------
+void GenesisRecord::save_binary( cereal::PortableBinaryOutputArchive& t_archive ){
+
+    BaseRecord::save_binary(t_archive);
+    t_archive(m_name,(uint64_t)m_distribution.size());
+
+    for(auto& id : m_distribution){
+        save_hex(t_archive,id);
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      GenesisRecord::load_binary
+// Description:
+//      Read the fields written by save_binary
+// ----------------------------------------------------------------------------
+void GenesisRecord::load_binary( cereal::PortableBinaryInputArchive& t_archive ){
+
+    BaseRecord::load_binary(t_archive);
+
+    uint64_t count;
+    t_archive(m_name,count);
+
+    m_distribution.resize(count);
+    for(auto& id : m_distribution){
+        load_hex(t_archive,id);
+    }
+
+}
+
 // ----------------------------------------------------------------------------
 // Name:
 //      GenesisRecord::to_string
@@ -105,4 +173,14 @@ std::string GenesisRecord::to_string(){
 
 }
 
+// ----------------------------------------------------------------------------
+// Name:
+//      GenesisRecord::clone
+// Description:
+//      Copies the GenesisRecord into a new shared_ptr
+// ----------------------------------------------------------------------------
+std::shared_ptr<BaseRecord> GenesisRecord::clone(){
+    return std::make_shared<GenesisRecord>(*this);
+}
+
 BOOST_CLASS_EXPORT_IMPLEMENT(GenesisRecord)
@@ -32,6 +32,7 @@
 #include "manager.hpp"
 #include "blockchain.hpp"
 #include "logger.hpp"
+#include "config.hpp"
 
 #define H_NOERR	0
 #define H_ERROR	1
@@ -44,9 +45,22 @@ int Interface::execute(){
 		("v,version","Display version information")
 		("p,publish","Publish a document",cxxopts::value<std::string>(),"<path>")	
 		("c,check","Validate the blockchain")	
+		("full_check","Check every record at startup instead of resuming from a snapshot")
+		("full_verify","Verify every signature instead of trusting the verified signature cache")
 		("s,sign","Sign a published document",cxxopts::value<std::string>(),"<path>")
 		("private_key","Make a private key active",cxxopts::value<std::string>(),"<path>")
+		("key_type","Create a new identity as 'rsa' or 'ed25519' if there isn't one",cxxopts::value<std::string>(),"<type>")
 		("l,list","List published documents")
+		("difficulty","Leading zero bits to mine/validate with",cxxopts::value<unsigned int>(),"<bits>")
+		("chain_format","Save the blockchain as 'text' or 'binary'",cxxopts::value<std::string>(),"<format>")
+		("convert","Rewrite the blockchain as 'text' or 'binary'",cxxopts::value<std::string>(),"<format>")
+		("mining_port","Accept mining workers on a port while publishing",cxxopts::value<unsigned int>(),"<port>")
+		("worker","Mine for the node at an address",cxxopts::value<std::string>(),"<host:port>")
+		("generate","Write a synthetic chain for testing",cxxopts::value<std::string>(),"<path>")
+		("records","Records to generate",cxxopts::value<unsigned int>()->default_value("1000"),"<count>")
+		("authors","Authors to generate records from",cxxopts::value<unsigned int>()->default_value("3"),"<count>")
+		("ratio","Share of generated records that are publications",cxxopts::value<double>()->default_value("0.5"),"<ratio>")
+		("keys","Reuse and save generated keys in a directory",cxxopts::value<std::string>()->default_value(""),"<dir>")
 		("verbose","All logging output")
 		("silent","No logging output");
 
@@ -60,6 +74,30 @@ int Interface::execute(){
         else if(result.count("silent")) level = Level::none;
         else                            level = Level::info;
 
+        if(result.count("difficulty")){
+            Config::get()->setting("difficulty",std::to_string(result["difficulty"].as<unsigned int>()));
+        }
+
+        if(result.count("key_type")){
+            Config::get()->setting("key_type",result["key_type"].as<std::string>());
+        }
+
+        if(result.count("chain_format")){
+            Config::get()->setting("chain_format",result["chain_format"].as<std::string>());
+        }
+
+        if(result.count("full_check")){
+            Config::get()->setting("full_check","true");
+        }
+
+        if(result.count("full_verify")){
+            Config::get()->setting("full_verify","true");
+        }
+
+        if(result.count("mining_port")){
+            Config::get()->setting("mining_port",std::to_string(result["mining_port"].as<unsigned int>()));
+        }
+
         manager = std::shared_ptr<Manager>(new Manager());
         if(!manager->configure(level)){
             return H_ERROR;
@@ -93,6 +131,34 @@ int Interface::execute(){
                 }
 			}
 			
+			// Mine for another node
+			if(result.count("worker")){
+				if(manager->work(result["worker"].as<std::string>()))
+					return H_NOERR;
+				else
+					return H_ERROR;
+			}
+
+			// Write a synthetic chain
+			if(result.count("generate")){
+				if(manager->generate(result["generate"].as<std::string>(),
+				                     result["records"].as<unsigned int>(),
+				                     result["authors"].as<unsigned int>(),
+				                     result["ratio"].as<double>(),
+				                     result["keys"].as<std::string>()))
+					return H_NOERR;
+				else
+					return H_ERROR;
+			}
+
+			// Rewrite the blockchain in another format
+			if(result.count("convert")){
+				if(manager->convert(result["convert"].as<std::string>()))
+					return H_NOERR;
+				else
+					return H_ERROR;
+			}
+
 			// Check blockchain is valid
 			if(result.count("check")){
                 if(manager->is_valid())
@@ -0,0 +1,187 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+
+// system includes
+#include <string>
+#include <memory>
+
+// local includes
+#include "key_cache.hpp"
+
+/** The number of keys kept unless it's changed */
+#define DEFAULT_CAPACITY 1024
+
+// ----------------------------------------------------------------------------
+// Name:
+//      KeyCache members
+// Description:
+//      The cache is shared by every record and thread
+// ----------------------------------------------------------------------------
+std::mutex KeyCache::m_mutex;
+KeyCache::entries_t KeyCache::m_entries;
+std::unordered_map< std::string, KeyCache::entries_t::iterator > KeyCache::m_lookup;
+size_t KeyCache::m_capacity = DEFAULT_CAPACITY;
+std::atomic<uint64_t> KeyCache::m_hits(0);
+std::atomic<uint64_t> KeyCache::m_misses(0);
+
+// ----------------------------------------------------------------------------
+// Name:
+//      KeyCache::get
+// Description:
+//      Find a key, or parse and validate it outside the lock so that
+//      other threads aren't held up by a new author
+// ----------------------------------------------------------------------------
+std::shared_ptr<PublicKey> KeyCache::get( const std::string& t_encoding ){
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        auto it = m_lookup.find(t_encoding);
+        if(it != m_lookup.end()){
+            m_entries.splice(m_entries.begin(),m_entries,it->second);
+            m_hits++;
+            return it->second->second;
+        }
+    }
+
+    m_misses++;
+
+    // throws if the key isn't good, and bad keys aren't kept
+    std::shared_ptr<PublicKey> key(PublicKey::load_string(t_encoding));
+    key->prepare();
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return insert(t_encoding,key);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      KeyCache::add
+// Description:
+//      Add a key that doesn't need to be validated
+// ----------------------------------------------------------------------------
+void KeyCache::add( const std::string& t_encoding, std::shared_ptr<PublicKey> t_key ){
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        auto it = m_lookup.find(t_encoding);
+        if(it != m_lookup.end()){
+            m_entries.splice(m_entries.begin(),m_entries,it->second);
+            return;
+        }
+    }
+
+    std::shared_ptr<PublicKey> key(new PublicKey(t_key.get()));
+    key->prepare();
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    insert(t_encoding,key);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      KeyCache::insert
+// Description:
+//      Put a key at the front, keeping the one that's there if another
+//      thread added the same key first
+// ----------------------------------------------------------------------------
+std::shared_ptr<PublicKey> KeyCache::insert( const std::string& t_encoding, std::shared_ptr<PublicKey> t_key ){
+
+    if(m_capacity == 0){
+        return t_key;
+    }
+
+    auto it = m_lookup.find(t_encoding);
+    if(it != m_lookup.end()){
+        m_entries.splice(m_entries.begin(),m_entries,it->second);
+        return it->second->second;
+    }
+
+    m_entries.emplace_front(t_encoding,t_key);
+    m_lookup[t_encoding] = m_entries.begin();
+
+    while(m_entries.size() > m_capacity){
+        m_lookup.erase(m_entries.back().first);
+        m_entries.pop_back();
+    }
+
+    return t_key;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      KeyCache::set_capacity
+// Description:
+//      Change the most keys kept, dropping the oldest keys
+// ----------------------------------------------------------------------------
+void KeyCache::set_capacity( size_t t_capacity ){
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_capacity = t_capacity;
+
+    while(m_entries.size() > m_capacity){
+        m_lookup.erase(m_entries.back().first);
+        m_entries.pop_back();
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      KeyCache::get_capacity
+// Description:
+//      Get the most keys kept
+// ----------------------------------------------------------------------------
+size_t KeyCache::get_capacity(){
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_capacity;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      KeyCache::size
+// Description:
+//      Get the number of keys kept
+// ----------------------------------------------------------------------------
+size_t KeyCache::size(){
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_entries.size();
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      KeyCache::clear
+// Description:
+//      Drop every key and reset the counters
+// ----------------------------------------------------------------------------
+void KeyCache::clear(){
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    m_entries.clear();
+    m_lookup.clear();
+
+    m_hits   = 0;
+    m_misses = 0;
+
+}
@@ -24,28 +24,192 @@
 #include <cryptopp/rsa.h>		// For RSA:: namespace
 #include <cryptopp/pssr.h>		// For PSSR
 #include <cryptopp/whrlpool.h>		// For Whirlpool
+#include <cryptopp/xed25519.h>		// For ed25519
 
 #include <fstream>				// File I/O
 #include <string>				// std::string
+#include <thread>				// std::thread
+#include <atomic>				// std::atomic
+#include <exception>			// std::exception_ptr
+#include <mutex>				// std::mutex
+#include <stdexcept>			// std::invalid_argument
 
 #include "keys.hpp"
+#include "key_cache.hpp"
 #include "logger.hpp"
 
 /** The RSA key size */
 #define KEY_SIZE 3072
 
-using Signer   = CryptoPP::RSASS<CryptoPP::PSSR, CryptoPP::Whirlpool>::Signer;
-using Verifier = CryptoPP::RSASS<CryptoPP::PSSR, CryptoPP::Whirlpool>::Verifier;
+/** The DER encoded contents of the Ed25519 OID (1.3.101.112) */
+static const std::string ED25519_OID("\x2B\x65\x70",3);
+
+/** The DER encoded contents of the rsaEncryption OID (1.2.840.113549.1.1.1) */
+static const std::string RSA_OID("\x2A\x86\x48\x86\xF7\x0D\x01\x01\x01",9);
+
+/** DER tags used by key encodings */
+#define DER_INTEGER  0x02
+#define DER_OID      0x06
+#define DER_SEQUENCE 0x30
+
+// Read the tag and definite length of a DER element and move past them,
+// leaving the position at its contents. Returns false if the tag
+// doesn't match or the length runs past the end.
+static bool der_element( const std::string& t_der, size_t& t_pos, unsigned char t_tag, size_t& t_length ){
+	if(t_pos + 2 > t_der.size() || (unsigned char)t_der[t_pos] != t_tag){
+		return false;
+	}
+
+	size_t length = (unsigned char)t_der[t_pos + 1];
+	t_pos += 2;
+
+	if(length & 0x80){
+		size_t bytes = length & 0x7F;
+		if(bytes == 0 || bytes > sizeof(size_t) || bytes > t_der.size() - t_pos){
+			return false;
+		}
+
+		length = 0;
+		for(size_t i = 0; i < bytes; ++i){
+			length = (length << 8) | (unsigned char)t_der[t_pos++];
+		}
+	}
+
+	if(length > t_der.size() - t_pos){
+		return false;
+	}
+
+	t_length = length;
+	return true;
+}
+
+// Find the type of a hex encoded key from its AlgorithmIdentifier.
+// Public keys are a SubjectPublicKeyInfo and private keys a PKCS #8
+// PrivateKeyInfo, which are both a SEQUENCE that starts with the
+// AlgorithmIdentifier, after a version INTEGER for private keys.
+static KeyType encoding_type( const std::string& t_key ){
+	std::string der;
+	CryptoPP::StringSource ss(t_key, true, new CryptoPP::HexDecoder(new CryptoPP::StringSink(der)));
+
+	size_t pos = 0;
+	size_t length = 0;
+
+	if(!der_element(der,pos,DER_SEQUENCE,length)){
+		throw std::invalid_argument("key isn't a DER encoded key");
+	}
+
+	if(pos < der.size() && (unsigned char)der[pos] == DER_INTEGER){
+		if(!der_element(der,pos,DER_INTEGER,length)){
+			throw std::invalid_argument("key has a bad version");
+		}
+		pos += length;
+	}
+
+	if(!der_element(der,pos,DER_SEQUENCE,length) || !der_element(der,pos,DER_OID,length)){
+		throw std::invalid_argument("key has no algorithm identifier");
+	}
+
+	std::string algorithm = der.substr(pos,length);
+
+	if(algorithm == ED25519_OID){
+		return KeyType::Ed25519Key;
+	}
+
+	if(algorithm == RSA_OID){
+		return KeyType::RSAKey;
+	}
+
+	throw std::invalid_argument("key algorithm isn't supported");
+}
+
+// Sign data with either kind of signer, returning a hex encoded signature
+template <typename S>
+static std::string sign_data( const S& t_signer, const std::string& t_data ){
+	std::string signature;
+
+	// seeding a pool reads the system's entropy, so each thread keeps one
+	static thread_local CryptoPP::AutoSeededRandomPool rng;
+
+	CryptoPP::StringSource ss(t_data, true,
+				new CryptoPP::SignerFilter(rng, t_signer,
+					new CryptoPP::HexEncoder(
+						new CryptoPP::StringSink(signature))));
+
+	return signature;
+}
+
+// Check a raw signature over data with either kind of verifier
+template <typename V>
+static bool verify_data( const V& t_verifier, const std::string& t_signature, const std::string& t_data ){
+	bool result = false;
+
+	CryptoPP::StringSource ss(t_signature + t_data, true,
+				   new CryptoPP::SignatureVerificationFilter(t_verifier,
+					 new CryptoPP::ArraySink((unsigned char*)&result, sizeof(result))));
+
+	return result;
+}
+
+// -----------------------------------------------------------------------------
+// Ed25519 Implementation
+
+// Generate a new Ed25519PrivateKey
+void Ed25519PrivateKey::generate(){
+	CryptoPP::AutoSeededRandomPool rng;
+	key.GenerateRandom(rng, CryptoPP::g_nullNameValuePairs);
+}
+
+// Generate a new Ed25519PublicKey from an Ed25519PrivateKey
+void Ed25519PublicKey::generate( Ed25519PrivateKey* t_key ){
+	t_key->get_key().MakePublicKey(key);
+}
+
+// -----------------------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
 // PrivateKey Implementation
 
 // Generate a new PrivateKey
-void PrivateKey::generate(){
+void PrivateKey::generate( KeyType t_type ){
+	reset_context();
+
+	if(t_type == KeyType::Ed25519Key){
+		m_ed25519 = std::make_shared<Ed25519PrivateKey>();
+		m_ed25519->generate();
+		return;
+	}
+
+	m_ed25519.reset();
+
 	CryptoPP::AutoSeededRandomPool rng;
 	key.GenerateRandomWithKeySize(rng, KEY_SIZE);
 }
 
+// Convert either kind of key to a string
+std::string PrivateKey::to_string(){
+	return m_ed25519 ? m_ed25519->to_string() : Key::to_string();
+}
+
+// Load either kind of key from a string
+void PrivateKey::from_string( std::string t_key ){
+	reset_context();
+
+	if(encoding_type(t_key) == KeyType::Ed25519Key){
+		std::shared_ptr<Ed25519PrivateKey> ed25519 = std::make_shared<Ed25519PrivateKey>();
+		ed25519->from_string(t_key);
+		m_ed25519 = ed25519;
+		return;
+	}
+
+	m_ed25519.reset();
+	Key::from_string(t_key);
+}
+
+// Validate either kind of key
+bool PrivateKey::valid(){
+	return m_ed25519 ? m_ed25519->valid() : Key::valid();
+}
+
 PublicKey* PrivateKey::get_public(){
 
     PublicKey* public_key = new PublicKey();
@@ -55,26 +219,52 @@ PublicKey* PrivateKey::get_public(){
 
 }
 
-void PrivateKey::sign( BaseRecord* t_record ){
-	std::string signature;
+// Build the public key and signer once for every record that's signed
+std::shared_ptr<SigningContext> PrivateKey::get_context(){
+	std::shared_ptr<SigningContext> context = std::atomic_load(&m_context);
 
-	// create a public key and set it on the  Record
-	std::shared_ptr<PublicKey> pub_key(PublicKey::empty());
-	pub_key->generate( this );
+	if(!context){
+		context = std::make_shared<SigningContext>();
 
-	t_record->set_public_key(pub_key->to_string());
+		context->public_key.reset(get_public());
+		context->public_key->prepare();
+		context->encoding = context->public_key->to_string();
 
-	// create a Signer and random generator
-	Signer signer(key);
-	CryptoPP::AutoSeededRandomPool rng;
+		if(m_ed25519){
+			context->ed25519_signer = std::make_shared<Ed25519Signer>(m_ed25519->get_key());
+		}
+		else {
+			context->signer = std::make_shared<Signer>(key);
+		}
 
-	// sign the Data object
-	CryptoPP::StringSource ss(t_record->get_data(), true,
-				new CryptoPP::SignerFilter(rng, signer,
-					new CryptoPP::HexEncoder(
-						new CryptoPP::StringSink(signature))));
+		// threads that raced here built the same context
+		std::atomic_store(&m_context,context);
+	}
+
+	return context;
+}
 
-	t_record->set_signature(signature);
+// Drop the context of a key that's been replaced
+void PrivateKey::reset_context(){
+	std::atomic_store(&m_context,std::shared_ptr<SigningContext>());
+}
+
+void PrivateKey::sign( BaseRecord* t_record ){
+	std::shared_ptr<SigningContext> context = get_context();
+
+	// set the public key on the Record
+	t_record->set_public_key(context->encoding);
+
+	// the record is checked when it's appended, with the same key
+	KeyCache::add(context->encoding,context->public_key);
+
+	// sign the Data object
+	if(context->ed25519_signer){
+		t_record->set_signature(sign_data(*context->ed25519_signer, t_record->get_data()));
+	}
+	else {
+		t_record->set_signature(sign_data(*context->signer, t_record->get_data()));
+	}
 }
 
 // Sign a Record
@@ -82,6 +272,56 @@ void PrivateKey::sign( std::shared_ptr<BaseRecord> t_record ){
     sign(t_record.get());
 }
 
+// Sign records on several threads, each taking the next unsigned record
+void PrivateKey::sign( const std::vector< std::shared_ptr<BaseRecord> >& t_records, size_t t_threads ){
+
+	// hardware_concurrency may return 0 if it can't tell
+	if(t_threads == 0){
+		t_threads = std::thread::hardware_concurrency();
+	}
+
+	t_threads = std::max<size_t>(1,std::min(t_threads,t_records.size()));
+
+	// built before the workers start so they don't race to build it
+	get_context();
+
+	std::atomic<size_t> next(0);
+	std::exception_ptr error;
+	std::mutex error_mutex;
+
+	auto work = [&]{
+		try {
+			for(size_t i = next++; i < t_records.size(); i = next++){
+				sign(t_records[i].get());
+			}
+		}
+		catch(...){
+			std::lock_guard<std::mutex> guard(error_mutex);
+			if(!error){
+				error = std::current_exception();
+			}
+
+			// stop the other workers
+			next = t_records.size();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for(size_t i = 1; i < t_threads; ++i){
+		workers.push_back(std::thread(work));
+	}
+
+	work();
+
+	for(auto& worker : workers){
+		worker.join();
+	}
+
+	if(error){
+		std::rethrow_exception(error);
+	}
+}
+
 // -----------------------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
@@ -89,26 +329,72 @@ void PrivateKey::sign( std::shared_ptr<BaseRecord> t_record ){
 
 // Generate a new PublicKey from a PrivateKey
 void PublicKey::generate( PrivateKey* t_key ){
+	m_verifier.reset();
+	m_ed25519_verifier.reset();
+
+	if(t_key->get_type() == KeyType::Ed25519Key){
+		m_ed25519 = std::make_shared<Ed25519PublicKey>();
+		m_ed25519->generate(t_key->get_ed25519().get());
+		return;
+	}
+
+	m_ed25519.reset();
+
 	CryptoPP::RSA::PublicKey n_key(t_key->get_key());
 	key = n_key;
 }
 
+// Convert either kind of key to a string
+std::string PublicKey::to_string(){
+	return m_ed25519 ? m_ed25519->to_string() : Key::to_string();
+}
+
+// Load either kind of key from a string
+void PublicKey::from_string( std::string t_key ){
+	m_verifier.reset();
+	m_ed25519_verifier.reset();
+
+	if(encoding_type(t_key) == KeyType::Ed25519Key){
+		std::shared_ptr<Ed25519PublicKey> ed25519 = std::make_shared<Ed25519PublicKey>();
+		ed25519->from_string(t_key);
+		m_ed25519 = ed25519;
+		return;
+	}
+
+	m_ed25519.reset();
+	Key::from_string(t_key);
+}
+
+// Validate either kind of key
+bool PublicKey::valid(){
+	return m_ed25519 ? m_ed25519->valid() : Key::valid();
+}
+
 // Verify the signature on a Data block
 bool PublicKey::verify( BaseRecord* t_record ){
 	std::string signature;
-	bool result = false;
-
-	Verifier verifier(key);
 
 	CryptoPP::StringSource ss(t_record->get_signature(), true,
 				  new CryptoPP::HexDecoder(
 					new CryptoPP::StringSink(signature)));
 
-	CryptoPP::StringSource ss2(signature + t_record->get_data(), true,
-				   new CryptoPP::SignatureVerificationFilter(verifier,
-					 new CryptoPP::ArraySink((unsigned char*)&result, sizeof(result))));
+	if(m_ed25519){
+		std::shared_ptr<Ed25519Verifier> verifier = m_ed25519_verifier ? m_ed25519_verifier : std::make_shared<Ed25519Verifier>(m_ed25519->get_key());
+		return verify_data(*verifier, signature, t_record->get_data());
+	}
 
-	return result;
+	std::shared_ptr<Verifier> verifier = m_verifier ? m_verifier : std::make_shared<Verifier>(key);
+	return verify_data(*verifier, signature, t_record->get_data());
+}
+
+// Build the verifier once for a key that's kept
+void PublicKey::prepare(){
+	if(m_ed25519){
+		m_ed25519_verifier = std::make_shared<Ed25519Verifier>(m_ed25519->get_key());
+	}
+	else {
+		m_verifier = std::make_shared<Verifier>(key);
+	}
 }
 
 // -----------------------------------------------------------------------------
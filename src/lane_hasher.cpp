@@ -0,0 +1,494 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+// system includes
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+// dependency includes
+#include <cryptopp/sha.h>       // for SHA256
+
+// local includes
+#include "lane_hasher.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define RECHAIN_X86
+    #include <cpuid.h>          // for __get_cpuid_count
+#endif
+
+/** The SHA256 block size in bytes */
+#define BLOCK_SIZE 64
+
+/** The most lanes any backend uses */
+#define MAX_LANES 16
+
+// the vector types are only passed between inlined functions
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+/** The SHA256 round constants */
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/** The SHA256 initial chaining value */
+static const uint32_t IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/** Eight 32-bit lanes */
+typedef uint32_t lanes8 __attribute__((vector_size(32)));
+
+/** Sixteen 32-bit lanes */
+typedef uint32_t lanes16 __attribute__((vector_size(64)));
+
+/** Compresses one block for every lane. State and words are stored
+    word-major: word i of lane l is at [i*lanes + l]. Lanes with a zero
+    mask keep their state.
+*/
+typedef void (*compress_fn)( uint32_t* t_state, const uint32_t* t_words, const uint32_t* t_mask );
+
+// ----------------------------------------------------------------------------
+// Name:
+//      rotr
+// Description:
+//      Rotate every lane right by t_bits
+// ----------------------------------------------------------------------------
+template <typename V>
+static inline __attribute__((always_inline)) V rotr( V t_value, int t_bits ){
+    return (t_value >> t_bits) | (t_value << (32 - t_bits));
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      compress
+// Description:
+//      The SHA256 compression function written once for any lane type.
+//      It's inlined into one function per instruction set so that the
+//      compiler vectorizes it for that target.
+// ----------------------------------------------------------------------------
+template <typename V, size_t N>
+static inline __attribute__((always_inline)) void compress( uint32_t* t_state, const uint32_t* t_words, const uint32_t* t_mask ){
+
+    V state[8];
+    V w[64];
+    V mask;
+
+    for(size_t i = 0; i < 8; ++i){
+        std::memcpy(&state[i],t_state + i*N,sizeof(V));
+    }
+
+    for(size_t i = 0; i < 16; ++i){
+        std::memcpy(&w[i],t_words + i*N,sizeof(V));
+    }
+
+    std::memcpy(&mask,t_mask,sizeof(V));
+
+    for(size_t i = 16; i < 64; ++i){
+        V s0 = rotr(w[i-15],7) ^ rotr(w[i-15],18) ^ (w[i-15] >> 3);
+        V s1 = rotr(w[i-2],17) ^ rotr(w[i-2],19)  ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+    V a = state[0], b = state[1], c = state[2], d = state[3];
+    V e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for(size_t i = 0; i < 64; ++i){
+        V t1 = h + (rotr(e,6) ^ rotr(e,11) ^ rotr(e,25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        V t2 = (rotr(a,2) ^ rotr(a,13) ^ rotr(a,22)) + ((a & b) ^ (a & c) ^ (b & c));
+
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    V result[8] = { a, b, c, d, e, f, g, h };
+
+    for(size_t i = 0; i < 8; ++i){
+        V updated = state[i] + result[i];
+        state[i] = (updated & mask) | (state[i] & ~mask);
+        std::memcpy(t_state + i*N,&state[i],sizeof(V));
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      compress_scalar
+// Description:
+//      Compress one lane with plain 32-bit integers
+// ----------------------------------------------------------------------------
+static void compress_scalar( uint32_t* t_state, const uint32_t* t_words, const uint32_t* t_mask ){
+    compress<uint32_t,1>(t_state,t_words,t_mask);
+}
+
+#ifdef RECHAIN_X86
+
+// ----------------------------------------------------------------------------
+// Name:
+//      compress_avx2
+// Description:
+//      Compress eight lanes with AVX2
+// ----------------------------------------------------------------------------
+__attribute__((target("avx2")))
+static void compress_avx2( uint32_t* t_state, const uint32_t* t_words, const uint32_t* t_mask ){
+    compress<lanes8,8>(t_state,t_words,t_mask);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      compress_avx512
+// Description:
+//      Compress sixteen lanes with AVX-512
+// ----------------------------------------------------------------------------
+__attribute__((target("avx512f")))
+static void compress_avx512( uint32_t* t_state, const uint32_t* t_words, const uint32_t* t_mask ){
+    compress<lanes16,16>(t_state,t_words,t_mask);
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Name:
+//      load_word
+// Description:
+//      Read a big-endian 32-bit word
+// ----------------------------------------------------------------------------
+static inline uint32_t load_word( const unsigned char* t_data ){
+    return ((uint32_t)t_data[0] << 24) | ((uint32_t)t_data[1] << 16) |
+           ((uint32_t)t_data[2] << 8)  |  (uint32_t)t_data[3];
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      store_word
+// Description:
+//      Write a big-endian 32-bit word
+// ----------------------------------------------------------------------------
+static inline void store_word( uint32_t t_word, unsigned char* t_data ){
+    t_data[0] = (unsigned char)(t_word >> 24);
+    t_data[1] = (unsigned char)(t_word >> 16);
+    t_data[2] = (unsigned char)(t_word >> 8);
+    t_data[3] = (unsigned char)(t_word);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      pad
+// Description:
+//      Append the SHA256 padding for a message of t_length bytes in total
+// ----------------------------------------------------------------------------
+static void pad( std::string& t_data, uint64_t t_length ){
+
+    t_data.push_back((char)0x80);
+
+    while(t_data.size() % BLOCK_SIZE != 56){
+        t_data.push_back((char)0x00);
+    }
+
+    uint64_t bits = t_length * 8;
+    for(int i = 7; i >= 0; --i){
+        t_data.push_back((char)(bits >> (i*8)));
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      run_lanes
+// Description:
+//      Pad every tail and push them through the compression function
+//      t_lanes at a time. Tails that run out of blocks before the others
+//      in their group are masked off.
+// ----------------------------------------------------------------------------
+static void run_lanes( size_t t_lanes, compress_fn t_compress, const LaneState& t_state,
+                       const std::vector<std::string>& t_tails, unsigned char* t_digests ){
+
+    uint32_t state[8*MAX_LANES];
+    uint32_t words[16*MAX_LANES];
+    uint32_t mask[MAX_LANES];
+
+    std::string padded[MAX_LANES];
+    size_t blocks[MAX_LANES];
+
+    for(size_t first = 0; first < t_tails.size(); first += t_lanes){
+
+        size_t count = std::min(t_lanes,t_tails.size() - first);
+        size_t most  = 0;
+
+        for(size_t l = 0; l < t_lanes; ++l){
+
+            padded[l].clear();
+            blocks[l] = 0;
+
+            if(l < count){
+                padded[l] = t_tails[first + l];
+                pad(padded[l],t_state.length + padded[l].size());
+
+                blocks[l] = padded[l].size() / BLOCK_SIZE;
+                most = std::max(most,blocks[l]);
+            }
+
+            for(size_t i = 0; i < 8; ++i){
+                state[i*t_lanes + l] = t_state.h[i];
+            }
+        }
+
+        for(size_t b = 0; b < most; ++b){
+            for(size_t l = 0; l < t_lanes; ++l){
+
+                bool active = (b < blocks[l]);
+                mask[l] = active ? 0xFFFFFFFF : 0;
+
+                const unsigned char* block = (const unsigned char*)padded[l].data() + b*BLOCK_SIZE;
+                for(size_t i = 0; i < 16; ++i){
+                    words[i*t_lanes + l] = active ? load_word(block + i*4) : 0;
+                }
+            }
+
+            t_compress(state,words,mask);
+        }
+
+        for(size_t l = 0; l < count; ++l){
+            for(size_t i = 0; i < 8; ++i){
+                store_word(state[i*t_lanes + l],t_digests + (first + l)*32 + i*4);
+            }
+        }
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      LaneHasher::m_backend
+// Description:
+//      The backend in use, detected on start up
+// ----------------------------------------------------------------------------
+LaneHasher::Backend LaneHasher::m_backend = LaneHasher::detect();
+
+// ----------------------------------------------------------------------------
+// Name:
+//      sha_extensions
+// Description:
+//      Check the cpu for the SHA extensions (cpuid leaf 7, ebx bit 29)
+// ----------------------------------------------------------------------------
+static bool sha_extensions(){
+
+#ifdef RECHAIN_X86
+    unsigned int eax, ebx, ecx, edx;
+
+    if(__get_cpuid_count(7,0,&eax,&ebx,&ecx,&edx)){
+        return (ebx >> 29) & 1;
+    }
+#endif
+
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      LaneHasher::is_supported
+// Description:
+//      Check the cpu for the instructions a backend needs
+// ----------------------------------------------------------------------------
+bool LaneHasher::is_supported( Backend t_backend ){
+
+#ifdef RECHAIN_X86
+    __builtin_cpu_init();
+
+    switch(t_backend){
+        case Backend::AVX512: return __builtin_cpu_supports("avx512f");
+        case Backend::AVX2:   return __builtin_cpu_supports("avx2");
+        default:              return true;
+    }
+#else
+    return t_backend == Backend::Scalar;
+#endif
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      LaneHasher::detect
+// Description:
+//      Pick the fastest backend. A single SHA-NI hash is quicker than
+//      a lane of AVX2/AVX-512, so cpus with the SHA extensions stay
+//      on the scalar (CryptoPP) backend.
+// ----------------------------------------------------------------------------
+LaneHasher::Backend LaneHasher::detect(){
+
+    if(sha_extensions()){
+        return Backend::Scalar;
+    }
+
+    if(is_supported(Backend::AVX512)){
+        return Backend::AVX512;
+    }
+
+    if(is_supported(Backend::AVX2)){
+        return Backend::AVX2;
+    }
+
+    return Backend::Scalar;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      LaneHasher::get_backend
+// Description:
+//      Get the backend in use
+// ----------------------------------------------------------------------------
+LaneHasher::Backend LaneHasher::get_backend(){
+    return m_backend;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      LaneHasher::set_backend
+// Description:
+//      Use a backend if the cpu supports it
+// ----------------------------------------------------------------------------
+bool LaneHasher::set_backend( Backend t_backend ){
+
+    if(!is_supported(t_backend)){
+        return false;
+    }
+
+    m_backend = t_backend;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      LaneHasher::get_name
+// Description:
+//      Get a printable name for a backend
+// ----------------------------------------------------------------------------
+std::string LaneHasher::get_name( Backend t_backend ){
+    switch(t_backend){
+        case Backend::AVX512: return "avx512";
+        case Backend::AVX2:   return "avx2";
+        default:              return "scalar";
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      LaneHasher::get_lanes
+// Description:
+//      Get the number of messages hashed per pass
+// ----------------------------------------------------------------------------
+size_t LaneHasher::get_lanes(){
+    switch(m_backend){
+        case Backend::AVX512: return 16;
+        case Backend::AVX2:   return 8;
+        default:              return 1;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      LaneHasher::start
+// Description:
+//      Compress the whole blocks of the prefix and return the state
+// ----------------------------------------------------------------------------
+LaneState LaneHasher::start( const std::string& t_prefix, std::string& t_remainder ){
+
+    LaneState result;
+    std::copy(IV,IV + 8,result.h);
+    result.length = 0;
+
+    uint32_t words[16];
+    uint32_t mask = 0xFFFFFFFF;
+
+    const unsigned char* data = (const unsigned char*)t_prefix.data();
+
+    while(t_prefix.size() - result.length >= BLOCK_SIZE){
+        for(size_t i = 0; i < 16; ++i){
+            words[i] = load_word(data + result.length + i*4);
+        }
+
+        compress_scalar(result.h,words,&mask);
+        result.length += BLOCK_SIZE;
+    }
+
+    t_remainder = t_prefix.substr(result.length);
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      LaneHasher::finish
+// Description:
+//      Finish hashing the tails with the current backend
+// ----------------------------------------------------------------------------
+void LaneHasher::finish( const LaneState& t_state, const std::vector<std::string>& t_tails, unsigned char* t_digests ){
+
+    switch(m_backend){
+#ifdef RECHAIN_X86
+        case Backend::AVX512:
+            run_lanes(16,compress_avx512,t_state,t_tails,t_digests);
+            break;
+        case Backend::AVX2:
+            run_lanes(8,compress_avx2,t_state,t_tails,t_digests);
+            break;
+#endif
+        default:
+            run_lanes(1,compress_scalar,t_state,t_tails,t_digests);
+            break;
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      LaneHasher::digest
+// Description:
+//      Hash complete messages. The scalar backend uses CryptoPP so that
+//      it gets the SHA extensions where they exist.
+// ----------------------------------------------------------------------------
+void LaneHasher::digest( const std::vector<std::string>& t_messages, unsigned char* t_digests ){
+
+    if(m_backend == Backend::Scalar){
+        CryptoPP::SHA256 hasher;
+
+        for(size_t i = 0; i < t_messages.size(); ++i){
+            hasher.CalculateDigest(t_digests + i*32,
+                (const unsigned char*)t_messages[i].data(),
+                t_messages[i].size());
+        }
+
+        return;
+    }
+
+    LaneState initial;
+    std::copy(IV,IV + 8,initial.h);
+    initial.length = 0;
+
+    finish(initial,t_messages,t_digests);
+}
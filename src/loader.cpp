@@ -0,0 +1,280 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+
+// system includes
+#include <map>
+#include <deque>
+#include <algorithm>
+#include <stdexcept>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <exception>
+
+// local includes
+#include "loader.hpp"
+#include "logger.hpp"
+
+/** \brief A chunk of records and the results of checking them */
+struct LoaderChunk {
+    uint64_t sequence;                  /**< The position of the chunk in the chain */
+    Loader::chunk_t records;            /**< The records in chain order */
+    std::vector<char> valid;            /**< True for each record that passed */
+};
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Loader::Loader
+// Description:
+//      Construct a Loader with a given number of workers
+// ----------------------------------------------------------------------------
+Loader::Loader( size_t t_threads, size_t t_chunk ) 
+    : m_threads(t_threads), m_chunk(t_chunk), m_depth(0), m_progress(), m_failed(0) {
+
+    // hardware_concurrency may return 0 if it can't tell
+    if(m_threads == 0){
+        m_threads = std::thread::hardware_concurrency();
+    }
+
+    if(m_threads == 0){
+        m_threads = 1;
+    }
+
+    if(m_chunk == 0){
+        throw std::invalid_argument("chunks must hold at least one record");
+    }
+
+    // enough for every worker to have a chunk and one more to be read
+    m_depth = 2 * m_threads + 1;
+
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Loader::source
+// Description:
+//      Hand out records that are already in memory in chunks
+// ----------------------------------------------------------------------------
+Loader::source_t Loader::source( const std::vector< std::shared_ptr<BaseRecord> >& t_records ){
+
+    auto position = std::make_shared<size_t>(0);
+
+    return [t_records,position]( chunk_t& t_out, size_t t_count ){
+        size_t end = std::min(*position + t_count,t_records.size());
+        t_out.insert(t_out.end(),t_records.begin() + *position,t_records.begin() + end);
+        *position = end;
+        return true;
+    };
+
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Loader::run
+// Description:
+//      Read chunks on one thread, check them on the workers and sink
+//      them in order on this thread, with at most m_depth chunks
+//      between the reader and the sink
+// ----------------------------------------------------------------------------
+bool Loader::run( uint64_t t_total, source_t t_source, sink_t t_sink ){
+
+    std::mutex mutex;
+    std::condition_variable changed;
+
+    std::deque< std::shared_ptr<LoaderChunk> > pending;             // read, waiting for a worker
+    std::map< uint64_t, std::shared_ptr<LoaderChunk> > checked;     // checked, waiting for the sink
+
+    uint64_t produced  = 0;         // chunks read so far
+    size_t in_flight   = 0;         // chunks read but not sunk
+    bool finished      = false;     // the source has nothing more
+    bool unreadable    = false;     // the source failed
+    bool stopped       = false;     // the sink failed, so everything stops
+
+    std::thread reader([&]{
+
+        while(true){
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock,[&]{ return in_flight < m_depth || stopped; });
+
+                if(stopped){
+                    break;
+                }
+            }
+
+            auto chunk = std::make_shared<LoaderChunk>();
+            chunk->records.reserve(m_chunk);
+
+            bool read = false;
+            try {
+                read = t_source(chunk->records,m_chunk);
+            } catch (const std::exception& e){
+                RCERROR(e.what());
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            // whatever was read before a failure is still checked
+            if(!chunk->records.empty()){
+                chunk->sequence = produced++;
+                in_flight++;
+                pending.push_back(chunk);
+            }
+
+            if(!read || chunk->records.empty()){
+                unreadable = !read;
+                finished = true;
+                changed.notify_all();
+                break;
+            }
+
+            changed.notify_all();
+        }
+
+    });
+
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i < m_threads; ++i){
+        workers.push_back(std::thread([&]{
+
+            while(true){
+
+                std::shared_ptr<LoaderChunk> chunk;
+
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock,[&]{ return !pending.empty() || finished || stopped; });
+
+                    if(stopped || pending.empty()){
+                        break;
+                    }
+
+                    chunk = pending.front();
+                    pending.pop_front();
+                }
+
+                // a batch that can't be hashed fails as a whole
+                chunk->valid.assign(chunk->records.size(),false);
+
+                try {
+                    BaseRecord::hash_batch(chunk->records);
+
+                    for(size_t j = 0; j < chunk->records.size(); ++j){
+                        try {
+                            chunk->valid[j] = chunk->records[j]->is_valid();
+                        } catch (const std::exception& e){
+                            chunk->valid[j] = false;
+                        }
+                    }
+                } catch (const std::exception& e){
+                    RCERROR(std::string("records couldn't be hashed: ") + e.what());
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                checked[chunk->sequence] = chunk;
+                changed.notify_all();
+            }
+
+        }));
+    }
+
+    uint64_t next  = 0;
+    uint64_t index = 0;
+    bool success   = true;
+
+    // the sink and progress are the caller's, so if they throw the
+    // other threads are stopped and joined before it's passed on
+    std::exception_ptr error;
+
+    try {
+
+        while(success){
+
+            std::shared_ptr<LoaderChunk> chunk;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock,[&]{ return checked.count(next) || (finished && next == produced); });
+
+                auto it = checked.find(next);
+                if(it == checked.end()){
+                    break;
+                }
+
+                chunk = it->second;
+                checked.erase(it);
+            }
+
+            for(size_t i = 0; i < chunk->records.size() && success; ++i){
+                if(!chunk->valid[i]){
+                    RCERROR("record " + std::to_string(index) + " isn't valid");
+                    success = false;
+                }
+                else if(!t_sink(chunk->records[i])){
+                    success = false;
+                }
+                else {
+                    index++;
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                in_flight--;
+                stopped = !success;
+                changed.notify_all();
+            }
+
+            next++;
+
+            if(m_progress){
+                m_progress(index,t_total);
+            }
+        }
+
+    } catch (...){
+        error = std::current_exception();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+        changed.notify_all();
+    }
+
+    reader.join();
+    for(auto& worker : workers){
+        worker.join();
+    }
+
+    if(error){
+        m_failed = index;
+        std::rethrow_exception(error);
+    }
+
+    if(success && unreadable){
+        RCERROR("record " + std::to_string(index) + " couldn't be read");
+        success = false;
+    }
+
+    m_failed = index;
+    return success;
+}
@@ -29,6 +29,7 @@
 // dependency includes
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
+#include <boost/lexical_cast.hpp>
 
 // local includes
 #include "manager.hpp"
@@ -37,6 +38,9 @@
 #include "config.hpp"
 #include "remote.hpp"
 #include "utility.hpp"
+#include "generator.hpp"
+#include "signature_cache.hpp"
+#include "validator.hpp"
 
 namespace fs = boost::filesystem;
 
@@ -47,9 +51,46 @@ namespace fs = boost::filesystem;
 // Description:
 //      Construct a Manager instance
 // ----------------------------------------------------------------------------
-Manager::Manager() : m_configured(false), m_blockchain() {
+Manager::Manager() : m_configured(false), m_blockchain(), m_mining_server() {
     m_private_key = std::make_shared<PrivateKey>(PrivateKey::empty());
-    m_private_key->generate();
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      file_format
+// Description:
+//      Get the FileFormat for a configured name ('text' or 'binary')
+// ----------------------------------------------------------------------------
+static FileFormat file_format( std::string t_name ){
+
+    if(t_name == "text"){
+        return FileFormat::TextFile;
+    }
+
+    if(t_name == "binary"){
+        return FileFormat::BinaryFile;
+    }
+
+    throw std::invalid_argument("unknown chain format: " + t_name);
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      key_type
+// Description:
+//      Get the KeyType for a configured name ('rsa' or 'ed25519')
+// ----------------------------------------------------------------------------
+static KeyType key_type( std::string t_name ){
+
+    if(t_name.empty() || t_name == "rsa"){
+        return KeyType::RSAKey;
+    }
+
+    if(t_name == "ed25519"){
+        return KeyType::Ed25519Key;
+    }
+
+    throw std::invalid_argument("unknown key type: " + t_name);
 }
 
 // ----------------------------------------------------------------------------
@@ -58,7 +99,11 @@ Manager::Manager() : m_configured(false), m_blockchain() {
 // Description:
 //      Called when Manager is destroyed
 // ----------------------------------------------------------------------------
-Manager::~Manager(){}
+Manager::~Manager(){
+    if(m_configured){
+        SignatureCache::save();
+    }
+}
 
 // ----------------------------------------------------------------------------
 // Name: 
@@ -130,16 +175,91 @@ bool Manager::configure( Level level ){
             .with( Log("console",STDOUT,level) )
             .with( Log("log",Config::get()->setting("log"),Level::error) );
 
-        // load the blockchain or create a new one
-        if(!m_blockchain.load(blockchain_path)){
-            m_blockchain.save(blockchain_path);
+        // use the configured difficulty if there is one
+        std::string difficulty = Config::get()->setting("difficulty");
+        if(!difficulty.empty()){
+            BaseRecord::set_difficulty(boost::lexical_cast<unsigned int>(difficulty));
+
+            if(BaseRecord::get_difficulty() < MIN_REMOTE_DIFFICULTY){
+                RCWARNING("records from peers still need a difficulty of " + std::to_string(MIN_REMOTE_DIFFICULTY));
+            }
+        }
+
+        // accept mining workers if a port is configured
+        std::string mining_port = Config::get()->setting("mining_port");
+        if(!mining_port.empty()){
+            m_mining_server = std::make_shared<MiningServer>(boost::lexical_cast<unsigned short>(mining_port));
+            m_mining_server->start();
+            m_blockchain.set_mining_server(m_mining_server);
+        }
+
+        // signatures verified on an earlier run aren't verified again,
+        // unless every signature was asked for
+        SignatureCache::set_forced(Config::get()->setting("full_verify") == "true");
+        SignatureCache::open(Config::get()->setting("verified"),SignatureCache::load_secret(Config::get()->setting("secret")));
+
+        // records are appended to segments. a chain file from before
+        // segments is loaded once and imported into them.
+        std::string segments = Config::get()->setting("segments");
+
+        // report every tenth of a large chain as it's checked
+        uint64_t reported = 0;
+        auto progress = [&reported]( uint64_t t_done, uint64_t t_total ){
+            if(t_total > 0 && t_done * 10 / t_total > reported){
+                reported = t_done * 10 / t_total;
+                RCINFO("checked " + std::to_string(t_done) + " of " + std::to_string(t_total) + " records");
+            }
+        };
+
+        // a chain file that can't be loaded is left alone, rather
+        // than starting over with an empty chain
+        if(!SegmentStore::exists(segments) && fs::exists(blockchain_path)){
+            if(!m_blockchain.load(blockchain_path,progress)){
+                RCERROR("the blockchain file is damaged, so it wasn't imported: " + blockchain_path);
+                return false;
+            }
+            reported = 0;
+        }
+
+        // sealed segments are mapped unless it's turned off
+        bool mapped = Config::get()->setting("mapped_segments") != "false";
+
+        // only records after the last snapshot are checked, unless
+        // a full check was asked for
+        std::string interval = Config::get()->setting("snapshot_interval");
+        if(interval.empty()){
+            m_blockchain.set_snapshot(Config::get()->setting("snapshot"));
+        }
+        else {
+            m_blockchain.set_snapshot(Config::get()->setting("snapshot"),boost::lexical_cast<size_t>(interval));
+        }
+
+        m_blockchain.set_full_check(Config::get()->setting("full_check") == "true");
+
+        // segments and snapshots are left uncompressed unless it's turned on
+        m_blockchain.set_compressed(Config::get()->setting("compress_segments") == "true");
+
+        if(!m_blockchain.open(segments,mapped,progress)){
+            RCERROR("failed to open the blockchain segments: " + segments);
+            return false;
+        }
+
+        SignatureCache::save();
+
+        // save in the configured format, if there is one
+        std::string chain_format = Config::get()->setting("chain_format");
+        if(!chain_format.empty()){
+            m_blockchain.set_file_format(file_format(chain_format));
         }
         
-        // load the private key or create a new one
+        // load the private key or create a new one of the configured
+        // type. records say which type signed them, so identities
+        // of both types can share a chain.
         if(fs::exists(private_key_path)){
             m_private_key.reset(PrivateKey::load_file(private_key_path)); 
         }
         else {
+            m_private_key->generate(key_type(Config::get()->setting("key_type")));
             m_private_key->save(private_key_path);
         }
 
@@ -168,11 +288,11 @@ bool Manager::publish( std::string t_path ){
 
             std::shared_ptr<PublicationRecord> record(new PublicationRecord(t_path));
 
-            std::string path = Config::get()->setting("blockchain");
-
-            result = ( m_blockchain.publish(record,m_private_key) &&
-                       m_blockchain.is_valid()                    &&
-                       m_blockchain.save(path)                      );
+            // the new record was checked when it was appended, so
+            // this only checks records that weren't
+            result = ( m_blockchain.publish(record,m_private_key)                    &&
+                       m_blockchain.validate_from(m_blockchain.get_validated())     &&
+                       m_blockchain.sync()                                             );
         }
 
     }
@@ -207,7 +327,7 @@ bool Manager::sign( std::string t_hash ){
     if(record && record->get_type() == RecordType::Publication){
 
         std::shared_ptr<SignatureRecord> record(new SignatureRecord(t_hash));
-        return m_blockchain.publish(record,m_private_key);
+        return m_blockchain.publish(record,m_private_key) && m_blockchain.sync();
 
     }
 
@@ -306,3 +426,86 @@ bool Manager::is_valid(){
 
     return false;
 }
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      work
+// Description:
+//      Run as a mining worker for another node. 
+// ----------------------------------------------------------------------------
+bool Manager::work( std::string t_address ){
+
+    size_t split = t_address.rfind(':');
+
+    if(split == std::string::npos){
+        RCERROR("worker address must be 'host:port'");
+        return false;
+    }
+
+    MiningWorker worker(t_address.substr(0,split),t_address.substr(split + 1));
+
+    uint64_t units = worker.run();
+    RCINFO("mined " + std::to_string(units) + " units, " + 
+           std::to_string(worker.get_solutions()) + " solutions accepted");
+
+    return units > 0;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      generate
+// Description:
+//      Write a synthetic chain at the configured difficulty. 
+// ----------------------------------------------------------------------------
+bool Manager::generate( std::string t_path, size_t t_records, size_t t_authors, double t_ratio, std::string t_keys ){
+
+    try {
+
+        Generator generator(t_records,t_authors,t_ratio,BaseRecord::get_difficulty());
+        generator.set_keys(t_keys);
+
+        if(generator.generate(t_path)){
+            RCINFO("generated " + std::to_string(t_records) + " records: " + t_path);
+            return true;
+        }
+
+    } catch (const std::invalid_argument& e){
+
+        RCERROR(e.what());
+
+    }
+
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      convert
+// Description:
+//      Rewrite the Blockchain in another file format. 
+// ----------------------------------------------------------------------------
+bool Manager::convert( std::string t_format ){
+
+    if(!m_configured){
+        RCERROR("manager is not configured");
+        return false;
+    }
+
+    try {
+
+        m_blockchain.set_file_format(file_format(t_format));
+
+    } catch (const std::invalid_argument& e){
+
+        RCERROR(e.what());
+        return false;
+
+    }
+
+    if(save()){
+        RCINFO("blockchain was converted to " + t_format);
+        return true;
+    }
+
+    return false;
+}
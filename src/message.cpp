@@ -74,18 +74,31 @@ void Message::read(boost::asio::ip::tcp::socket& socket){
    
     boost::asio::streambuf buf;
     boost::asio::read_until(socket, buf, "\r\n\r\n");
-    std::istream stream(&buf);
+
+    size_t content_length = read_header(buf);
+
+    if(content_length > 0){
+
+        // read the remainder of the message into the body
+        boost::asio::read(socket, buf, boost::asio::transfer_exactly(content_length));
+        read_body(buf);
+
+    }
+}
+
+size_t Message::read_header(boost::asio::streambuf& buf){
 
     // get the the first chunk, including the header 
     std::string chunked(std::istreambuf_iterator<char>(&buf), {});
 
-    std::vector<std::string> tmp;
-    iter_split(tmp, chunked, boost::algorithm::first_finder("\r\n\r\n"));
+    // split at the first blank line only, the body
+    // may be binary and contain blank lines itself
+    size_t split = chunked.find("\r\n\r\n");
 
-    // if we got something assume the first index
+    // if we got something assume the first part
     // is the header
-    if(tmp.size() > 0){
-        std::string s_header = tmp[0];
+    if(split != std::string::npos){
+        std::string s_header = chunked.substr(0,split);
 
         // parse the header values
         parse_header(s_header);
@@ -94,19 +107,20 @@ void Message::read(boost::asio::ip::tcp::socket& socket){
 
         if(content_length > 0){
             
-            if(tmp.size() > 1)
-                m_body.append(tmp[1]); // add the remainder to the body
-
-            content_length -= m_body.length();
+            // add the remainder to the body
+            m_body.append(chunked.substr(split + 4,content_length));
 
-            // read the remainder of the message into the body
-            boost::asio::read(socket, buf, boost::asio::transfer_exactly(content_length));
-            std::string remainder(std::istreambuf_iterator<char>(&buf), {});
-             
-            m_body.append(remainder);
+            return content_length - m_body.length();
 
         }
     }
+
+    return 0;
+}
+
+void Message::read_body(boost::asio::streambuf& buf){
+    std::string remainder(std::istreambuf_iterator<char>(&buf), {});
+    m_body.append(remainder);
 }
 
 std::string Message::serialize(){
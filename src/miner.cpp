@@ -0,0 +1,540 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+// system includes
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <stdexcept>
+#include <exception>
+#include <algorithm>
+
+// dependency includes
+#include <cryptopp/osrng.h>     // for the AutoSeededRandomPool
+#include <cryptopp/integer.h>   // for Integer data type
+
+// local includes
+#include "miner.hpp"
+#include "base_record.hpp"
+#include "logger.hpp"
+
+using namespace std::chrono;
+
+/** The number of attempts each worker makes between progress updates
+    and timestamp refreshes */
+#define INTERRUPT_INTERVAL 4096
+
+// ----------------------------------------------------------------------------
+// Name:
+//      current_time
+// Description:
+//      Get the current time in seconds since the epoch
+// ----------------------------------------------------------------------------
+static long current_time(){
+    auto e = system_clock::now().time_since_epoch();
+    return (long)duration_cast<seconds>(e).count();
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MidState::MidState
+// Description:
+//      Split the record and hash the prefix
+// ----------------------------------------------------------------------------
+MidState::MidState( BaseRecord* t_record ) 
+    : m_hasher(), m_lanes(), m_remainder(), m_suffix(), m_format(t_record->get_format()), m_valid(false) {
+
+    std::string prefix;
+
+    if(t_record->split(prefix,m_suffix)){
+        start(prefix);
+    }
+    else {
+        RCWARNING("record could not be split for mining");
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MidState::MidState
+// Description:
+//      Hash a prefix that was split from a record elsewhere
+// ----------------------------------------------------------------------------
+MidState::MidState( const std::string& t_prefix, const std::string& t_suffix, HashFormat t_format ) 
+    : m_hasher(), m_lanes(), m_remainder(), m_suffix(t_suffix), m_format(t_format), m_valid(false) {
+    start(t_prefix);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MidState::start
+// Description:
+//      Add the prefix to the hasher and the lane state
+// ----------------------------------------------------------------------------
+void MidState::start( const std::string& t_prefix ){
+    m_hasher.Update((const unsigned char*)t_prefix.data(),t_prefix.size());
+    m_lanes = LaneHasher::start(t_prefix,m_remainder);
+    m_valid = true;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MidState::~MidState
+// Description:
+//      Empty destructor
+// ----------------------------------------------------------------------------
+MidState::~MidState(){}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MidState::hash
+// Description:
+//      Get the hex encoded hash for the given values
+// ----------------------------------------------------------------------------
+std::string MidState::hash( long t_nonce, long t_timestamp, uint32_t t_counter ){
+
+    static const char* digits = "0123456789ABCDEF";
+
+    unsigned char data[DIGEST_SIZE];
+    digest(t_nonce,t_timestamp,t_counter,data);
+
+    // hex encode the same way as the HexEncoder
+    std::string result(2*DIGEST_SIZE,'0');
+    for(size_t i = 0; i < DIGEST_SIZE; ++i){
+        result[2*i]   = digits[data[i] >> 4];
+        result[2*i+1] = digits[data[i] & 0x0F];
+    }
+
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MidState::digest
+// Description:
+//      Copy the saved hasher and finish hashing with the given values
+// ----------------------------------------------------------------------------
+void MidState::digest( long t_nonce, long t_timestamp, uint32_t t_counter, unsigned char* t_digest ){
+
+    std::string data = BaseRecord::hashing_data(t_nonce,t_timestamp,t_counter,m_format);
+    data.append(m_suffix);
+
+    CryptoPP::SHA256 hasher(m_hasher);
+    hasher.Update((const unsigned char*)data.data(),data.size());
+    hasher.Final(t_digest);
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MidState::digest
+// Description:
+//      Finish hashing with each of the given counters, one per lane
+// ----------------------------------------------------------------------------
+void MidState::digest( long t_nonce, long t_timestamp, const std::vector<uint32_t>& t_counters, unsigned char* t_digests ){
+
+    std::vector<std::string> tails;
+
+    for(auto& counter : t_counters){
+        tails.push_back(m_remainder + BaseRecord::hashing_data(t_nonce,t_timestamp,counter,m_format) + m_suffix);
+    }
+
+    LaneHasher::finish(m_lanes,tails,t_digests);
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Miner::Miner
+// Description:
+//      Construct a Miner with one worker per core
+// ----------------------------------------------------------------------------
+Miner::Miner() : Miner(0) {}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Miner::Miner
+// Description:
+//      Construct a Miner with a given number of workers
+// ----------------------------------------------------------------------------
+Miner::Miner( size_t t_threads ) : m_threads(t_threads), m_attempts(), m_seconds(0), m_progress(0), m_interrupt() {
+
+    // hardware_concurrency may return 0 if it can't tell
+    if(m_threads == 0){
+        m_threads = std::thread::hardware_concurrency();
+    }
+
+    if(m_threads == 0){
+        m_threads = 1;
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Miner::~Miner
+// Description:
+//      Empty destructor
+// ----------------------------------------------------------------------------
+Miner::~Miner(){}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Miner::mine
+// Description:
+//      Draw one random starting nonce and give worker i the nonces
+//      start + i, start + i + threads, ... Each worker walks the whole
+//      counter range of a nonce before moving to its next one, so no two
+//      workers hash the same values and no entropy is needed after the
+//      first draw. Workers hash from a shared MidState,
+//      one counter per LaneHasher lane, or from their own copy of the
+//      record if it can't be split. The winning values are written back
+//      to the given record. Workers refresh the timestamp, report
+//      progress and call the interrupt check every INTERRUPT_INTERVAL
+//      attempts.
+// ----------------------------------------------------------------------------
+std::string Miner::mine( BaseRecord* t_record ){
+
+    RCDEBUG("mining record with " + std::to_string(m_threads) + " threads");
+
+    if(t_record->get_signature().empty()){
+        RCERROR("record has not been signed");
+        throw std::invalid_argument("record has not been signed");
+    }
+
+    // seed once, leaving room above the start for every worker to move on
+    CryptoPP::AutoSeededRandomPool rng;
+    long first_nonce = CryptoPP::Integer(rng,
+        CryptoPP::Integer(1),
+        CryptoPP::Integer(LONG_MAX / 2)).ConvertToLong();
+
+    // the signed prefix is only hashed once
+    MidState state(t_record);
+
+    unsigned int difficulty = BaseRecord::get_difficulty();
+
+    std::atomic<bool> found(false);
+    bool interrupted = false;
+    std::exception_ptr error;
+    std::mutex lock;
+
+    long nonce        = 0;
+    long timestamp    = 0;
+    uint32_t counter  = 0;
+
+    m_attempts.assign(m_threads,0);
+    m_progress = 0;
+    std::vector<std::thread> workers;
+
+    auto start = steady_clock::now();
+
+    for(size_t i = 0; i < m_threads; ++i){
+        workers.emplace_back([&,i]{
+
+            uint64_t attempts = 0;
+            uint64_t reported = 0;
+
+            try {
+
+                // only needed if the record couldn't be split
+                std::shared_ptr<BaseRecord> record;
+                if(!state.is_valid()){
+                    record = t_record->clone();
+                }
+
+                long worker_nonce       = first_nonce + (long)i;
+                long worker_timestamp   = current_time();
+                uint32_t worker_counter = t_record->m_counter;
+
+                // try one counter per lane on every pass
+                size_t lanes = (record) ? 1 : LaneHasher::get_lanes();
+
+                std::vector<uint32_t> counters(lanes);
+                std::vector<unsigned char> digests(lanes * DIGEST_SIZE);
+
+                while(!found.load(std::memory_order_relaxed)){
+
+                    // move to the next nonce before the counter wraps
+                    if(worker_counter > UINT32_MAX - lanes){
+                        worker_nonce  += (long)m_threads;
+                        worker_counter = 0;
+                    }
+
+                    // update the counters
+                    for(auto& counter : counters){
+                        counter = ++worker_counter;
+                    }
+
+                    attempts += lanes;
+
+                    // update the timestamp, report progress and
+                    // check if mining should stop
+                    if(attempts - reported >= INTERRUPT_INTERVAL){
+                        worker_timestamp = current_time();
+
+                        m_progress += attempts - reported;
+                        reported = attempts;
+
+                        if(m_interrupt && m_interrupt()){
+                            std::lock_guard<std::mutex> guard(lock);
+
+                            if(!found){
+                                interrupted = true;
+                                found       = true;
+                            }
+
+                            break;
+                        }
+                    }
+
+                    if(record){
+                        record->m_nonce     = worker_nonce;
+                        record->m_timestamp = worker_timestamp;
+                        record->m_counter   = worker_counter;
+                        record->invalidate();
+                        record->digest().copy((char*)digests.data(),DIGEST_SIZE);
+                    }
+                    else if(lanes > 1){
+                        state.digest(worker_nonce,worker_timestamp,counters,digests.data());
+                    }
+                    else {
+                        state.digest(worker_nonce,worker_timestamp,worker_counter,digests.data());
+                    }
+
+                    for(size_t l = 0; l < lanes; ++l){
+                        if(BaseRecord::meets_difficulty(&digests[l * DIGEST_SIZE],difficulty)){
+                            std::lock_guard<std::mutex> guard(lock);
+
+                            if(!found){
+                                nonce     = worker_nonce;
+                                timestamp = worker_timestamp;
+                                counter   = counters[l];
+                                found     = true;
+                            }
+
+                            break;
+                        }
+                    }
+
+                }
+
+            } catch(...){
+                std::lock_guard<std::mutex> guard(lock);
+                error = std::current_exception();
+                found = true;
+            }
+
+            m_attempts[i] = attempts;
+            m_progress += attempts - reported;
+
+        });
+    }
+
+    for(auto& worker : workers){
+        worker.join();
+    }
+
+    m_seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+    if(error){
+        RCERROR("a mining worker failed");
+        std::rethrow_exception(error);
+    }
+
+    if(interrupted){
+        RCINFO("mining was interrupted");
+        return "";
+    }
+
+    // write the winning values back to the record
+    t_record->m_nonce     = nonce;
+    t_record->m_timestamp = timestamp;
+    t_record->m_counter   = counter;
+    t_record->invalidate();
+
+    RCINFO("record was mined at " + std::to_string((long)get_hash_rate()) + " hashes/sec");
+    return t_record->hash();
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Miner::mine
+// Description:
+//      Mine a record held in a shared_ptr
+// ----------------------------------------------------------------------------
+std::string Miner::mine( std::shared_ptr<BaseRecord> t_record ){
+    return mine(t_record.get());
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Miner::search
+// Description:
+//      Give each worker an equal share of the counter range and stop
+//      them all once one finds a valid hash. Used to mine work units
+//      handed out by a MiningServer.
+// ----------------------------------------------------------------------------
+bool Miner::search( MidState& t_state, long t_nonce, long t_timestamp, uint32_t t_first, uint64_t t_count,
+                    unsigned int t_difficulty, uint32_t& t_counter ){
+
+    if(!t_state.is_valid()){
+        RCERROR("can't search without a valid midstate");
+        throw std::invalid_argument("can't search without a valid midstate");
+    }
+
+    uint64_t share = (t_count + m_threads - 1) / m_threads;
+
+    std::atomic<bool> found(false);
+    bool success = false;
+    std::exception_ptr error;
+    std::mutex lock;
+
+    m_attempts.assign(m_threads,0);
+    m_progress = 0;
+    std::vector<std::thread> workers;
+
+    auto start = steady_clock::now();
+
+    for(size_t i = 0; i < m_threads; ++i){
+        workers.emplace_back([&,i]{
+
+            uint64_t attempts = 0;
+            uint64_t reported = 0;
+
+            try {
+
+                uint64_t next = i * share;
+                uint64_t last = std::min(t_count,next + share);
+
+                size_t lanes = LaneHasher::get_lanes();
+
+                std::vector<uint32_t> counters;
+                std::vector<unsigned char> digests(lanes * DIGEST_SIZE);
+
+                while(next < last && !found.load(std::memory_order_relaxed)){
+
+                    counters.clear();
+                    while(counters.size() < lanes && next < last){
+                        counters.push_back((uint32_t)(t_first + next++));
+                    }
+
+                    attempts += counters.size();
+
+                    if(attempts - reported >= INTERRUPT_INTERVAL){
+                        m_progress += attempts - reported;
+                        reported = attempts;
+
+                        if(m_interrupt && m_interrupt()){
+                            found = true;
+                            break;
+                        }
+                    }
+
+                    if(counters.size() > 1){
+                        t_state.digest(t_nonce,t_timestamp,counters,digests.data());
+                    }
+                    else {
+                        t_state.digest(t_nonce,t_timestamp,counters[0],digests.data());
+                    }
+
+                    for(size_t l = 0; l < counters.size(); ++l){
+                        if(BaseRecord::meets_difficulty(&digests[l * DIGEST_SIZE],t_difficulty)){
+                            std::lock_guard<std::mutex> guard(lock);
+
+                            if(!found){
+                                t_counter = counters[l];
+                                success   = true;
+                                found     = true;
+                            }
+
+                            break;
+                        }
+                    }
+
+                }
+
+            } catch(...){
+                std::lock_guard<std::mutex> guard(lock);
+                error = std::current_exception();
+                found = true;
+            }
+
+            m_attempts[i] = attempts;
+            m_progress += attempts - reported;
+
+        });
+    }
+
+    for(auto& worker : workers){
+        worker.join();
+    }
+
+    m_seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+    if(error){
+        RCERROR("a mining worker failed");
+        std::rethrow_exception(error);
+    }
+
+    return success;
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Miner::get_thread_rates
+// Description:
+//      Get the hashes/sec of each worker during the last mine
+// ----------------------------------------------------------------------------
+std::vector<double> Miner::get_thread_rates(){
+
+    std::vector<double> rates;
+
+    for(auto& attempts : m_attempts){
+        rates.push_back((m_seconds > 0) ? (attempts/m_seconds) : 0);
+    }
+
+    return rates;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Miner::get_hash_rate
+// Description:
+//      Get the combined hashes/sec of all workers during the last mine
+// ----------------------------------------------------------------------------
+double Miner::get_hash_rate(){
+
+    double rate = 0;
+
+    for(auto& thread_rate : get_thread_rates()){
+        rate += thread_rate;
+    }
+
+    return rate;
+}
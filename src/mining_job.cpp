@@ -0,0 +1,218 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+// system includes
+#include <string>
+#include <memory>
+#include <chrono>
+#include <exception>
+
+// local includes
+#include "mining_job.hpp"
+#include "logger.hpp"
+
+using namespace std::chrono;
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningJob::MiningJob
+// Description:
+//      Save the record, key and chain callbacks
+// ----------------------------------------------------------------------------
+MiningJob::MiningJob( std::shared_ptr<BaseRecord> t_record,
+                      std::shared_ptr<PrivateKey> t_key,
+                      std::function<std::string()> t_tip,
+                      std::function<AppendResult(std::shared_ptr<BaseRecord>)> t_append,
+                      size_t t_threads,
+                      std::shared_ptr<MiningServer> t_server )
+    : m_record(t_record),
+      m_key(t_key),
+      m_tip(t_tip),
+      m_append(t_append),
+      m_miner(t_threads),
+      m_server(t_server),
+      m_cancelled(false),
+      m_finished(false),
+      m_attempts(0),
+      m_restarts(0),
+      m_started(steady_clock::now()),
+      m_promise(),
+      m_result(m_promise.get_future().share()),
+      m_thread() {}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningJob::~MiningJob
+// Description:
+//      Cancel the job and join the thread
+// ----------------------------------------------------------------------------
+MiningJob::~MiningJob(){
+
+    cancel();
+
+    if(m_thread.joinable()){
+        m_thread.join();
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningJob::start
+// Description:
+//      Run the job on a background thread and pass the result
+//      (or exception) to the promise
+// ----------------------------------------------------------------------------
+void MiningJob::start(){
+
+    m_started = steady_clock::now();
+
+    m_thread = std::thread([this]{
+        try {
+            bool result = run();
+            m_finished = true;
+            m_promise.set_value(result);
+        } catch(...){
+            m_finished = true;
+            m_promise.set_exception(std::current_exception());
+        }
+    });
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningJob::run
+// Description:
+//      Sign the record against the current tip and mine it. Mining is
+//      interrupted if the job is cancelled or the tip moves, in which
+//      case it's re-signed and mined again. If there is a MiningServer
+//      the local threads mine alongside its workers.
+// ----------------------------------------------------------------------------
+bool MiningJob::run(){
+
+    while(!m_cancelled){
+
+        std::string previous = m_tip();
+
+        m_record->set_previous(previous);
+        m_key->sign(m_record);
+
+        m_miner.set_interrupt([this,previous]{
+            return m_cancelled || m_tip() != previous;
+        });
+
+        std::string hash;
+        if(m_server){
+            hash = m_server->mine(m_record.get(),&m_miner);
+        }
+        else {
+            hash = m_miner.mine(m_record);
+        }
+        m_attempts += m_miner.get_progress();
+
+        if(!hash.empty()){
+
+            // append checks the record, so it's only verified once
+            AppendResult appended = m_append(m_record);
+
+            if(appended == AppendResult::Appended){
+                RCINFO("record was published: " + hash);
+                return true;
+            }
+
+            // only a moved tip is worth mining again
+            if(appended == AppendResult::Failed){
+                RCERROR("record couldn't be appended: " + hash);
+                return false;
+            }
+
+        }
+
+        if(!m_cancelled){
+            RCINFO("chain tip changed while mining, restarting");
+            m_restarts++;
+        }
+
+    }
+
+    RCINFO("mining job was cancelled");
+    return false;
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningJob::cancel
+// Description:
+//      Tell the job to stop at its next interrupt check
+// ----------------------------------------------------------------------------
+void MiningJob::cancel(){
+    m_cancelled = true;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningJob::wait
+// Description:
+//      Block until the job finishes and return its result
+// ----------------------------------------------------------------------------
+bool MiningJob::wait(){
+    return m_result.get();
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningJob::wait_for
+// Description:
+//      Block until the job finishes or the timeout passes
+// ----------------------------------------------------------------------------
+bool MiningJob::wait_for( double t_seconds ){
+    return m_result.wait_for(duration<double>(t_seconds)) == std::future_status::ready;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningJob::get_attempts
+// Description:
+//      Add the attempts of earlier restarts to the current progress
+// ----------------------------------------------------------------------------
+uint64_t MiningJob::get_attempts(){
+
+    if(m_finished){
+        return m_attempts;
+    }
+
+    return m_attempts + m_miner.get_progress();
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningJob::get_hash_rate
+// Description:
+//      Get the attempts per second since the job started
+// ----------------------------------------------------------------------------
+double MiningJob::get_hash_rate(){
+
+    double seconds = duration_cast<duration<double>>(steady_clock::now() - m_started.load()).count();
+    return (seconds > 0) ? (get_attempts() / seconds) : 0;
+
+}
@@ -0,0 +1,759 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+// system includes
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <climits>
+#include <stdexcept>
+#include <unistd.h>
+
+// dependency includes
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/lexical_cast.hpp>
+
+// local includes
+#include "mining_pool.hpp"
+#include "logger.hpp"
+
+using namespace boost::asio::ip;
+using namespace std::chrono;
+
+/** The first nonce handed out to workers. The local Miner
+    draws its nonces from below this. */
+#define FIRST_REMOTE_NONCE (LONG_MAX / 2 + 1)
+
+/** The seconds a worker has to send a whole request */
+#define REQUEST_TIMEOUT 10
+
+/** The most a worker's request can hold */
+#define MAX_REQUEST_SIZE 65536
+
+/** \brief A worker's connection while its request is read. The
+           handlers that read it share it, so it lives until the
+           last of them is done.
+*/
+struct MiningServer::Connection {
+
+    /** The connected socket */
+    boost::shared_ptr<tcp::socket> socket;
+
+    /** The bytes read so far */
+    boost::asio::streambuf buffer;
+
+    /** The request being read */
+    Request request;
+
+    /** Closes the socket if the request takes too long */
+    boost::asio::deadline_timer timer;
+
+    Connection( boost::asio::io_service& t_service, boost::shared_ptr<tcp::socket> t_socket )
+        : socket(t_socket),
+          buffer(MAX_REQUEST_SIZE),
+          request(),
+          timer(t_service) {}
+
+};
+
+// ----------------------------------------------------------------------------
+// Name:
+//      property
+// Description:
+//      Read a header property of a message as a given type
+// ----------------------------------------------------------------------------
+template <typename T>
+static T property( Message& t_message, std::string t_key ){
+    std::string value = t_message.get_property(t_key);
+    return value.empty() ? T() : boost::lexical_cast<T>(value);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::MiningServer
+// Description:
+//      Set up a server with no job
+// ----------------------------------------------------------------------------
+MiningServer::MiningServer( unsigned short t_port, uint64_t t_unit ) 
+    : m_port(t_port),
+      m_unit(t_unit),
+      m_service(),
+      m_acceptor(),
+      m_thread(),
+      m_mutex(),
+      m_signal(),
+      m_active(false),
+      m_stopping(false),
+      m_job(0),
+      m_prefix(),
+      m_suffix(),
+      m_format(HashFormat::Binary),
+      m_timestamp(0),
+      m_difficulty(0),
+      m_next(0),
+      m_state(),
+      m_solved(false),
+      m_nonce(0),
+      m_counter(0),
+      m_rates(),
+      m_local_rate(0),
+      m_interrupt() {
+
+    if(m_unit == 0 || m_unit > ((uint64_t)1 << 32)){
+        RCERROR("work units must have between 1 and 2^32 counters");
+        throw std::invalid_argument("work units must have between 1 and 2^32 counters");
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::~MiningServer
+// Description:
+//      Stop listening before the service is destroyed
+// ----------------------------------------------------------------------------
+MiningServer::~MiningServer(){
+    stop();
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::start
+// Description:
+//      Open the acceptor and run the service on its own thread
+// ----------------------------------------------------------------------------
+void MiningServer::start(){
+
+    if(m_thread) return;
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stopping = false;
+    }
+
+    m_acceptor = boost::make_shared<tcp::acceptor>(m_service,tcp::endpoint(tcp::v4(),m_port));
+    m_port = m_acceptor->local_endpoint().port();
+
+    listen();
+
+    m_thread.reset(new boost::thread(
+        boost::bind(&boost::asio::io_service::run,&m_service)
+    ));
+
+    RCINFO("accepting mining workers on port " + std::to_string(m_port));
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::stop
+// Description:
+//      Stop accepting workers and wake up anything waiting on a job
+// ----------------------------------------------------------------------------
+void MiningServer::stop(){
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stopping = true;
+        m_active   = false;
+    }
+
+    m_signal.notify_all();
+
+    if(!m_thread) return;
+
+    // close the acceptor on the service thread and let the service run
+    // out of work, so connections that were already accepted get a reply
+    // (or time out) rather than being left waiting for one
+    m_service.post([this]{
+        boost::system::error_code error;
+        m_acceptor->close(error);
+    });
+
+    m_thread->join();
+
+    m_service.reset();
+    m_thread.reset();
+    m_acceptor.reset();
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::listen
+// Description:
+//      Wait for the next worker to connect
+// ----------------------------------------------------------------------------
+void MiningServer::listen(){
+    boost::shared_ptr<tcp::socket> socket(new tcp::socket(m_service));
+    m_acceptor->async_accept(*socket,boost::bind(&MiningServer::handle,this,socket));
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::handle
+// Description:
+//      Accept the next worker and start reading the request from
+//      this one. Nothing here blocks the service thread, so a worker
+//      that is slow to send its request doesn't hold up the others.
+// ----------------------------------------------------------------------------
+void MiningServer::handle( boost::shared_ptr<tcp::socket> t_socket ){
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if(m_stopping) return;
+    }
+
+    listen();
+
+    auto connection = boost::make_shared<Connection>(m_service,t_socket);
+
+    // drop a worker that doesn't send a whole request in time
+    connection->timer.expires_from_now(boost::posix_time::seconds(REQUEST_TIMEOUT));
+    connection->timer.async_wait([connection]( const boost::system::error_code& t_error ){
+        if(t_error != boost::asio::error::operation_aborted){
+            boost::system::error_code error;
+            connection->socket->close(error);
+        }
+    });
+
+    boost::asio::async_read_until(*t_socket,connection->buffer,"\r\n\r\n",
+        boost::bind(&MiningServer::read_header,this,connection,boost::asio::placeholders::error));
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::read_header
+// Description:
+//      Parse the header and read the rest of the body, if the
+//      worker sent one
+// ----------------------------------------------------------------------------
+void MiningServer::read_header( boost::shared_ptr<Connection> t_connection, const boost::system::error_code& t_error ){
+
+    if(t_error){
+        RCWARNING("bad request from a mining worker: " + t_error.message());
+        t_connection->timer.cancel();
+        return;
+    }
+
+    try {
+
+        size_t remaining = t_connection->request.read_header(t_connection->buffer);
+
+        if(remaining > MAX_REQUEST_SIZE){
+            throw std::invalid_argument("request is too large");
+        }
+
+        if(remaining > 0){
+            boost::asio::async_read(*t_connection->socket,t_connection->buffer,boost::asio::transfer_exactly(remaining),
+                boost::bind(&MiningServer::read_body,this,t_connection,boost::asio::placeholders::error));
+            return;
+        }
+
+    } catch(const std::exception& e){
+        RCWARNING(std::string("bad request from a mining worker: ") + e.what());
+        t_connection->timer.cancel();
+        return;
+    }
+
+    respond(t_connection);
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::read_body
+// Description:
+//      Add the rest of the body to the request and respond to it
+// ----------------------------------------------------------------------------
+void MiningServer::read_body( boost::shared_ptr<Connection> t_connection, const boost::system::error_code& t_error ){
+
+    if(t_error){
+        RCWARNING("bad request from a mining worker: " + t_error.message());
+        t_connection->timer.cancel();
+        return;
+    }
+
+    t_connection->request.read_body(t_connection->buffer);
+    respond(t_connection);
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::respond
+// Description:
+//      Route a request by url and write the response
+// ----------------------------------------------------------------------------
+void MiningServer::respond( boost::shared_ptr<Connection> t_connection ){
+
+    t_connection->timer.cancel();
+
+    try {
+
+        Request& request = t_connection->request;
+
+        Response response;
+        response.set_property("Connection","close");
+
+        report(request);
+
+        if(request.get_url() == "/work"){
+            work(response);
+        }
+        else if(request.get_url() == "/solution"){
+            solution(request,response);
+        }
+        else {
+            response.set_code(404);
+            response.set_status("Unknown");
+        }
+
+        response.write(*t_connection->socket);
+
+    } catch(const std::exception& e){
+        RCWARNING(std::string("bad request from a mining worker: ") + e.what());
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::report
+// Description:
+//      Save the hash rate of the worker's last unit if it was
+//      for the current job
+// ----------------------------------------------------------------------------
+void MiningServer::report( Request& t_request ){
+
+    std::string worker = t_request.get_property("Worker");
+    uint64_t job       = property<uint64_t>(t_request,"Job");
+    uint64_t attempts  = property<uint64_t>(t_request,"Attempts");
+    double seconds     = property<double>(t_request,"Seconds");
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    if(!worker.empty() && job == m_job && seconds > 0){
+        m_rates[worker] = attempts / seconds;
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::work
+// Description:
+//      Hand out the next nonce of the current job
+// ----------------------------------------------------------------------------
+void MiningServer::work( Response& t_response ){
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    if(m_stopping){
+        t_response.set_code(410);
+        t_response.set_status("Gone");
+        return;
+    }
+
+    if(!m_active){
+        t_response.set_code(204);
+        t_response.set_status("Idle");
+        return;
+    }
+
+    long nonce = FIRST_REMOTE_NONCE + (long)(m_next++);
+
+    t_response.set_code(200);
+    t_response.set_status("OK");
+    t_response.set_property("Job",std::to_string(m_job));
+    t_response.set_property("Nonce",std::to_string(nonce));
+    t_response.set_property("Timestamp",std::to_string(m_timestamp));
+    t_response.set_property("First","0");
+    t_response.set_property("Count",std::to_string(m_unit));
+    t_response.set_property("Difficulty",std::to_string(m_difficulty));
+    t_response.set_property("Prefix-Length",std::to_string(m_prefix.size()));
+    t_response.set_property("Hash-Format",std::to_string(static_cast<int>(m_format)));
+    t_response.set_body(m_prefix + m_suffix);
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::solution
+// Description:
+//      Re-hash a solution and end the job if it's valid
+// ----------------------------------------------------------------------------
+void MiningServer::solution( Request& t_request, Response& t_response ){
+
+    uint64_t job     = property<uint64_t>(t_request,"Job");
+    long nonce       = property<long>(t_request,"Nonce");
+    uint32_t counter = property<uint32_t>(t_request,"Counter");
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        if(!m_active || job != m_job){
+            t_response.set_code(409);
+            t_response.set_status("Stale");
+            return;
+        }
+
+        unsigned char digest[DIGEST_SIZE];
+        m_state->digest(nonce,m_timestamp,counter,digest);
+
+        if(!BaseRecord::meets_difficulty(digest,m_difficulty)){
+            RCWARNING("mining worker sent an invalid solution");
+            t_response.set_code(400);
+            t_response.set_status("Invalid");
+            return;
+        }
+
+        m_nonce   = nonce;
+        m_counter = counter;
+        m_solved  = true;
+        m_active  = false;
+    }
+
+    m_signal.notify_all();
+
+    t_response.set_code(200);
+    t_response.set_status("Accepted");
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::mine
+// Description:
+//      Publish a job for the record and wait for a worker (or the
+//      local miner) to solve it, then write the solution back
+// ----------------------------------------------------------------------------
+std::string MiningServer::mine( BaseRecord* t_record, Miner* t_local ){
+
+    if(t_record->get_signature().empty()){
+        RCERROR("record has not been signed");
+        throw std::invalid_argument("record has not been signed");
+    }
+
+    if(!t_local && !m_thread){
+        RCERROR("can't mine without workers or local threads");
+        throw std::invalid_argument("can't mine without workers or local threads");
+    }
+
+    std::string prefix;
+    std::string suffix;
+
+    if(!t_record->split(prefix,suffix)){
+        RCERROR("record could not be split for mining");
+        throw std::invalid_argument("record could not be split for mining");
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        m_job++;
+        m_prefix     = prefix;
+        m_suffix     = suffix;
+        m_format     = t_record->get_format();
+        m_timestamp  = (long)duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+        m_difficulty = BaseRecord::get_difficulty();
+        m_next       = 0;
+        m_state      = std::make_shared<MidState>(prefix,suffix,m_format);
+        m_solved     = false;
+        m_local_rate = 0;
+        m_active     = !m_stopping;
+
+        m_rates.clear();
+    }
+
+    std::string hash;
+
+    if(t_local){
+        // mine locally until done, solved remotely or interrupted
+        auto outer = t_local->get_interrupt();
+
+        t_local->set_interrupt([this,outer]{
+            return m_solved || (outer && outer()) || (m_interrupt && m_interrupt());
+        });
+
+        hash = t_local->mine(t_record);
+
+        t_local->set_interrupt(outer);
+        m_local_rate = t_local->get_hash_rate();
+    }
+    else {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        while(!m_solved && !m_stopping && !(m_interrupt && m_interrupt())){
+            m_signal.wait_for(lock,milliseconds(50));
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_active = false;
+
+    if(hash.empty() && m_solved){
+        t_record->m_nonce     = m_nonce;
+        t_record->m_timestamp = m_timestamp;
+        t_record->m_counter   = m_counter;
+        t_record->invalidate();
+
+        hash = t_record->hash();
+        RCINFO("record was mined by a worker: " + hash);
+    }
+
+    double rate = m_local_rate;
+    for(auto& worker : m_rates){
+        rate += worker.second;
+    }
+
+    RCINFO("pool of " + std::to_string(m_rates.size()) + " workers mined at " + 
+           std::to_string((long)rate) + " hashes/sec");
+
+    return hash;
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::get_workers
+// Description:
+//      Count the workers that reported during the current job
+// ----------------------------------------------------------------------------
+size_t MiningServer::get_workers(){
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_rates.size();
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningServer::get_hash_rate
+// Description:
+//      Add up the rates of the workers and the local miner
+// ----------------------------------------------------------------------------
+double MiningServer::get_hash_rate(){
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    double rate = m_local_rate;
+
+    for(auto& worker : m_rates){
+        rate += worker.second;
+    }
+
+    return rate;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningWorker::MiningWorker
+// Description:
+//      Name the worker after the host process and an instance count
+// ----------------------------------------------------------------------------
+MiningWorker::MiningWorker( std::string t_host, std::string t_port, size_t t_threads ) 
+    : m_host(t_host),
+      m_port(t_port),
+      m_name(),
+      m_miner(t_threads),
+      m_stopped(false),
+      m_units(0),
+      m_solutions(0) {
+
+    static std::atomic<unsigned int> instances(0);
+
+    char host[256] = {0};
+    gethostname(host,sizeof(host) - 1);
+
+    m_name = std::string(host) + "-" + std::to_string(getpid()) + "-" + std::to_string(instances++);
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningWorker::~MiningWorker
+// Description:
+//      Empty destructor
+// ----------------------------------------------------------------------------
+MiningWorker::~MiningWorker(){}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningWorker::exchange
+// Description:
+//      Connect to the server, send one request and read the response
+// ----------------------------------------------------------------------------
+bool MiningWorker::exchange( Request& t_request, Response& t_response ){
+
+    try {
+
+        boost::asio::io_service service;
+
+        tcp::resolver resolver(service);
+        tcp::resolver::query query(m_host,m_port);
+
+        tcp::socket socket(service);
+        boost::asio::connect(socket,resolver.resolve(query));
+
+        t_request.set_method("POST");
+        t_request.set_property("Host",m_host + ":" + m_port);
+        t_request.set_property("User-Agent","Rechain/1.0");
+        t_request.set_property("Worker",m_name);
+        t_request.set_property("Connection","close");
+        t_request.set_property("Content-Length","0");
+
+        t_request.write(socket);
+        t_response.read(socket);
+
+    } catch(const std::exception& e){
+        RCDEBUG(std::string("mining server can't be reached: ") + e.what());
+        return false;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningWorker::run
+// Description:
+//      Ask for units, mine them and send back solutions. Each request
+//      carries the attempts and time of the last unit.
+// ----------------------------------------------------------------------------
+uint64_t MiningWorker::run( uint64_t t_units ){
+
+    uint64_t units    = 0;
+    uint64_t job      = 0;
+    uint64_t attempts = 0;
+    double seconds    = 0;
+
+    m_miner.set_interrupt([this]{ return m_stopped.load(); });
+
+    while(!m_stopped && (t_units == 0 || units < t_units)){
+
+        Request request;
+        request.set_url("/work");
+        request.set_property("Job",std::to_string(job));
+        request.set_property("Attempts",std::to_string(attempts));
+        request.set_property("Seconds",std::to_string(seconds));
+
+        Response response;
+
+        if(!exchange(request,response)){
+            RCINFO("mining server went away");
+            break;
+        }
+
+        if(response.get_code() == 410){
+            RCINFO("mining server stopped");
+            break;
+        }
+
+        if(response.get_code() != 200){
+            std::this_thread::sleep_for(milliseconds(100));
+            continue;
+        }
+
+        uint64_t unit           = 0;
+        long nonce              = 0;
+        long timestamp          = 0;
+        uint32_t first          = 0;
+        uint64_t count          = 0;
+        unsigned int difficulty = 0;
+        size_t length           = 0;
+        int encoding            = 0;
+
+        try {
+            unit       = property<uint64_t>(response,"Job");
+            nonce      = property<long>(response,"Nonce");
+            timestamp  = property<long>(response,"Timestamp");
+            first      = property<uint32_t>(response,"First");
+            count      = property<uint64_t>(response,"Count");
+            difficulty = property<unsigned int>(response,"Difficulty");
+            length     = property<size_t>(response,"Prefix-Length");
+            encoding   = property<int>(response,"Hash-Format");
+        } catch(const boost::bad_lexical_cast& e){
+            RCWARNING(std::string("mining server sent a bad unit: ") + e.what());
+            continue;
+        }
+
+        std::string body = response.get_body();
+        if(length > body.size() || difficulty > DIGEST_SIZE*8 ||
+           (encoding != static_cast<int>(HashFormat::Text) && encoding != static_cast<int>(HashFormat::Binary))){
+            RCWARNING("mining server sent a bad unit");
+            continue;
+        }
+
+        MidState state(body.substr(0,length),body.substr(length),static_cast<HashFormat>(encoding));
+        if(!state.is_valid()){
+            RCWARNING("mining server sent a bad unit");
+            continue;
+        }
+
+        job = unit;
+
+        uint32_t counter = 0;
+        bool found = m_miner.search(state,nonce,timestamp,first,count,difficulty,counter);
+
+        units++;
+        m_units++;
+
+        attempts = 0;
+        for(auto& thread_attempts : m_miner.get_attempts()){
+            attempts += thread_attempts;
+        }
+
+        seconds = m_miner.get_seconds();
+
+        if(found){
+            Request answer;
+            answer.set_url("/solution");
+            answer.set_property("Job",std::to_string(job));
+            answer.set_property("Nonce",std::to_string(nonce));
+            answer.set_property("Timestamp",std::to_string(timestamp));
+            answer.set_property("Counter",std::to_string(counter));
+            answer.set_property("Attempts",std::to_string(attempts));
+            answer.set_property("Seconds",std::to_string(seconds));
+
+            Response result;
+            if(exchange(answer,result) && result.get_code() == 200){
+                RCINFO("solution was accepted");
+                m_solutions++;
+            }
+        }
+
+    }
+
+    return units;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      MiningWorker::stop
+// Description:
+//      Stop mining at the next interrupt check
+// ----------------------------------------------------------------------------
+void MiningWorker::stop(){
+    m_stopped = true;
+}
@@ -31,6 +31,9 @@
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 
+#include <cereal/archives/portable_binary.hpp>
+#include <cereal/types/string.hpp>
+
 // local includes
 #include "publication_record.hpp"
 #include "logger.hpp"
@@ -91,13 +94,13 @@ PublicationRecord::~PublicationRecord(){}
 
 // ----------------------------------------------------------------------------
 // Name:
-//      PublicationRecord::is_valid
+//      PublicationRecord::is_well_formed
 // Description:
-//      Checks PublicationRecord-specific values and that the Record is
-//      signed and mined correctly.
+//      Checks PublicationRecord-specific values, before the Record is
+//      checked for work and a signature
 // ----------------------------------------------------------------------------
-bool PublicationRecord::is_valid(){
-  bool valid = BaseRecord::is_valid();
+bool PublicationRecord::is_well_formed(){
+  bool valid = BaseRecord::is_well_formed();
 
   // check if the publication has a reference
   if(m_reference.empty()){
@@ -122,6 +125,48 @@ std::string PublicationRecord::get_data(){
     return data;
 }
 
+// ----------------------------------------------------------------------------
+// Name:
+//      PublicationRecord::encode_fields
+// Description:
+//      Append the reference, which is normally a document hash
+// ----------------------------------------------------------------------------
+void PublicationRecord::encode_fields( std::string& t_out ){
+    encode_digest(t_out,m_reference);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      PublicationRecord::release_fields
+// Description:
+//      Free the reference of a released view
+// ----------------------------------------------------------------------------
+void PublicationRecord::release_fields(){
+    std::string().swap(m_reference);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      PublicationRecord::save_binary
+// Description:
+//      Write the BaseRecord fields and then the reference
+// ----------------------------------------------------------------------------
+void PublicationRecord::save_binary( cereal::PortableBinaryOutputArchive& t_archive ){
+    BaseRecord::save_binary(t_archive);
+    save_hex(t_archive,m_reference);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      PublicationRecord::load_binary
+// Description:
+//      Read the fields written by save_binary
+// ----------------------------------------------------------------------------
+void PublicationRecord::load_binary( cereal::PortableBinaryInputArchive& t_archive ){
+    BaseRecord::load_binary(t_archive);
+    load_hex(t_archive,m_reference);
+}
+
 // ----------------------------------------------------------------------------
 // Name:
 //      PublicationRecord::to_string
@@ -142,4 +187,14 @@ std::string PublicationRecord::to_string(){
 
 }
 
+// ----------------------------------------------------------------------------
+// Name:
+//      PublicationRecord::clone
+// Description:
+//      Copies the PublicationRecord into a new shared_ptr
+// ----------------------------------------------------------------------------
+std::shared_ptr<BaseRecord> PublicationRecord::clone(){
+    return std::make_shared<PublicationRecord>(*this);
+}
+
 BOOST_CLASS_EXPORT_IMPLEMENT(PublicationRecord)
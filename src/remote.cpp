@@ -30,6 +30,7 @@
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include <boost/serialization/shared_ptr.hpp>
 #include <boost/archive/text_iarchive.hpp>
@@ -42,6 +43,7 @@
 #include "config.hpp"
 #include "logger.hpp"
 #include "utility.hpp"
+#include "validator.hpp"
 
 namespace fs = boost::filesystem;
 namespace rc = rechain;
@@ -50,6 +52,32 @@ using namespace boost::asio::ip;
 
 typedef Logger rl;
 
+// read the Hash-Format header of a peer's message, which peers from
+// before the binary encoding don't send. anything but a known format
+// is turned away.
+static bool read_format( std::string t_value, HashFormat& t_format ){
+
+    if(t_value.empty()){
+        t_format = HashFormat::Text;
+        return true;
+    }
+
+    int value = 0;
+
+    try {
+        value = boost::lexical_cast<int>(t_value);
+    } catch(const boost::bad_lexical_cast&){
+        return false;
+    }
+
+    if(value != static_cast<int>(HashFormat::Text) && value != static_cast<int>(HashFormat::Binary)){
+        return false;
+    }
+
+    t_format = static_cast<HashFormat>(value);
+    return true;
+}
+
 Remote::Remote(std::shared_ptr<Config> cfg) 
     : config(cfg), service(), service_thread() {
 
@@ -74,8 +102,27 @@ void Remote::handle( boost::shared_ptr<tcp::socket> socket ){
         archive >> record;
     }
 
-    if(m_callback)
-        m_callback(record);
+    HashFormat format = HashFormat::Text;
+
+    if(!read_format(request.get_property("Hash-Format"),format)){
+        RCWARNING("record from peer has an unknown hash format");
+    }
+    else {
+        record->set_format(format);
+
+        // garbage from a peer is turned away by the cheapest check it
+        // fails, before a key is parsed or a signature checked. there's
+        // no chain here, so the link is left to whoever adds it to one,
+        // and the work is held to the minimum for peers
+        Validator::Stage stage = Validator::check_remote(record.get());
+
+        if(stage != Validator::Passed){
+            RCWARNING("record from peer failed the " + Validator::get_name(stage) + " check");
+        }
+        else if(m_callback){
+            m_callback(record);
+        }
+    }
 
     // send a '200' response to the client
     Response response;
@@ -161,6 +208,7 @@ void Remote::send( std::shared_ptr<BaseRecord> record ){
             res.set_property("Accept","*/*");
             res.set_property("Content-Length",std::to_string(message.length()));
             res.set_property("Message-Type","Publish");
+            res.set_property("Hash-Format",std::to_string(static_cast<int>(record->get_format())));
             res.set_property("Connection","close");
             res.set_body(message);
 
@@ -0,0 +1,1044 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+
+// system includes
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <map>
+#include <cstdio>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+
+// dependency includes
+#include <boost/filesystem.hpp>
+#include <boost/crc.hpp>
+
+#include <cereal/archives/portable_binary.hpp>
+
+// local includes
+#include "segment_store.hpp"
+#include "logger.hpp"
+#include "enums.hpp"
+#include "utility.hpp"
+
+namespace fs = boost::filesystem;
+
+/** The first bytes of every segment file */
+#define SEGMENT_MAGIC "RCSG"
+
+/** The length of SEGMENT_MAGIC */
+#define SEGMENT_MAGIC_SIZE 4
+
+/** The layout version of segments written by this build */
+#define SEGMENT_VERSION 1
+
+/** The length of the magic and version at the start of a segment */
+#define SEGMENT_HEADER_SIZE 8
+
+/** The first bytes of a compressed segment */
+#define COMPRESSED_MAGIC "RCSZ"
+
+/** The layout version of compressed segments written by this build */
+#define COMPRESSED_VERSION 1
+
+/** The length of the magic, version, uncompressed length and
+    dictionary id at the start of a compressed segment */
+#define COMPRESSED_HEADER_SIZE 16
+
+/** The length of the length and crc32 before each record */
+#define FRAME_SIZE 8
+
+/** The name of the manifest in the store directory */
+#define MANIFEST_NAME "manifest"
+
+/** The first line of the manifest */
+#define MANIFEST_HEADER "rechain-segments 1"
+
+/** The name of the dictionary shared by compressed segments */
+#define DICTIONARY_NAME "dictionary"
+
+/** The name of the file a writer holds locked while the store is open */
+#define LOCK_NAME "lock"
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      put_u32
+// Description:
+//      Append a little-endian 32-bit integer to a buffer
+// ----------------------------------------------------------------------------
+static void put_u32( std::string& t_buffer, uint32_t t_value ){
+    for(int i = 0; i < 4; ++i){
+        t_buffer.push_back((char)((t_value >> (8 * i)) & 0xFF));
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      get_u32
+// Description:
+//      Read a little-endian 32-bit integer from a buffer
+// ----------------------------------------------------------------------------
+static uint32_t get_u32( const char* t_buffer ){
+    uint32_t value = 0;
+    for(int i = 0; i < 4; ++i){
+        value |= (uint32_t)(unsigned char)t_buffer[i] << (8 * i);
+    }
+    return value;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      write_all
+// Description:
+//      Write a whole buffer to a file descriptor
+// ----------------------------------------------------------------------------
+static bool write_all( int t_fd, const std::string& t_buffer ){
+
+    size_t written = 0;
+    while(written < t_buffer.size()){
+        ssize_t result = ::write(t_fd,t_buffer.data() + written,t_buffer.size() - written);
+        if(result < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        written += result;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      map_file
+// Description:
+//      Map a whole file read-only. The mapping is removed when the
+//      last pointer into it is gone.
+// ----------------------------------------------------------------------------
+static std::shared_ptr<const char> map_file( const std::string& t_path, size_t& t_size ){
+
+    int fd = ::open(t_path.c_str(),O_RDONLY);
+    if(fd < 0){
+        return nullptr;
+    }
+
+    struct stat info;
+    if(::fstat(fd,&info) != 0 || info.st_size == 0){
+        ::close(fd);
+        return nullptr;
+    }
+
+    size_t size = info.st_size;
+    void* address = ::mmap(nullptr,size,PROT_READ,MAP_SHARED,fd,0);
+    ::close(fd);
+
+    if(address == MAP_FAILED){
+        return nullptr;
+    }
+
+    t_size = size;
+    return std::shared_ptr<const char>((const char*)address,[size]( const char* t_address ){
+        ::munmap((void*)t_address,size);
+    });
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      read_file
+// Description:
+//      Read a whole file into memory
+// ----------------------------------------------------------------------------
+static std::shared_ptr<const char> read_file( const std::string& t_path, size_t& t_size ){
+
+    std::ifstream is(t_path,std::ios::binary | std::ios::ate);
+    if(!is.is_open()){
+        return nullptr;
+    }
+
+    std::streamoff end = is.tellg();
+    if(end < 0){
+        return nullptr;
+    }
+
+    size_t size = end;
+    std::shared_ptr<char> data(new char[size + 1],std::default_delete<char[]>());
+
+    is.seekg(0);
+    if(!is.read(data.get(),size)){
+        return nullptr;
+    }
+
+    t_size = size;
+    return data;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      encode
+// Description:
+//      Write the record type and a record to a binary payload
+// ----------------------------------------------------------------------------
+static std::string encode( std::shared_ptr<BaseRecord> t_record ){
+
+    std::ostringstream os;
+    {
+        cereal::PortableBinaryOutputArchive archive(os);
+        archive((uint8_t)t_record->get_type());
+        t_record->save_binary(archive);
+    }
+
+    return os.str();
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      segment_name
+// Description:
+//      Get the file name of the segment at an index
+// ----------------------------------------------------------------------------
+static std::string segment_name( size_t t_index ){
+    char name[32];
+    std::snprintf(name,sizeof(name),"segment-%06u.dat",(unsigned int)t_index);
+    return name;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Constructor
+// Description:
+//      Construct a SegmentStore for a directory
+// ----------------------------------------------------------------------------
+SegmentStore::SegmentStore( std::string t_directory, size_t t_segment_size, size_t t_batch ) : 
+    m_directory(t_directory), 
+    m_segment_size(t_segment_size), 
+    m_batch(t_batch),
+    m_segments(),
+    m_fd(-1),
+    m_lock(-1),
+    m_length(0),
+    m_synced(0),
+    m_stale(false),
+    m_mapped(true),
+    m_compressed(false),
+    m_compressor() {
+
+    if(t_segment_size == 0){
+        throw std::invalid_argument("segments must hold at least one record");
+    }
+
+    if(t_batch == 0){
+        throw std::invalid_argument("records must be synced in batches of at least one");
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      Destructor
+// Description:
+//      Sync and close the open segment
+// ----------------------------------------------------------------------------
+SegmentStore::~SegmentStore(){
+
+    // a clean close records the tip in the manifest
+    if(m_fd >= 0){
+        if(sync() && m_stale){
+            write_manifest();
+        }
+        ::close(m_fd);
+    }
+
+    if(m_lock >= 0){
+        ::close(m_lock);
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::exists
+// Description:
+//      Check that a directory has a manifest
+// ----------------------------------------------------------------------------
+bool SegmentStore::exists( std::string t_directory ){
+    return fs::exists(fs::path(t_directory) / MANIFEST_NAME);
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::path
+// Description:
+//      Get the path of a file in the store directory
+// ----------------------------------------------------------------------------
+std::string SegmentStore::path( std::string t_name ){
+    return (fs::path(m_directory) / t_name).string();
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::read_manifest
+// Description:
+//      Read the segment list from the manifest
+// ----------------------------------------------------------------------------
+bool SegmentStore::read_manifest(){
+
+    std::ifstream is(path(MANIFEST_NAME));
+
+    if(!is.is_open()){
+        return false;
+    }
+
+    std::string line;
+    if(!std::getline(is,line) || line != MANIFEST_HEADER){
+        RCERROR("segment manifest has an unknown header");
+        return false;
+    }
+
+    std::vector<Segment> segments;
+
+    while(std::getline(is,line)){
+
+        if(line.empty()){
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::string state;
+        Segment segment;
+
+        if(!(fields >> state >> segment.name >> segment.first >> segment.records >> segment.tip) ||
+           (state != "sealed" && state != "open")){
+            RCERROR("segment manifest is damaged: " + line);
+            return false;
+        }
+
+        segment.sealed = (state == "sealed");
+        if(segment.tip == "-"){
+            segment.tip.clear();
+        }
+
+        segments.push_back(segment);
+    }
+
+    if(segments.empty()){
+        RCERROR("segment manifest has no segments");
+        return false;
+    }
+
+    m_segments = segments;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::write_manifest
+// Description:
+//      Write the manifest to a temporary file and rename it over
+//      the old one, so that there is always a whole manifest
+// ----------------------------------------------------------------------------
+bool SegmentStore::write_manifest(){
+
+    std::ostringstream os;
+    os << MANIFEST_HEADER << "\n";
+
+    for(auto& segment : m_segments){
+        os << (segment.sealed ? "sealed" : "open") << " "
+           << segment.name    << " "
+           << segment.first   << " "
+           << segment.records << " "
+           << (segment.tip.empty() ? "-" : segment.tip) << "\n";
+    }
+
+    std::string temporary = path(std::string(MANIFEST_NAME) + ".tmp");
+
+    int fd = ::open(temporary.c_str(),O_WRONLY | O_CREAT | O_TRUNC,0644);
+    if(fd < 0){
+        RCERROR("failed to write segment manifest: " + temporary);
+        return false;
+    }
+
+    bool written = write_all(fd,os.str());
+    ::close(fd);
+
+    if(!written || !rechain::replace_file(temporary,path(MANIFEST_NAME))){
+        RCERROR("failed to write segment manifest: " + temporary);
+        return false;
+    }
+
+    m_stale = false;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::read_segment
+// Description:
+//      Read records from a segment until the end of the file or
+//      the first record that is cut short or fails its crc32. Records
+//      in a mapped segment check their crc32 when they're decoded.
+// ----------------------------------------------------------------------------
+bool SegmentStore::read_segment( const Segment& t_segment, std::vector< std::shared_ptr<BaseRecord> >& t_records, size_t& t_length, bool t_map ){
+
+    t_length = 0;
+
+    size_t size = 0;
+    std::shared_ptr<const char> data = t_map ? map_file(path(t_segment.name),size) 
+                                             : read_file(path(t_segment.name),size);
+
+    // a compressed segment is never mapped. it's inflated whole into
+    // memory, and mapped records are views into the inflated copy
+    if(data && size >= COMPRESSED_HEADER_SIZE && 
+       std::string(data.get(),SEGMENT_MAGIC_SIZE) == COMPRESSED_MAGIC){
+
+        if(get_u32(data.get() + SEGMENT_MAGIC_SIZE) > COMPRESSED_VERSION ||
+           get_u32(data.get() + 12) != m_compressor.get_id()){
+            return false;
+        }
+
+        // the length is checked before it's allocated, since a damaged
+        // header could claim gigabytes
+        size_t length = get_u32(data.get() + 8);
+        if(length > (size - COMPRESSED_HEADER_SIZE) * Compressor::max_ratio){
+            return false;
+        }
+
+        std::shared_ptr<char> inflated(new char[length + 1],std::default_delete<char[]>());
+
+        if(!m_compressor.decompress(data.get() + COMPRESSED_HEADER_SIZE,size - COMPRESSED_HEADER_SIZE,inflated.get(),length)){
+            return false;
+        }
+
+        data = inflated;
+        size = length;
+    }
+
+    if(!data ||
+       size < SEGMENT_HEADER_SIZE || 
+       std::string(data.get(),SEGMENT_MAGIC_SIZE) != SEGMENT_MAGIC){
+        return false;
+    }
+
+    if(get_u32(data.get() + SEGMENT_MAGIC_SIZE) > SEGMENT_VERSION){
+        return false;
+    }
+
+    size_t offset = SEGMENT_HEADER_SIZE;
+
+    while(size - offset >= FRAME_SIZE){
+
+        uint32_t length = get_u32(data.get() + offset);
+        uint32_t crc    = get_u32(data.get() + offset + 4);
+
+        // a frame can't be longer than the bytes left, which is checked
+        // before the payload is copied or mapped
+        if(size - offset - FRAME_SIZE < length){
+            break;
+        }
+
+        const char* payload = data.get() + offset + FRAME_SIZE;
+        std::shared_ptr<BaseRecord> record;
+
+        if(t_map){
+
+            // the payload starts with the archive's endianness byte
+            // and then the record type
+            if(length < 2){
+                break;
+            }
+
+            record = BaseRecord::create((RecordType)payload[1]);
+            if(!record){
+                break;
+            }
+
+            record->set_source(std::shared_ptr<const char>(data,payload),length,crc);
+
+        }
+        else {
+
+            boost::crc_32_type checksum;
+            checksum.process_bytes(payload,length);
+
+            if(checksum.checksum() != crc){
+                break;
+            }
+
+            try {
+                std::istringstream is(std::string(payload,length));
+                cereal::PortableBinaryInputArchive archive(is);
+
+                uint8_t type;
+                archive(type);
+
+                record = BaseRecord::create((RecordType)type);
+                if(!record){
+                    break;
+                }
+
+                record->load_binary(archive);
+            } catch (const cereal::Exception& e){
+                break;
+            }
+
+        }
+
+        t_records.push_back(record);
+        offset += FRAME_SIZE + length;
+    }
+
+    t_length = offset;
+    return offset == size;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::open_segment
+// Description:
+//      Open the last segment for appending, writing the header if
+//      the segment is new
+// ----------------------------------------------------------------------------
+bool SegmentStore::open_segment(){
+
+    std::string name = path(m_segments.back().name);
+
+    m_fd = ::open(name.c_str(),O_WRONLY | O_CREAT | O_APPEND,0644);
+    if(m_fd < 0){
+        RCERROR("failed to open segment: " + name);
+        return false;
+    }
+
+    struct stat info;
+    if(::fstat(m_fd,&info) != 0){
+        RCERROR("failed to open segment: " + name);
+        return false;
+    }
+
+    m_length = info.st_size;
+
+    if(m_length == 0){
+
+        std::string header(SEGMENT_MAGIC,SEGMENT_MAGIC_SIZE);
+        put_u32(header,SEGMENT_VERSION);
+
+        if(!write_all(m_fd,header) || ::fsync(m_fd) != 0){
+            RCERROR("failed to write segment header: " + name);
+            return false;
+        }
+
+        m_length = header.size();
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::seal
+// Description:
+//      Close the open segment for good and start the next one
+// ----------------------------------------------------------------------------
+bool SegmentStore::seal(){
+
+    if(!sync()){
+        return false;
+    }
+
+    ::close(m_fd);
+    m_fd = -1;
+
+    Segment& last = m_segments.back();
+    last.sealed = true;
+
+    RCDEBUG("sealed segment: " + last.name);
+
+    // last isn't valid after the push
+    Segment next = { segment_name(m_segments.size()), last.first + last.records, 0, last.tip, false };
+    m_segments.push_back(next);
+
+    // sealed segments are compressed when the store is next opened,
+    // so appends never wait on training or deflating a segment
+    return write_manifest() && open_segment();
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::read_dictionary
+// Description:
+//      Read the dictionary shared by compressed segments, if there is one
+// ----------------------------------------------------------------------------
+bool SegmentStore::read_dictionary(){
+
+    size_t size = 0;
+    std::shared_ptr<const char> data = read_file(path(DICTIONARY_NAME),size);
+
+    if(!data){
+        m_compressor = Compressor();
+        return !fs::exists(path(DICTIONARY_NAME));
+    }
+
+    m_compressor = Compressor(std::string(data.get(),size));
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::train
+// Description:
+//      Build the dictionary from the first segment that's compressed.
+//      Most of a record that compresses at all is its public key, so
+//      the dictionary is one whole record from each author, the most
+//      frequent authors last where they're cheapest to refer to.
+// ----------------------------------------------------------------------------
+bool SegmentStore::train( const Segment& t_segment ){
+
+    std::vector< std::shared_ptr<BaseRecord> > records;
+    size_t length = 0;
+
+    if(!read_segment(t_segment,records,length,false)){
+        return false;
+    }
+
+    std::map<std::string,size_t> counts;
+    std::map<std::string,std::shared_ptr<BaseRecord>> examples;
+
+    for(auto& record : records){
+        std::string key = record->get_public_key();
+        if(counts[key]++ == 0){
+            examples[key] = record;
+        }
+    }
+
+    std::vector< std::pair<size_t,std::string> > ranked;
+    for(auto& count : counts){
+        ranked.push_back({count.second,count.first});
+    }
+
+    std::sort(ranked.rbegin(),ranked.rend());
+
+    std::vector<std::string> samples;
+    for(auto& rank : ranked){
+        samples.push_back(encode(examples[rank.second]));
+    }
+
+    std::string dictionary = Compressor::train(samples);
+    std::string temporary  = path(DICTIONARY_NAME) + ".tmp";
+
+    std::ofstream os(temporary,std::ios::binary | std::ios::trunc);
+    os.write(dictionary.data(),dictionary.size());
+    os.close();
+
+    if(!os || !rechain::replace_file(temporary,path(DICTIONARY_NAME))){
+        RCERROR("failed to write the segment dictionary");
+        return false;
+    }
+
+    m_compressor = Compressor(dictionary);
+
+    RCDEBUG("trained a dictionary of " + std::to_string(dictionary.size()) + " bytes from " + t_segment.name);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::compress
+// Description:
+//      Write a compressed copy of a sealed segment, point the
+//      manifest at it and then remove the original. A crash before
+//      the manifest is written leaves the original in use.
+// ----------------------------------------------------------------------------
+bool SegmentStore::compress( Segment& t_segment ){
+
+    if(m_compressor.get_dictionary().empty() && !train(t_segment)){
+        return false;
+    }
+
+    size_t size = 0;
+    std::shared_ptr<const char> data = read_file(path(t_segment.name),size);
+
+    std::string compressed;
+    if(!data || size > UINT32_MAX || !m_compressor.compress(data.get(),size,compressed)){
+        return false;
+    }
+
+    std::string header(COMPRESSED_MAGIC,SEGMENT_MAGIC_SIZE);
+    put_u32(header,COMPRESSED_VERSION);
+    put_u32(header,size);
+    put_u32(header,m_compressor.get_id());
+
+    std::string original = t_segment.name;
+    std::string name = fs::path(original).replace_extension(".z").string();
+    std::string temporary = path(name) + ".tmp";
+
+    std::ofstream os(temporary,std::ios::binary | std::ios::trunc);
+    os.write(header.data(),header.size());
+    os.write(compressed.data(),compressed.size());
+    os.close();
+
+    if(!os || !rechain::replace_file(temporary,path(name))){
+        return false;
+    }
+
+    t_segment.name = name;
+
+    if(!write_manifest()){
+        boost::system::error_code error;
+        t_segment.name = original;
+        fs::remove(path(name),error);
+        return false;
+    }
+
+    boost::system::error_code error;
+    fs::remove(path(original),error);
+
+    RCDEBUG("compressed " + original + " from " + std::to_string(size) + " to " + std::to_string(header.size() + compressed.size()) + " bytes");
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::lock
+// Description:
+//      Take the store's lock file for this store, so a second writer
+//      (in this process or another) can't open the store at the
+//      same time. The lock goes when the descriptor is closed, even
+//      if the process is killed.
+// ----------------------------------------------------------------------------
+bool SegmentStore::lock(){
+
+    if(m_lock >= 0){
+        return true;
+    }
+
+    std::string name = path(LOCK_NAME);
+
+    m_lock = ::open(name.c_str(),O_RDWR | O_CREAT | O_CLOEXEC,0644);
+    if(m_lock < 0){
+        RCERROR("failed to open the segment lock: " + name);
+        return false;
+    }
+
+    if(::flock(m_lock,LOCK_EX | LOCK_NB) != 0){
+
+        if(errno == EWOULDBLOCK){
+            RCERROR("segments are already open for writing: " + m_directory);
+        }
+        else {
+            RCERROR("failed to lock the segments: " + m_directory);
+        }
+
+        ::close(m_lock);
+        m_lock = -1;
+        return false;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::open
+// Description:
+//      Read every segment, checking the sealed ones and cutting a
+//      torn record off the end of the open one, then compress the
+//      sealed segments that aren't yet
+// ----------------------------------------------------------------------------
+bool SegmentStore::open( std::vector< std::shared_ptr<BaseRecord> >& t_records ){
+
+    RCDEBUG("opening segments in: " + m_directory);
+
+    t_records.clear();
+
+    if(m_fd >= 0){
+        ::close(m_fd);
+        m_fd = -1;
+    }
+
+    try {
+        fs::create_directories(m_directory);
+    }
+    catch (fs::filesystem_error& e){
+        RCERROR(e.what());
+        return false;
+    }
+
+    if(!lock()){
+        return false;
+    }
+
+    if(!read_dictionary()){
+        RCERROR("failed to read the segment dictionary: " + m_directory);
+        return false;
+    }
+
+    if(!read_manifest()){
+
+        if(exists(m_directory) || fs::exists(path(segment_name(0)))){
+            RCERROR("segments can't be opened without their manifest: " + m_directory);
+            return false;
+        }
+
+        // a new store
+        Segment first = { segment_name(0), 0, 0, "", false };
+        m_segments = { first };
+
+        if(!write_manifest()){
+            return false;
+        }
+    }
+
+    uint64_t height = 0;
+    std::string tip;
+
+    for(size_t i = 0; i < m_segments.size(); ++i){
+
+        Segment& segment = m_segments[i];
+        bool last = (i + 1 == m_segments.size());
+
+        if(segment.sealed == last){
+            RCERROR("only the last segment can be open: " + segment.name);
+            return false;
+        }
+
+        size_t count  = t_records.size();
+        size_t length = 0;
+        bool complete = read_segment(segment,t_records,length,segment.sealed && m_mapped);
+        size_t read   = t_records.size() - count;
+
+        if(segment.sealed){
+
+            std::string hash = read > 0 ? t_records.back()->hash() : tip;
+
+            // sealed segments never change, so any difference is damage
+            if(!complete || segment.first != height || segment.records != read || segment.tip != hash){
+                RCERROR("sealed segment is damaged: " + segment.name);
+                return false;
+            }
+
+        }
+        else {
+
+            if(!complete && fs::exists(path(segment.name))){
+                RCWARNING("truncating a torn record at the end of: " + segment.name);
+
+                if(::truncate(path(segment.name).c_str(),length) != 0){
+                    RCERROR("failed to truncate segment: " + segment.name);
+                    return false;
+                }
+            }
+
+            if(read < segment.records){
+                RCWARNING("open segment has fewer records than the manifest: " + segment.name);
+            }
+
+            segment.first   = height;
+            segment.records = read;
+            segment.tip     = read > 0 ? t_records.back()->hash() : tip;
+        }
+
+        height += read;
+        tip = segment.tip;
+    }
+
+    m_synced = height;
+
+    // segments sealed since the last open are compressed now, off the
+    // append path. they're whole on disk already, so failing to
+    // compress one only costs space
+    if(m_compressed){
+        for(auto& segment : m_segments){
+            if(segment.sealed && fs::path(segment.name).extension() != ".z" && !compress(segment)){
+                RCWARNING("sealed segment was left uncompressed: " + segment.name);
+            }
+        }
+    }
+
+    if(!open_segment()){
+        return false;
+    }
+
+    RCDEBUG("read " + std::to_string(t_records.size()) + " records from " + std::to_string(m_segments.size()) + " segments");
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::append
+// Description:
+//      Frame a record and append it to the open segment, syncing
+//      every batch and sealing full segments
+// ----------------------------------------------------------------------------
+bool SegmentStore::append( std::shared_ptr<BaseRecord> t_record ){
+
+    if(m_fd < 0){
+        RCERROR("segment store isn't open");
+        return false;
+    }
+
+    std::string payload = encode(t_record);
+
+    boost::crc_32_type checksum;
+    checksum.process_bytes(payload.data(),payload.size());
+
+    std::string entry;
+    entry.reserve(FRAME_SIZE + payload.size());
+    put_u32(entry,payload.size());
+    put_u32(entry,checksum.checksum());
+    entry += payload;
+
+    if(!write_all(m_fd,entry)){
+        RCERROR("failed to append to segment: " + m_segments.back().name);
+
+        // don't leave part of a record before the next one
+        if(::ftruncate(m_fd,m_length) != 0){
+            RCERROR("failed to truncate segment: " + m_segments.back().name);
+        }
+        return false;
+    }
+
+    m_length += entry.size();
+    m_stale = true;
+
+    Segment& segment = m_segments.back();
+    segment.records++;
+    segment.tip = t_record->hash();
+
+    if(size() - m_synced >= m_batch && !sync()){
+        return false;
+    }
+
+    if(segment.records >= m_segment_size){
+        return seal();
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::sync
+// Description:
+//      Flush the open segment. Opening reads the open segment to its
+//      end, so its records don't need a new manifest to be found.
+// ----------------------------------------------------------------------------
+bool SegmentStore::sync(){
+
+    int fd = -1;
+    uint64_t height = begin_sync(fd);
+
+    if(!flush(fd)){
+        RCERROR("failed to sync segment: " + m_segments.back().name);
+        return false;
+    }
+
+    end_sync(height);
+    return m_synced >= size();
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::begin_sync
+// Description:
+//      Duplicate the descriptor of the open segment, so it can be
+//      flushed even if the segment is sealed and closed meanwhile
+// ----------------------------------------------------------------------------
+uint64_t SegmentStore::begin_sync( int& t_fd ){
+
+    t_fd = -1;
+
+    if(m_fd < 0 || m_synced >= size()){
+        return m_synced;
+    }
+
+    t_fd = ::dup(m_fd);
+    if(t_fd < 0){
+        RCERROR("failed to sync segment: " + m_segments.back().name);
+        return m_synced;
+    }
+
+    return size();
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::flush
+// Description:
+//      Flush a descriptor from begin_sync and close it
+// ----------------------------------------------------------------------------
+bool SegmentStore::flush( int t_fd ){
+
+    if(t_fd < 0){
+        return true;
+    }
+
+    bool flushed = ::fdatasync(t_fd) == 0;
+    ::close(t_fd);
+
+    return flushed;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::end_sync
+// Description:
+//      Record the records covered by a finished sync
+// ----------------------------------------------------------------------------
+void SegmentStore::end_sync( uint64_t t_height ){
+    m_synced = std::max(m_synced,t_height);
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::size
+// Description:
+//      Get the number of records in the store
+// ----------------------------------------------------------------------------
+uint64_t SegmentStore::size(){
+
+    if(m_segments.empty()){
+        return 0;
+    }
+
+    return m_segments.back().first + m_segments.back().records;
+}
+
+// ----------------------------------------------------------------------------
+// Name: 
+//      SegmentStore::tip
+// Description:
+//      Get the hash of the last record in the store
+// ----------------------------------------------------------------------------
+std::string SegmentStore::tip(){
+
+    if(m_segments.empty()){
+        return "";
+    }
+
+    return m_segments.back().tip;
+}
@@ -0,0 +1,361 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+
+// system includes
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// dependency includes
+#include <cryptopp/sha.h>       // for SHA256
+#include <cryptopp/hmac.h>      // for HMAC
+#include <cryptopp/osrng.h>     // for AutoSeededRandomPool
+
+#include <cereal/archives/portable_binary.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+
+// local includes
+#include "signature_cache.hpp"
+#include "logger.hpp"
+#include "utility.hpp"
+
+/** The first bytes of a cache file */
+#define CACHE_MAGIC "RCVS"
+
+/** The length of CACHE_MAGIC */
+#define CACHE_MAGIC_SIZE 4
+
+/** The layout version of cache files written by this build */
+#define CACHE_VERSION 1
+
+/** The length of the HMAC at the end of a cache file */
+#define MAC_SIZE 32
+
+/** The length of a new secret */
+#define SECRET_SIZE 32
+
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureCache members
+// Description:
+//      The cache is shared by every record and thread
+// ----------------------------------------------------------------------------
+std::mutex SignatureCache::m_mutex;
+std::unordered_set<std::string> SignatureCache::m_entries;
+std::string SignatureCache::m_path;
+std::string SignatureCache::m_secret;
+std::atomic<bool> SignatureCache::m_open(false);
+std::atomic<bool> SignatureCache::m_forced(false);
+bool SignatureCache::m_stale = false;
+std::atomic<uint64_t> SignatureCache::m_hits(0);
+std::atomic<uint64_t> SignatureCache::m_misses(0);
+
+// ----------------------------------------------------------------------------
+// Name:
+//      digest
+// Description:
+//      Get the raw SHA256 digest of a string
+// ----------------------------------------------------------------------------
+static std::string digest( const std::string& t_data ){
+
+    std::string result(CryptoPP::SHA256::DIGESTSIZE,'\0');
+
+    CryptoPP::SHA256 hasher;
+    hasher.CalculateDigest((CryptoPP::byte*)&result[0],(const CryptoPP::byte*)t_data.data(),t_data.size());
+
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureCache::entry
+// Description:
+//      The signed data includes the public key, so the two digests
+//      pin the key, the data and the signature
+// ----------------------------------------------------------------------------
+std::string SignatureCache::entry( BaseRecord* t_record ){
+    return digest(t_record->get_data()) + digest(t_record->get_signature());
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureCache::contains
+// Description:
+//      Check for a signature that was verified before
+// ----------------------------------------------------------------------------
+bool SignatureCache::contains( const std::string& t_entry ){
+
+    if(!m_open){
+        return false;
+    }
+
+    bool found = false;
+
+    if(!m_forced){
+        std::lock_guard<std::mutex> guard(m_mutex);
+        found = m_entries.count(t_entry) > 0;
+    }
+
+    if(found){
+        m_hits++;
+    }
+    else {
+        m_misses++;
+    }
+
+    return found;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureCache::add
+// Description:
+//      Remember a verified signature
+// ----------------------------------------------------------------------------
+void SignatureCache::add( const std::string& t_entry ){
+
+    if(!m_open){
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if(m_entries.insert(t_entry).second){
+        m_stale = true;
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureCache::mac
+// Description:
+//      HMAC-SHA256 of the file contents under the local secret
+// ----------------------------------------------------------------------------
+std::string SignatureCache::mac( const std::string& t_data ){
+
+    std::string result(MAC_SIZE,'\0');
+
+    CryptoPP::HMAC<CryptoPP::SHA256> hmac((const CryptoPP::byte*)m_secret.data(),m_secret.size());
+    hmac.CalculateDigest((CryptoPP::byte*)&result[0],(const CryptoPP::byte*)t_data.data(),t_data.size());
+
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureCache::open
+// Description:
+//      Read the entries in a cache file. A file that's damaged, from
+//      another machine or written with another secret is ignored,
+//      and every signature is verified as if there were no cache.
+// ----------------------------------------------------------------------------
+bool SignatureCache::open( std::string t_path, std::string t_secret ){
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    m_entries.clear();
+    m_path   = t_path;
+    m_secret = t_secret;
+    m_stale  = false;
+    m_open   = true;
+
+    if(m_secret.empty()){
+        RCWARNING("signature cache has no secret, so it won't be read or saved");
+        return false;
+    }
+
+    std::ifstream is(m_path,std::ios::binary);
+    if(!is.is_open()){
+        return true;
+    }
+
+    std::string data((std::istreambuf_iterator<char>(is)),std::istreambuf_iterator<char>());
+
+    if(data.size() < CACHE_MAGIC_SIZE + MAC_SIZE || data.compare(0,CACHE_MAGIC_SIZE,CACHE_MAGIC) != 0){
+        RCWARNING("signature cache isn't a signature cache: " + m_path);
+        return false;
+    }
+
+    std::string body = data.substr(0,data.size() - MAC_SIZE);
+    std::string expected = mac(body);
+
+    // compare the whole HMAC so the time taken doesn't give it away
+    unsigned char difference = 0;
+    for(size_t i = 0; i < MAC_SIZE; ++i){
+        difference |= (unsigned char)(expected[i] ^ data[body.size() + i]);
+    }
+
+    if(difference != 0){
+        RCWARNING("signature cache doesn't match its HMAC, verifying every signature: " + m_path);
+        return false;
+    }
+
+    uint32_t version;
+    std::vector<std::string> entries;
+
+    try {
+        std::istringstream archived(body.substr(CACHE_MAGIC_SIZE));
+        cereal::PortableBinaryInputArchive archive(archived);
+        archive(version);
+
+        if(version > CACHE_VERSION){
+            RCWARNING("signature cache version " + std::to_string(version) + " is newer than this build");
+            return false;
+        }
+
+        archive(entries);
+    } catch (const cereal::Exception& e){
+        RCWARNING("signature cache couldn't be read: " + std::string(e.what()));
+        return false;
+    }
+
+    m_entries.insert(entries.begin(),entries.end());
+
+    RCDEBUG("read " + std::to_string(m_entries.size()) + " verified signatures");
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureCache::save
+// Description:
+//      Write the entries and their HMAC next to the old file and
+//      rename it over, so a crash leaves one or the other
+// ----------------------------------------------------------------------------
+bool SignatureCache::save(){
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    if(!m_open || m_path.empty() || m_secret.empty()){
+        return false;
+    }
+
+    if(!m_stale){
+        return true;
+    }
+
+    std::ostringstream os;
+    os.write(CACHE_MAGIC,CACHE_MAGIC_SIZE);
+
+    {
+        cereal::PortableBinaryOutputArchive archive(os);
+        archive((uint32_t)CACHE_VERSION,std::vector<std::string>(m_entries.begin(),m_entries.end()));
+    }
+
+    std::string data = os.str();
+    data += mac(data);
+
+    std::string temporary = m_path + ".tmp";
+    std::ofstream file(temporary,std::ios::binary | std::ios::trunc);
+    file.write(data.data(),data.size());
+    file.close();
+
+    if(!file || !rechain::replace_file(temporary,m_path)){
+        std::remove(temporary.c_str());
+
+        RCWARNING("signature cache failed to save: " + m_path);
+        return false;
+    }
+
+    m_stale = false;
+
+    RCDEBUG("saved " + std::to_string(m_entries.size()) + " verified signatures");
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureCache::close
+// Description:
+//      Save and forget every entry, so signatures are verified again
+// ----------------------------------------------------------------------------
+void SignatureCache::close(){
+
+    save();
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    m_open = false;
+    m_entries.clear();
+    m_path.clear();
+    m_secret.clear();
+    m_stale = false;
+
+    m_hits   = 0;
+    m_misses = 0;
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureCache::load_secret
+// Description:
+//      Read the secret from a file only the user can read, writing
+//      a random one first if there isn't one
+// ----------------------------------------------------------------------------
+std::string SignatureCache::load_secret( std::string t_path ){
+
+    int fd = ::open(t_path.c_str(),O_WRONLY | O_CREAT | O_EXCL,0600);
+
+    if(fd >= 0){
+        std::string secret(SECRET_SIZE,'\0');
+
+        CryptoPP::AutoSeededRandomPool rng;
+        rng.GenerateBlock((CryptoPP::byte*)&secret[0],secret.size());
+
+        bool written = ::write(fd,secret.data(),secret.size()) == (ssize_t)secret.size() && ::fsync(fd) == 0;
+        ::close(fd);
+
+        if(!written){
+            std::remove(t_path.c_str());
+            RCWARNING("failed to write the signature cache secret: " + t_path);
+            return "";
+        }
+    }
+
+    std::ifstream is(t_path,std::ios::binary);
+    std::string secret((std::istreambuf_iterator<char>(is)),std::istreambuf_iterator<char>());
+
+    if(secret.size() < SECRET_SIZE){
+        RCWARNING("signature cache secret is too short: " + t_path);
+        return "";
+    }
+
+    return secret;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureCache::size
+// Description:
+//      Get the number of verified signatures
+// ----------------------------------------------------------------------------
+size_t SignatureCache::size(){
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_entries.size();
+}
@@ -26,6 +26,9 @@
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 
+#include <cereal/archives/portable_binary.hpp>
+#include <cereal/types/string.hpp>
+
 // local includes
 #include "signature_record.hpp"
 #include "enums.hpp"
@@ -62,13 +65,13 @@ SignatureRecord::~SignatureRecord(){}
 
 // ----------------------------------------------------------------------------
 // Name:
-//      SignatureRecord::is_valid
+//      SignatureRecord::is_well_formed
 // Description:
-//      Checks SignatureRecord-specific values and that the Record is
-//      signed and mined correctly.
+//      Checks SignatureRecord-specific values, before the Record is
+//      checked for work and a signature
 // ----------------------------------------------------------------------------
-bool SignatureRecord::is_valid(){
-  bool valid = BaseRecord::is_valid();
+bool SignatureRecord::is_well_formed(){
+  bool valid = BaseRecord::is_well_formed();
 
   // check if the signature has a reference
   if(m_record_hash.empty()){
@@ -93,6 +96,48 @@ std::string SignatureRecord::get_data(){
     return data;
 }
 
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureRecord::encode_fields
+// Description:
+//      Append the hash of the signed publication
+// ----------------------------------------------------------------------------
+void SignatureRecord::encode_fields( std::string& t_out ){
+    encode_digest(t_out,m_record_hash);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureRecord::release_fields
+// Description:
+//      Free the hash of the signed publication of a released view
+// ----------------------------------------------------------------------------
+void SignatureRecord::release_fields(){
+    std::string().swap(m_record_hash);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureRecord::save_binary
+// Description:
+//      Write the BaseRecord fields and then the signed record hash
+// ----------------------------------------------------------------------------
+void SignatureRecord::save_binary( cereal::PortableBinaryOutputArchive& t_archive ){
+    BaseRecord::save_binary(t_archive);
+    save_hex(t_archive,m_record_hash);
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureRecord::load_binary
+// Description:
+//      Read the fields written by save_binary
+// ----------------------------------------------------------------------------
+void SignatureRecord::load_binary( cereal::PortableBinaryInputArchive& t_archive ){
+    BaseRecord::load_binary(t_archive);
+    load_hex(t_archive,m_record_hash);
+}
+
 // ----------------------------------------------------------------------------
 // Name:
 //      SignatureRecord::to_string
@@ -113,4 +158,14 @@ std::string SignatureRecord::to_string(){
 
 }
 
+// ----------------------------------------------------------------------------
+// Name:
+//      SignatureRecord::clone
+// Description:
+//      Copies the SignatureRecord into a new shared_ptr
+// ----------------------------------------------------------------------------
+std::shared_ptr<BaseRecord> SignatureRecord::clone(){
+    return std::make_shared<SignatureRecord>(*this);
+}
+
 BOOST_CLASS_EXPORT_IMPLEMENT(SignatureRecord)
@@ -0,0 +1,188 @@
+/*
+ * ReChain: The distributed research journal
+ * Copyright (C) 2018  Michael House
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: mjhouse@protonmail.com
+ *
+*/
+
+
+// system includes
+#include <string>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+
+// local includes
+#include "validator.hpp"
+#include "keys.hpp"
+#include "key_cache.hpp"
+#include "signature_cache.hpp"
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Validator members
+// Description:
+//      The counters are shared by every record and thread
+// ----------------------------------------------------------------------------
+std::atomic<uint64_t> Validator::s_rejected[Validator::Passed];
+std::atomic<uint64_t> Validator::s_passed(0);
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Validator::reject
+// Description:
+//      Count a record turned away at a stage
+// ----------------------------------------------------------------------------
+Validator::Stage Validator::reject( Stage t_stage ){
+    s_rejected[t_stage]++;
+    return t_stage;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Validator::check
+// Description:
+//      Run the stages cheapest first. Structure only looks at the
+//      fields, work hashes once, the link is a few lookups, and a
+//      key parse and signature check cost the most unless they're
+//      cached. A key or signature that CryptoPP can't decode counts
+//      as a rejection at that stage.
+// ----------------------------------------------------------------------------
+Validator::Stage Validator::check( BaseRecord* t_record, const link_t& t_link ){
+    return check(t_record,t_link,BaseRecord::get_difficulty());
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Validator::check_remote
+// Description:
+//      Check a record from a peer at no less than the minimum
+//      difficulty, and without a link since there's no chain
+// ----------------------------------------------------------------------------
+Validator::Stage Validator::check_remote( BaseRecord* t_record ){
+    return check(t_record,link_t(),std::max(BaseRecord::get_difficulty(),(unsigned int)MIN_REMOTE_DIFFICULTY));
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Validator::check
+// Description:
+//      Run the stages, with the work stage at a given difficulty
+// ----------------------------------------------------------------------------
+Validator::Stage Validator::check( BaseRecord* t_record, const link_t& t_link, unsigned int t_difficulty ){
+
+    if(!t_record->is_well_formed()){
+        return reject(Structure);
+    }
+
+    if(!t_record->is_mined(t_difficulty)){
+        return reject(Work);
+    }
+
+    if(t_link && !t_link()){
+        return reject(Link);
+    }
+
+    // signatures verified on an earlier run are only hashed
+    std::string entry = SignatureCache::is_open() ? SignatureCache::entry(t_record) : std::string();
+
+    if(!SignatureCache::contains(entry)){
+
+        std::shared_ptr<PublicKey> key;
+
+        try {
+            key = KeyCache::get(t_record->get_public_key());
+        } catch (const CryptoPP::Exception& e){
+            return reject(Key);
+        } catch (const std::invalid_argument& e){
+            return reject(Key);
+        }
+
+        try {
+            if(!key->verify(t_record)){
+                return reject(Signature);
+            }
+        } catch (const CryptoPP::Exception& e){
+            return reject(Signature);
+        }
+
+        SignatureCache::add(entry);
+    }
+
+    s_passed++;
+    return Passed;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Validator::check_link
+// Description:
+//      Run and count the link stage on its own
+// ----------------------------------------------------------------------------
+bool Validator::check_link( const link_t& t_link ){
+
+    if(!t_link()){
+        reject(Link);
+        return false;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Validator::get_rejected
+// Description:
+//      Get the number of records turned away at a stage
+// ----------------------------------------------------------------------------
+uint64_t Validator::get_rejected( Stage t_stage ){
+    return t_stage < Passed ? s_rejected[t_stage].load() : 0;
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Validator::get_name
+// Description:
+//      Get the name of a stage
+// ----------------------------------------------------------------------------
+std::string Validator::get_name( Stage t_stage ){
+
+    switch(t_stage){
+        case Structure: return "structure";
+        case Work:      return "work";
+        case Link:      return "link";
+        case Key:       return "key";
+        case Signature: return "signature";
+        default:        return "passed";
+    }
+
+}
+
+// ----------------------------------------------------------------------------
+// Name:
+//      Validator::reset
+// Description:
+//      Set every counter to zero
+// ----------------------------------------------------------------------------
+void Validator::reset(){
+
+    for(auto& rejected : s_rejected){
+        rejected = 0;
+    }
+
+    s_passed = 0;
+}
@@ -34,7 +34,9 @@ class test_set {
 
     public:
 
-        static std::vector<test_set*> all_test_sets;
+        // a function-local static, so sets in other files can
+        // register no matter which is initialized first
+        static std::vector<test_set*>& all_test_sets();
         static test_case* current_test_case;
 
         static int test_case_count;
@@ -1,17 +1,28 @@
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include <boost/archive/text_iarchive.hpp>
+#include <boost/filesystem.hpp>
 #include "test-framework.hpp"
 
 #include "blockchain.hpp"
+#include "generator.hpp"
 #include "genesis_record.hpp"
 #include "publication_record.hpp"
 #include "signature_record.hpp"
 #include "enums.hpp"
 #include "keys.hpp"
 
+namespace fs = boost::filesystem;
+
 test_set blockchain_tests("tests for the blockchain",{
 
     {"call blockchain default constructor",[]{
@@ -142,6 +153,102 @@ test_set blockchain_tests("tests for the blockchain",{
 
     }},
 
+    {"keep hash formats when saving and loading",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+
+        // chains saved before the binary encoding have text hashes
+        Blockchain blockchain;
+        blockchain.load(get_path("files/gold/test_blockchain_find.gold"));
+
+        RCREQUIRE(blockchain.size() > 0);
+        for(auto record : blockchain){
+            RCREQUIRE(record->get_format() == HashFormat::Text);
+        }
+
+        // new records use the binary encoding
+        std::shared_ptr<PublicationRecord> publication(new PublicationRecord());
+        publication->set_reference("FORMATS");
+
+        RCREQUIRE(blockchain.publish(publication,private_key));
+        RCREQUIRE(publication->get_format() == HashFormat::Binary);
+
+        std::string path = get_path("files/gold/test_blockchain_formats.tmp");
+        RCREQUIRE(blockchain.save(path));
+
+        Blockchain loaded;
+        loaded.load(path);
+        std::remove(path.c_str());
+
+        RCREQUIRE(loaded.size() == blockchain.size());
+
+        auto it = loaded.begin();
+        for(auto record : blockchain){
+            RCREQUIRE((*it)->get_format() == record->get_format());
+            RCREQUIRE((*it)->hash() == record->hash());
+            ++it;
+        }
+
+    }},
+
+    {"save and load a binary chain",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+
+        std::shared_ptr<GenesisRecord> genesis(new GenesisRecord());
+        genesis->set_distribution({"FIRST","SECOND"});
+
+        std::shared_ptr<PublicationRecord> publication(new PublicationRecord(get_path("files/general/test_publication.txt")));
+
+        Blockchain blockchain;
+        RCREQUIRE(blockchain.publish(genesis,private_key));
+        RCREQUIRE(blockchain.publish(publication,private_key));
+
+        std::shared_ptr<SignatureRecord> signature(new SignatureRecord(publication->hash()));
+        RCREQUIRE(blockchain.publish(signature,private_key));
+
+        std::string text = get_path("files/gold/test_blockchain_text.tmp");
+        std::string binary = get_path("files/gold/test_blockchain_binary.tmp");
+
+        RCREQUIRE(blockchain.get_file_format() == FileFormat::TextFile);
+        RCREQUIRE(blockchain.save(text));
+
+        blockchain.set_file_format(FileFormat::BinaryFile);
+        RCREQUIRE(blockchain.save(binary));
+
+        std::string data = dump_file(binary);
+        RCREQUIRE(data.substr(0,4) == "RCHN");
+        RCREQUIRE(data.size() < dump_file(text).size());
+
+        // the format is found from the file
+        Blockchain loaded;
+        RCREQUIRE(loaded.load(binary));
+        RCREQUIRE(loaded.get_file_format() == FileFormat::BinaryFile);
+        RCREQUIRE(loaded.size() == 3);
+
+        auto it = loaded.begin();
+        for(auto record : blockchain){
+            RCREQUIRE((*it)->get_type() == record->get_type());
+            RCREQUIRE((*it)->hash() == record->hash());
+            ++it;
+        }
+
+        RCREQUIRE(loaded.load(text));
+        RCREQUIRE(loaded.get_file_format() == FileFormat::TextFile);
+
+        // a truncated binary file doesn't load
+        std::ofstream ofs(binary,std::ios::binary | std::ios::trunc);
+        ofs << data.substr(0,data.size()/2);
+        ofs.close();
+
+        Blockchain truncated;
+        RCREQUIRE(!truncated.load(binary));
+
+        std::remove(text.c_str());
+        std::remove(binary.c_str());
+
+    }},
+
     {"find signatures by reference",[]{
 
         std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
@@ -192,6 +299,98 @@ test_set blockchain_tests("tests for the blockchain",{
 
     }},
 
+    {"report the first record that isn't valid on any number of threads",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+
+        Generator generator(24,3,0.5,4);
+        generator.set_keys(get_path("keys"));
+
+        Blockchain blockchain;
+        RCREQUIRE(generator.generate(blockchain));
+
+        BaseRecord::set_difficulty(4);
+
+        for(size_t threads : {1,2,5}){
+            RCREQUIRE(blockchain.is_valid(threads));
+            RCREQUIRE(blockchain.get_invalid() == 24);
+        }
+
+        // a bad signature after a broken link, and one before it
+        auto it = blockchain.begin();
+        (*(it + 17))->set_signature("00");
+        (*(it + 11))->set_previous("NOTAHASH");
+
+        for(size_t threads : {1,2,5}){
+            RCREQUIRE(!blockchain.is_valid(threads));
+            RCREQUIRE(blockchain.get_invalid() == 11);
+        }
+
+        (*(it + 6))->set_signature("00");
+
+        for(size_t threads : {1,2,5}){
+            RCREQUIRE(!blockchain.is_valid(threads));
+            RCREQUIRE(blockchain.get_invalid() == 6);
+        }
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"validate only the records after the validated height",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+
+        Generator generator(12,2,0.5,4);
+        generator.set_keys(get_path("keys"));
+
+        fs::path path = fs::temp_directory_path() / "test_blockchain_validated";
+        fs::remove_all(path);
+
+        {
+            Blockchain blockchain;
+            RCREQUIRE(generator.generate(blockchain));
+
+            BaseRecord::set_difficulty(4);
+
+            RCREQUIRE(blockchain.open(path.string()));
+
+            // every record was checked as it was appended
+            RCREQUIRE(blockchain.get_validated() == 12);
+            RCREQUIRE(blockchain.validate_from(blockchain.get_validated()));
+            RCREQUIRE(blockchain.get_invalid() == 12);
+
+            // a record changed after it was checked isn't checked again
+            auto it = blockchain.begin();
+            (*(it + 11))->set_signature("00");
+
+            RCREQUIRE(blockchain.validate_from(12));
+            RCREQUIRE(!blockchain.validate_from(4));
+            RCREQUIRE(blockchain.get_invalid() == 11);
+            RCREQUIRE(blockchain.get_validated() == 11);
+
+            // nothing after an invalid record is taken as valid
+            std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+            std::shared_ptr<PublicationRecord> publication(new PublicationRecord());
+            publication->set_reference("VALIDATED");
+
+            RCREQUIRE(!blockchain.publish(publication,private_key));
+            RCREQUIRE(blockchain.size() == 12);
+            RCREQUIRE(blockchain.get_validated() == 11);
+            RCREQUIRE(!blockchain.validate_from(100));
+            RCREQUIRE(blockchain.get_invalid() == 11);
+        }
+
+        // and the rejected record never reached the segments
+        Blockchain reopened;
+        RCREQUIRE(reopened.open(path.string()));
+        RCREQUIRE(reopened.size() == 12);
+
+        fs::remove_all(path);
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
     {"check blockchain is valid with published records",[]{
 
         Blockchain blockchain;
@@ -261,4 +460,205 @@ test_set blockchain_tests("tests for the blockchain",{
         delete user2_pub;
     }},
 
+    {"publish a record in the background",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+
+        Blockchain blockchain;
+
+        std::shared_ptr<GenesisRecord> genesis(new GenesisRecord());
+        genesis->set_distribution({"FIRST","SECOND"});
+
+        auto job = blockchain.publish_async(genesis,private_key,2);
+
+        RCREQUIRE(job->wait());
+        RCREQUIRE(job->is_finished());
+        RCREQUIRE(job->get_attempts() > 0);
+        RCREQUIRE(job->get_restarts() == 0);
+
+        RCREQUIRE(blockchain.size() == 1);
+        RCREQUIRE(blockchain.is_valid());
+
+    }},
+
+    {"cancel a mining job",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(64);
+
+        Blockchain blockchain;
+
+        std::shared_ptr<GenesisRecord> genesis(new GenesisRecord());
+        auto job = blockchain.publish_async(genesis,private_key,2);
+
+        // wait until it's mining
+        while(job->get_attempts() == 0){
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        RCREQUIRE(!job->wait_for(0.01));
+        RCREQUIRE(job->get_hash_rate() > 0);
+
+        job->cancel();
+
+        RCREQUIRE(!job->wait());
+        RCREQUIRE(job->is_cancelled());
+        RCREQUIRE(blockchain.size() == 0);
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"restart a mining job when the tip changes",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(8);
+
+        Blockchain blockchain;
+
+        std::shared_ptr<GenesisRecord> genesis(new GenesisRecord());
+        genesis->set_distribution({"FIRST","SECOND"});
+
+        RCREQUIRE(blockchain.publish(genesis,private_key));
+
+        // mine a record that won't finish at this difficulty
+        BaseRecord::set_difficulty(64);
+
+        std::shared_ptr<PublicationRecord> slow(new PublicationRecord());
+        slow->set_reference("SLOW");
+
+        auto job = blockchain.publish_async(slow,private_key,1);
+
+        while(job->get_attempts() == 0){
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // extend the chain underneath it
+        BaseRecord::set_difficulty(8);
+
+        std::shared_ptr<PublicationRecord> fast(new PublicationRecord());
+        fast->set_reference("FAST");
+
+        RCREQUIRE(blockchain.publish(fast,private_key));
+
+        // the job restarts on the new tip (at the new difficulty)
+        RCREQUIRE(job->wait());
+        RCREQUIRE(job->get_restarts() > 0);
+
+        RCREQUIRE(blockchain.size() == 3);
+        RCREQUIRE(slow->get_previous() == fast->hash());
+        RCREQUIRE(blockchain.is_valid());
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"read the chain while a job appends",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(4);
+
+        Blockchain blockchain;
+
+        std::shared_ptr<GenesisRecord> genesis(new GenesisRecord());
+        genesis->set_distribution({"FIRST","SECOND"});
+        RCREQUIRE(blockchain.publish(genesis,private_key));
+
+        for(size_t i = 0; i < 8; ++i){
+
+            std::shared_ptr<PublicationRecord> publication(new PublicationRecord());
+            publication->set_reference("READ" + std::to_string(i));
+
+            auto job = blockchain.publish_async(publication,private_key,1);
+
+            // every lookup sees the chain before or after the append
+            while(!job->is_finished()){
+                RCREQUIRE(blockchain.find_record(genesis->hash()) == genesis);
+                RCREQUIRE(blockchain.size() == i + 1 || blockchain.size() == i + 2);
+                blockchain.find_publication("READ" + std::to_string(i));
+                blockchain.trust("FIRST");
+            }
+
+            RCREQUIRE(job->wait());
+            RCREQUIRE(blockchain.find_record(publication->hash()) == publication);
+        }
+
+        // iterators can't be handed out while a job could append
+        BaseRecord::set_difficulty(64);
+
+        std::shared_ptr<PublicationRecord> slow(new PublicationRecord());
+        slow->set_reference("SLOW");
+
+        auto job = blockchain.publish_async(slow,private_key,1);
+
+        bool refused = false;
+        try {
+            blockchain.begin();
+        }
+        catch(const std::logic_error& e){
+            refused = true;
+        }
+
+        job->cancel();
+        RCREQUIRE(refused);
+        RCREQUIRE(!job->wait());
+        RCREQUIRE(blockchain.begin() != blockchain.end());
+        RCREQUIRE(blockchain.size() == 9);
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"keep a whole chain when a save is killed",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+
+        Blockchain blockchain;
+
+        std::shared_ptr<GenesisRecord> genesis(new GenesisRecord());
+        genesis->set_distribution({"FIRST","SECOND"});
+        RCREQUIRE(blockchain.publish(genesis,private_key));
+
+        std::shared_ptr<PublicationRecord> publication(new PublicationRecord());
+        publication->set_reference("SAVED");
+        RCREQUIRE(blockchain.publish(publication,private_key));
+
+        std::string path = get_path("files/gold/test_blockchain_killed.tmp");
+        RCREQUIRE(blockchain.save(path));
+
+        std::shared_ptr<PublicationRecord> unsaved(new PublicationRecord());
+        unsaved->set_reference("UNSAVED");
+        RCREQUIRE(blockchain.publish(unsaved,private_key));
+
+        // a process that saves the longer chain until it's killed
+        pid_t child = ::fork();
+        RCREQUIRE(child >= 0);
+
+        if(child == 0){
+            while(true){
+                blockchain.save(path);
+            }
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        ::kill(child,SIGKILL);
+        ::waitpid(child,nullptr,0);
+
+        // the file is one chain or the other, never part of one
+        Blockchain loaded;
+        RCREQUIRE(loaded.load(path));
+        RCREQUIRE(loaded.size() == 2 || loaded.size() == 3);
+
+        std::remove(path.c_str());
+        std::remove((path + ".tmp").c_str());
+
+    }},
+
 });
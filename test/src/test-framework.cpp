@@ -3,7 +3,10 @@
 
 using namespace std::chrono;
 
-std::vector<test_set*> test_set::all_test_sets = {};
+std::vector<test_set*>& test_set::all_test_sets(){
+    static std::vector<test_set*> sets;
+    return sets;
+}
 
 test_case* test_set::current_test_case = nullptr;
 test_set* test_framework::current_test_set = nullptr;
@@ -18,7 +21,7 @@ test_set::test_set( std::string t_name, std::vector<test_case> t_cases, std::vec
 
     test_set::test_set_count += 1;
     test_set::test_case_count += t_cases.size();
-    test_set::all_test_sets.push_back(this);
+    test_set::all_test_sets().push_back(this);
 }
 
 bool test_set::run() {
@@ -51,7 +54,7 @@ bool test_framework::run(){
     run_time = 0;
     high_resolution_clock::time_point t1 = high_resolution_clock::now();
 
-    for(auto test : test_set::all_test_sets){
+    for(auto test : test_set::all_test_sets()){
 
         test_framework::current_test_set = test;
 
@@ -0,0 +1,91 @@
+#include <iostream>
+#include <memory>
+
+#include <boost/filesystem.hpp>
+
+#include "test-framework.hpp"
+
+#include "generator.hpp"
+#include "blockchain.hpp"
+#include "publication_record.hpp"
+#include "signature_record.hpp"
+
+test_set generator_tests("tests for the chain generator",{
+
+    {"generate a valid chain from existing keys",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+
+        Generator generator(31,3,0.5,4);
+        generator.set_keys(get_path("keys"));
+
+        Blockchain chain;
+        RCREQUIRE(generator.generate(chain));
+        RCREQUIRE(chain.size() == 31);
+
+        // the difficulty is put back afterwards
+        RCREQUIRE(BaseRecord::get_difficulty() == difficulty);
+
+        size_t publications = 0;
+        size_t signatures = 0;
+
+        for(auto& record : chain){
+            if(record->get_type() == RecordType::Publication) ++publications;
+            if(record->get_type() == RecordType::Signature)   ++signatures;
+        }
+
+        RCREQUIRE(publications == 15);
+        RCREQUIRE(signatures == 15);
+
+        // the saved chain loads at the same difficulty
+        std::string path = (boost::filesystem::temp_directory_path() / "rechain-generated.dat").string();
+        RCREQUIRE(chain.save(path));
+
+        BaseRecord::set_difficulty(4);
+
+        Blockchain loaded;
+        RCREQUIRE(loaded.load(path));
+        RCREQUIRE(loaded.size() == 31);
+
+        BaseRecord::set_difficulty(difficulty);
+        boost::filesystem::remove(path);
+
+    }},
+
+    {"put the difficulty back when generating throws",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+
+        // new keys can't be saved under a file
+        Generator generator(3,1,0.5,difficulty + 1);
+        generator.set_keys("/dev/null/keys");
+
+        Blockchain chain;
+        bool thrown = false;
+
+        try {
+            generator.generate(chain);
+        }
+        catch(const std::exception& e){
+            thrown = true;
+        }
+
+        RCREQUIRE(thrown);
+        RCREQUIRE(BaseRecord::get_difficulty() == difficulty);
+
+    }},
+
+    {"generate with a bad publication ratio",[]{
+
+        try {
+            Generator generator(10,2,0,4);
+        }
+        catch(const std::invalid_argument& e){
+            return;
+        }
+
+        RCTHROW("a ratio of zero did not fail");
+
+    }},
+
+});
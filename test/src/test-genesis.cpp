@@ -212,7 +212,7 @@ test_set genesis_tests("tests for genesis records",{
         private_key->sign(&gr);
         gr.mine();
 
-        RCREQUIRE(gr.hash() < HASH_MAX);
+        RCREQUIRE(gr.is_mined());
         RCREQUIRE(!(gr.get_signature().empty()));
         RCREQUIRE(public_key->verify(&gr));
         RCREQUIRE(gr.is_valid());
@@ -273,7 +273,7 @@ test_set genesis_tests("tests for genesis records",{
         RCREQUIRE(gr.get_nonce() > 0);
         RCREQUIRE(gr.get_timestamp() > 0);
         RCREQUIRE(gr.get_counter() > 0);
-        RCREQUIRE(gr.hash() < HASH_MAX);
+        RCREQUIRE(gr.is_mined());
         RCREQUIRE(!(gr.get_signature().empty()));
         RCREQUIRE(public_key->verify(&gr));
         RCREQUIRE(gr.is_valid());
@@ -0,0 +1,139 @@
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "test-framework.hpp"
+
+#include "key_cache.hpp"
+#include "keys.hpp"
+#include "publication_record.hpp"
+
+// the hex encoding of a test key
+static std::string encoding( std::string t_name ){
+    std::shared_ptr<PublicKey> key(PublicKey::load_file(get_path("keys/" + t_name + ".public")));
+    return key->to_string();
+}
+
+test_set key_cache_tests("tests for the public key cache",{
+
+    {"parse a key once and find it after",[]{
+
+        KeyCache::clear();
+        std::string rsa = encoding("rsa");
+
+        auto first = KeyCache::get(rsa);
+        RCREQUIRE(KeyCache::get_misses() == 1);
+        RCREQUIRE(KeyCache::get_hits() == 0);
+
+        auto second = KeyCache::get(rsa);
+        RCREQUIRE(second == first);
+        RCREQUIRE(KeyCache::get_misses() == 1);
+        RCREQUIRE(KeyCache::get_hits() == 1);
+        RCREQUIRE(KeyCache::size() == 1);
+
+        KeyCache::clear();
+
+    }},
+
+    {"drop the least recently used key when full",[]{
+
+        KeyCache::clear();
+        size_t capacity = KeyCache::get_capacity();
+        KeyCache::set_capacity(2);
+
+        std::string rsa   = encoding("rsa");
+        std::string user1 = encoding("user1");
+        std::string user2 = encoding("user2");
+
+        KeyCache::get(rsa);
+        KeyCache::get(user1);
+
+        // rsa is used again, so user1 is the oldest
+        KeyCache::get(rsa);
+        KeyCache::get(user2);
+        RCREQUIRE(KeyCache::size() == 2);
+        RCREQUIRE(KeyCache::get_misses() == 3);
+
+        KeyCache::get(rsa);
+        RCREQUIRE(KeyCache::get_misses() == 3);
+
+        KeyCache::get(user1);
+        RCREQUIRE(KeyCache::get_misses() == 4);
+
+        // a cache with no room parses every time
+        KeyCache::set_capacity(0);
+        RCREQUIRE(KeyCache::size() == 0);
+
+        KeyCache::get(rsa);
+        KeyCache::get(rsa);
+        RCREQUIRE(KeyCache::get_misses() == 6);
+
+        KeyCache::set_capacity(capacity);
+        KeyCache::clear();
+
+    }},
+
+    {"refuse to cache a key that can't be parsed",[]{
+
+        KeyCache::clear();
+
+        try {
+            KeyCache::get("NOTAKEY");
+        }
+        catch(const std::exception& e){
+            RCREQUIRE(KeyCache::size() == 0);
+            return;
+        }
+
+        RCTHROW("a bad key was parsed");
+
+    }},
+
+    {"verify records from several threads with the cached keys",[]{
+
+        KeyCache::clear();
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+        std::vector< std::shared_ptr<PublicationRecord> > records;
+
+        for(size_t i = 0; i < 8; ++i){
+            std::shared_ptr<PublicationRecord> record(new PublicationRecord());
+            record->set_reference("CACHE" + std::to_string(i));
+            private_key->sign(record);
+            records.push_back(record);
+        }
+
+        // signing adds the key, so checking never parses it
+        RCREQUIRE(KeyCache::size() == 1);
+
+        std::vector<char> verified(records.size(),0);
+        std::vector<std::thread> threads;
+
+        for(size_t i = 0; i < records.size(); ++i){
+            threads.push_back(std::thread([&,i]{
+                auto key = KeyCache::get(records[i]->get_public_key());
+                verified[i] = key->verify(records[i].get());
+            }));
+        }
+
+        for(auto& thread : threads){
+            thread.join();
+        }
+
+        for(auto result : verified){
+            RCREQUIRE(result);
+        }
+
+        RCREQUIRE(KeyCache::get_misses() == 0);
+        RCREQUIRE(KeyCache::get_hits() == records.size());
+
+        // a changed signature still fails with a cached key
+        records[0]->set_signature("00");
+        RCREQUIRE(!KeyCache::get(records[0]->get_public_key())->verify(records[0].get()));
+
+        KeyCache::clear();
+
+    }},
+
+});
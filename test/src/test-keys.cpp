@@ -0,0 +1,206 @@
+#include <iostream>
+#include <memory>
+
+#include <boost/filesystem.hpp>
+
+#include "test-framework.hpp"
+
+#include "keys.hpp"
+#include "key_cache.hpp"
+#include "publication_record.hpp"
+#include "signature_record.hpp"
+
+namespace fs = boost::filesystem;
+
+test_set key_tests("tests for the key types",{
+
+    {"sign and verify a record with an Ed25519 key",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(4);
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::empty());
+        private_key->generate(KeyType::Ed25519Key);
+        RCREQUIRE(private_key->get_type() == KeyType::Ed25519Key);
+        RCREQUIRE(private_key->valid());
+
+        std::shared_ptr<PublicKey> public_key(private_key->get_public());
+        RCREQUIRE(public_key->get_type() == KeyType::Ed25519Key);
+
+        std::shared_ptr<PublicationRecord> pr(new PublicationRecord(get_path("files/general/test_publication.txt")));
+        private_key->sign(pr);
+        pr->mine(2);
+
+        RCREQUIRE(pr->get_public_key() == public_key->to_string());
+        RCREQUIRE(pr->get_signature().size() == 128);
+        RCREQUIRE(public_key->verify(pr.get()));
+        RCREQUIRE(pr->is_valid());
+
+        // a key that isn't cached is parsed from the record
+        KeyCache::clear();
+        RCREQUIRE(pr->is_valid());
+
+        std::string signature = pr->get_signature();
+        signature[0] = signature[0] == 'A' ? 'B' : 'A';
+        pr->set_signature(signature);
+
+        RCREQUIRE(!public_key->verify(pr.get()));
+        RCREQUIRE(!pr->is_valid());
+
+        KeyCache::clear();
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"save and load keys of either type",[]{
+
+        std::string path = (fs::temp_directory_path() / "rechain-test-ed25519.private").string();
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::empty());
+        private_key->generate(KeyType::Ed25519Key);
+        RCREQUIRE(private_key->save(path));
+
+        std::shared_ptr<PrivateKey> loaded(PrivateKey::load_file(path));
+        RCREQUIRE(loaded->get_type() == KeyType::Ed25519Key);
+        RCREQUIRE(loaded->to_string() == private_key->to_string());
+
+        std::shared_ptr<PrivateKey> copy(new PrivateKey(loaded.get()));
+        RCREQUIRE(copy->get_type() == KeyType::Ed25519Key);
+
+        std::string encoding = std::shared_ptr<PublicKey>(loaded->get_public())->to_string();
+        std::shared_ptr<PublicKey> public_key(PublicKey::load_string(encoding));
+        RCREQUIRE(public_key->get_type() == KeyType::Ed25519Key);
+        RCREQUIRE(public_key->to_string() == encoding);
+
+        // existing keys are still RSA
+        std::shared_ptr<PrivateKey> rsa(PrivateKey::load_file(get_path("keys/rsa.private")));
+        RCREQUIRE(rsa->get_type() == KeyType::RSAKey);
+        RCREQUIRE(std::shared_ptr<PublicKey>(PublicKey::load_file(get_path("keys/rsa.public")))->get_type() == KeyType::RSAKey);
+
+        // loading a key of the other type replaces it
+        loaded->from_string(rsa->to_string());
+        RCREQUIRE(loaded->get_type() == KeyType::RSAKey);
+        RCREQUIRE(loaded->to_string() == rsa->to_string());
+
+        fs::remove(path);
+
+    }},
+
+    {"read the key type from the algorithm identifier",[]{
+
+        std::string rsa = std::shared_ptr<PublicKey>(PublicKey::load_file(get_path("keys/rsa.public")))->to_string();
+
+        // rsaEncryption is 1.2.840.113549.1.1.1, and .2 isn't a key type
+        std::string other = rsa;
+        size_t algorithm = other.find("2A864886F70D010101");
+        RCREQUIRE(algorithm != std::string::npos);
+        other.replace(algorithm,18,"2A864886F70D010102");
+
+        for(std::string encoding : {other,std::string("00"),std::string("3003020100")}){
+            try {
+                std::shared_ptr<PublicKey> key(PublicKey::load_string(encoding));
+            }
+            catch(const std::invalid_argument& e){
+                continue;
+            }
+
+            RCTHROW("a key that isn't RSA or Ed25519 did not fail");
+        }
+
+    }},
+
+    {"verify records signed with both types",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(4);
+
+        std::shared_ptr<PrivateKey> rsa(PrivateKey::load_file(get_path("keys/rsa.private")));
+        std::shared_ptr<PrivateKey> ed25519(PrivateKey::empty());
+        ed25519->generate(KeyType::Ed25519Key);
+
+        std::shared_ptr<SignatureRecord> first(new SignatureRecord("NOTAHASH"));
+        std::shared_ptr<SignatureRecord> second(new SignatureRecord("NOTAHASH"));
+
+        rsa->sign(first);
+        ed25519->sign(second);
+
+        first->mine(2);
+        second->mine(2);
+
+        RCREQUIRE(first->is_valid());
+        RCREQUIRE(second->is_valid());
+
+        // Ed25519 records are much smaller
+        RCREQUIRE(second->get_public_key().size() * 4 < first->get_public_key().size());
+        RCREQUIRE(second->get_signature().size() * 4 < first->get_signature().size());
+
+        // a signature doesn't verify under the other type of key
+        std::shared_ptr<PublicKey> rsa_public(rsa->get_public());
+        std::shared_ptr<PublicKey> ed25519_public(ed25519->get_public());
+
+        RCREQUIRE(!rsa_public->verify(second.get()));
+        RCREQUIRE(!ed25519_public->verify(first.get()));
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"reuse the signing context until the key changes",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+
+        auto context = private_key->get_context();
+        RCREQUIRE(private_key->get_context() == context);
+        RCREQUIRE(context->signer);
+        RCREQUIRE(!context->ed25519_signer);
+        RCREQUIRE(context->encoding == std::shared_ptr<PublicKey>(PublicKey::load_file(get_path("keys/rsa.public")))->to_string());
+
+        // copies share it
+        std::shared_ptr<PrivateKey> copy(new PrivateKey(private_key.get()));
+        RCREQUIRE(copy->get_context() == context);
+
+        copy->generate(KeyType::Ed25519Key);
+        RCREQUIRE(copy->get_context() != context);
+        RCREQUIRE(copy->get_context()->ed25519_signer);
+        RCREQUIRE(copy->get_context()->encoding != context->encoding);
+
+        copy->from_string(private_key->to_string());
+        RCREQUIRE(copy->get_context()->encoding == context->encoding);
+
+    }},
+
+    {"sign a batch of records on several threads",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(4);
+
+        std::shared_ptr<PrivateKey> rsa(PrivateKey::load_file(get_path("keys/rsa.private")));
+        std::shared_ptr<PrivateKey> ed25519(PrivateKey::empty());
+        ed25519->generate(KeyType::Ed25519Key);
+
+        for(auto& key : {rsa,ed25519}){
+
+            std::vector< std::shared_ptr<BaseRecord> > records;
+            for(size_t i = 0; i < 13; ++i){
+                records.push_back(std::make_shared<SignatureRecord>("BATCH" + std::to_string(i)));
+            }
+
+            key->sign(records,3);
+
+            for(auto& record : records){
+                RCREQUIRE(record->get_public_key() == key->get_context()->encoding);
+                RCREQUIRE(key->get_context()->public_key->verify(record.get()));
+
+                record->mine(1);
+                RCREQUIRE(record->is_valid());
+            }
+
+            // nothing to sign is fine
+            key->sign(std::vector< std::shared_ptr<BaseRecord> >());
+        }
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+});
@@ -0,0 +1,276 @@
+#include <iostream>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+#include "test-framework.hpp"
+
+#include "loader.hpp"
+#include "blockchain.hpp"
+#include "generator.hpp"
+
+namespace fs = boost::filesystem;
+
+typedef std::vector< std::shared_ptr<BaseRecord> > records_t;
+
+// a small generated chain, mined at a difficulty of 4
+static records_t make_chain( size_t t_count ){
+
+    Generator generator(t_count,3,0.5,4);
+    generator.set_keys(get_path("keys"));
+
+    Blockchain chain;
+    generator.generate(chain);
+
+    return records_t(chain.begin(),chain.end());
+}
+
+test_set loader_tests("tests for the streaming loader",{
+
+    {"call loader constructor with zero sized chunks",[]{
+
+        try {
+            Loader loader(2,0);
+        }
+        catch(const std::invalid_argument& e){
+            return;
+        }
+
+        RCTHROW("loader with zero sized chunks did not fail");
+
+    }},
+
+    {"sink every record in chain order",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        records_t records = make_chain(21);
+
+        BaseRecord::set_difficulty(4);
+
+        // chunks smaller than the chain, so several are in flight
+        Loader loader(3,2);
+        records_t sunk;
+
+        std::vector<uint64_t> done;
+        loader.set_progress([&]( uint64_t t_done, uint64_t t_total ){
+            RCREQUIRE(t_total == records.size());
+            done.push_back(t_done);
+        });
+
+        RCREQUIRE(loader.run(records.size(),Loader::source(records),[&]( std::shared_ptr<BaseRecord> t_record ){
+            sunk.push_back(t_record);
+            return true;
+        }));
+
+        RCREQUIRE(loader.get_failed() == records.size());
+        RCREQUIRE(sunk.size() == records.size());
+
+        for(size_t i = 0; i < records.size(); ++i){
+            RCREQUIRE(sunk[i] == records[i]);
+        }
+
+        // progress after each chunk, ending with every record
+        RCREQUIRE(done.size() == 11);
+        RCREQUIRE(std::is_sorted(done.begin(),done.end()));
+        RCREQUIRE(done.back() == records.size());
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"stop at the first record that isn't valid",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        records_t records = make_chain(21);
+
+        BaseRecord::set_difficulty(4);
+
+        records[9]->set_signature("00");
+        records[15]->set_signature("00");
+
+        Loader loader(4,3);
+        size_t sunk = 0;
+
+        RCREQUIRE(!loader.run(records.size(),Loader::source(records),[&]( std::shared_ptr<BaseRecord> /* t_record */ ){
+            sunk++;
+            return true;
+        }));
+
+        RCREQUIRE(loader.get_failed() == 9);
+        RCREQUIRE(sunk == 9);
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"stop where the sink or the source fails",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        records_t records = make_chain(11);
+
+        BaseRecord::set_difficulty(4);
+
+        Loader loader(2,4);
+        size_t sunk = 0;
+
+        RCREQUIRE(!loader.run(records.size(),Loader::source(records),[&]( std::shared_ptr<BaseRecord> /* t_record */ ){
+            return ++sunk < 6;
+        }));
+
+        RCREQUIRE(loader.get_failed() == 5);
+
+        // a source that can't read past the seventh record
+        auto source = Loader::source(records_t(records.begin(),records.begin() + 7));
+        size_t calls = 0;
+
+        RCREQUIRE(!loader.run(records.size(),[&]( Loader::chunk_t& t_chunk, size_t t_count ){
+            source(t_chunk,t_count);
+            return ++calls < 2;
+        },[]( std::shared_ptr<BaseRecord> /* t_record */ ){
+            return true;
+        }));
+
+        RCREQUIRE(loader.get_failed() == 7);
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"stop the threads when the sink throws",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        records_t records = make_chain(11);
+
+        BaseRecord::set_difficulty(4);
+
+        Loader loader(2,2);
+        size_t sunk = 0;
+        bool thrown = false;
+
+        try {
+            loader.run(records.size(),Loader::source(records),[&]( std::shared_ptr<BaseRecord> /* t_record */ ){
+                if(++sunk == 5){
+                    throw std::runtime_error("sink failed");
+                }
+                return true;
+            });
+        }
+        catch(const std::runtime_error& e){
+            thrown = true;
+        }
+
+        RCREQUIRE(thrown);
+        RCREQUIRE(loader.get_failed() == 4);
+
+        // and when the progress function throws
+        thrown = false;
+        loader.set_progress([]( uint64_t /* t_done */, uint64_t /* t_total */ ){
+            throw std::runtime_error("progress failed");
+        });
+
+        try {
+            loader.run(records.size(),Loader::source(records),[]( std::shared_ptr<BaseRecord> /* t_record */ ){
+                return true;
+            });
+        }
+        catch(const std::runtime_error& e){
+            thrown = true;
+        }
+
+        RCREQUIRE(thrown);
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"load a chain while it's read",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+
+        Generator generator(31,3,0.5,4);
+        generator.set_keys(get_path("keys"));
+
+        Blockchain chain;
+        RCREQUIRE(generator.generate(chain));
+
+        BaseRecord::set_difficulty(4);
+        chain.update_trust();
+
+        for(auto format : {FileFormat::TextFile,FileFormat::BinaryFile}){
+
+            std::string path = (fs::temp_directory_path() / "rechain-loader.dat").string();
+
+            chain.set_file_format(format);
+            RCREQUIRE(chain.save(path));
+
+            uint64_t last = 0;
+
+            Blockchain loaded;
+            RCREQUIRE(loaded.load(path,[&]( uint64_t t_done, uint64_t t_total ){
+                RCREQUIRE(t_total == 31);
+                last = t_done;
+            }));
+
+            RCREQUIRE(last == 31);
+            RCREQUIRE(loaded.size() == 31);
+            RCREQUIRE(loaded.get_file_format() == format);
+
+            // the trust built as records arrive is the same
+            auto it = loaded.begin();
+            for(auto& record : chain){
+                RCREQUIRE((*it)->hash() == record->hash());
+                RCREQUIRE(loaded.trust(record->hash()) == chain.trust(record->hash()));
+                RCREQUIRE(loaded.trust(record->get_public_key()) == chain.trust(record->get_public_key()));
+                ++it;
+            }
+
+            fs::remove(path);
+        }
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"stop loading at a record that isn't valid",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+
+        Generator generator(11,2,0.5,4);
+        generator.set_keys(get_path("keys"));
+
+        Blockchain chain;
+        RCREQUIRE(generator.generate(chain));
+
+        BaseRecord::set_difficulty(4);
+
+        std::string path = (fs::temp_directory_path() / "rechain-loader-bad.dat").string();
+
+        chain.set_file_format(FileFormat::BinaryFile);
+        RCREQUIRE(chain.save(path));
+
+        // a record that doesn't reference the one before it
+        auto it = chain.begin();
+        (*(it + 6))->set_previous("NOTAHASH");
+        RCREQUIRE(chain.save(path));
+
+        uint64_t last = 0;
+
+        Blockchain loaded;
+        RCREQUIRE(!loaded.load(path,[&]( uint64_t t_done, uint64_t /* t_total */ ){
+            last = t_done;
+        }));
+
+        RCREQUIRE(last == 6);
+
+        // the records are read anyway, without trust
+        RCREQUIRE(loaded.size() == 11);
+        RCREQUIRE(loaded.trust((*(it + 1))->get_public_key()) == 0);
+
+        BaseRecord::set_difficulty(difficulty);
+        fs::remove(path);
+
+    }},
+
+});
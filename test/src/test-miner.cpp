@@ -0,0 +1,334 @@
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <algorithm>
+
+#include <cryptopp/filters.h>
+#include <cryptopp/hex.h>
+#include <cryptopp/sha.h>
+
+#include "test-framework.hpp"
+
+#include "miner.hpp"
+#include "lane_hasher.hpp"
+#include "publication_record.hpp"
+#include "signature_record.hpp"
+#include "genesis_record.hpp"
+#include "enums.hpp"
+#include "keys.hpp"
+
+test_set miner_tests("tests for the miner",{
+
+    {"call miner default constructor",[]{
+
+        Miner miner;
+        RCREQUIRE(miner.get_threads() > 0);
+
+    }},
+
+    {"call miner constructor with a thread count",[]{
+
+        Miner miner(3);
+        RCREQUIRE(miner.get_threads() == 3);
+
+    }},
+
+    {"mine a record without signing",[]{
+
+        Miner miner(2);
+        PublicationRecord pr(get_path("files/general/test_publication.txt"));
+
+        try {
+            miner.mine(&pr);
+        }
+        catch(const std::invalid_argument& e){
+            return;
+        }
+
+        RCTHROW("mining without signing did not fail");
+
+    }},
+
+    {"mine a record with several threads",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+        std::shared_ptr<PublicationRecord> pr(new PublicationRecord(get_path("files/general/test_publication.txt")));
+
+        private_key->sign(pr);
+
+        Miner miner(4);
+        std::string hash = miner.mine(pr);
+
+        // the winning values were written back to the record
+        RCREQUIRE(hash == pr->hash());
+        RCREQUIRE(pr->is_mined());
+        RCREQUIRE(pr->get_nonce() > 0);
+        RCREQUIRE(pr->get_timestamp() > 0);
+        RCREQUIRE(pr->get_counter() > 0);
+        RCREQUIRE(pr->is_valid());
+
+        // every worker reported its attempts
+        RCREQUIRE(miner.get_attempts().size() == 4);
+        RCREQUIRE(miner.get_thread_rates().size() == 4);
+        RCREQUIRE(miner.get_hash_rate() > 0);
+
+    }},
+
+    {"clone a record before mining",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+        std::shared_ptr<SignatureRecord> sr(new SignatureRecord("NOTAHASH"));
+
+        private_key->sign(sr);
+
+        auto copy = sr->clone();
+        RCREQUIRE(copy->to_string() == sr->to_string());
+        RCREQUIRE(copy->get_type() == RecordType::Signature);
+
+        sr->mine(2);
+        RCREQUIRE(copy->to_string() != sr->to_string());
+
+    }},
+
+    {"split a record around the hashing variables",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+        PublicationRecord pr(get_path("files/general/test_publication.txt"));
+
+        private_key->sign(&pr);
+
+        for(auto format : {HashFormat::Text,HashFormat::Binary}){
+
+            pr.set_format(format);
+
+            std::string prefix;
+            std::string suffix;
+
+            RCREQUIRE(pr.split(prefix,suffix));
+
+            std::string data = prefix + pr.hashing_data(pr.get_nonce(),pr.get_timestamp(),pr.get_counter(),format) + suffix;
+            RCREQUIRE(data == pr.encode());
+
+        }
+
+    }},
+
+    {"hash from a midstate matches the record hash",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+
+        std::shared_ptr<GenesisRecord> gr(new GenesisRecord());
+        gr->set_distribution({"FIRST","SECOND"});
+
+        std::shared_ptr<PublicationRecord> pr(new PublicationRecord(get_path("files/general/test_publication.txt")));
+        std::shared_ptr<SignatureRecord> sr(new SignatureRecord("NOTAHASH"));
+
+        std::vector< std::shared_ptr<BaseRecord> > records = {gr,pr,sr};
+
+        // the same records hashed in the text format
+        for(auto& record : {gr->clone(),pr->clone(),sr->clone()}){
+            record->set_format(HashFormat::Text);
+            records.push_back(record);
+        }
+
+        for(auto& record : records){
+
+            private_key->sign(record);
+            record->mine(2);
+
+            MidState state(record.get());
+            RCREQUIRE(state.is_valid());
+
+            // the mined values give the mined hash
+            std::string hash = state.hash(record->get_nonce(),record->get_timestamp(),record->get_counter());
+            RCREQUIRE(hash == record->hash());
+
+            // other values give different hashes
+            std::string other = state.hash(record->get_nonce() + 1,record->get_timestamp(),record->get_counter());
+            RCREQUIRE(other != record->hash());
+
+        }
+
+    }},
+
+    {"check digests against a difficulty",[]{
+
+        unsigned char digest[DIGEST_SIZE];
+
+        std::fill(digest,digest + DIGEST_SIZE,0xFF);
+        RCREQUIRE(BaseRecord::meets_difficulty(digest,0));
+        RCREQUIRE(!BaseRecord::meets_difficulty(digest,1));
+
+        // 0x00 0x0F ... has exactly 12 leading zero bits
+        digest[0] = 0x00;
+        digest[1] = 0x0F;
+        RCREQUIRE(BaseRecord::meets_difficulty(digest,12));
+        RCREQUIRE(!BaseRecord::meets_difficulty(digest,13));
+
+        // crosses a word boundary
+        std::fill(digest,digest + 5,0x00);
+        digest[5] = 0x7F;
+        RCREQUIRE(BaseRecord::meets_difficulty(digest,41));
+        RCREQUIRE(!BaseRecord::meets_difficulty(digest,42));
+
+        std::fill(digest,digest + DIGEST_SIZE,0x00);
+        RCREQUIRE(BaseRecord::meets_difficulty(digest,256));
+
+    }},
+
+    {"mine at a runtime difficulty",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+        std::shared_ptr<SignatureRecord> sr(new SignatureRecord("NOTAHASH"));
+
+        private_key->sign(sr);
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(4);
+
+        sr->mine(2);
+        RCREQUIRE(sr->hash()[0] == '0');
+        RCREQUIRE(sr->is_valid());
+
+        BaseRecord::set_difficulty(difficulty);
+
+        try {
+            BaseRecord::set_difficulty(257);
+        }
+        catch(const std::invalid_argument& e){
+            return;
+        }
+
+        RCTHROW("difficulty larger than the digest did not fail");
+
+    }},
+
+    {"hash lanes the same as CryptoPP on every backend",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+        std::shared_ptr<PublicationRecord> pr(new PublicationRecord(get_path("files/general/test_publication.txt")));
+
+        private_key->sign(pr);
+
+        LaneHasher::Backend backend = LaneHasher::get_backend();
+        MidState state(pr.get());
+
+        // more counters than lanes so that the last pass is partly empty
+        std::vector<uint32_t> counters;
+        for(uint32_t i = 0; i < 21; ++i){
+            counters.push_back(i);
+        }
+
+        for(auto& option : {LaneHasher::Scalar,LaneHasher::AVX2,LaneHasher::AVX512}){
+
+            if(!LaneHasher::set_backend(option)){
+                continue;
+            }
+
+            std::vector<unsigned char> digests(counters.size() * DIGEST_SIZE);
+            state.digest(1,2,counters,digests.data());
+
+            for(size_t i = 0; i < counters.size(); ++i){
+                unsigned char expected[DIGEST_SIZE];
+                state.digest(1,2,counters[i],expected);
+                RCREQUIRE(std::equal(expected,expected + DIGEST_SIZE,&digests[i * DIGEST_SIZE]));
+            }
+
+            // messages of every length around the block boundaries
+            std::vector<std::string> messages;
+            for(size_t i = 0; i < 200; ++i){
+                messages.push_back(std::string(i,(char)i));
+            }
+
+            digests.resize(messages.size() * DIGEST_SIZE);
+            LaneHasher::digest(messages,digests.data());
+
+            for(size_t i = 0; i < messages.size(); ++i){
+                std::string expected;
+                CryptoPP::SHA256 hasher;
+                CryptoPP::StringSource ss(messages[i],true,
+                    new CryptoPP::HashFilter(hasher,
+                        new CryptoPP::StringSink(expected)));
+
+                RCREQUIRE(expected == std::string((const char*)&digests[i * DIGEST_SIZE],DIGEST_SIZE));
+            }
+
+        }
+
+        LaneHasher::set_backend(backend);
+
+    }},
+
+    {"hash a batch of records",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+
+        std::shared_ptr<GenesisRecord> gr(new GenesisRecord());
+        std::shared_ptr<PublicationRecord> pr(new PublicationRecord(get_path("files/general/test_publication.txt")));
+        std::shared_ptr<SignatureRecord> sr(new SignatureRecord("NOTAHASH"));
+
+        std::vector< std::shared_ptr<BaseRecord> > records = {gr,pr,sr};
+        std::vector<std::string> data;
+
+        sr->set_format(HashFormat::Text);
+
+        for(auto& record : records){
+            private_key->sign(record);
+            data.push_back(record->encode());
+        }
+
+        // the first record already has a cached hash
+        gr->hash();
+
+        BaseRecord::hash_batch(records);
+
+        for(size_t i = 0; i < records.size(); ++i){
+            std::string expected;
+            CryptoPP::SHA256 hasher;
+            CryptoPP::StringSource ss(data[i],true,
+                new CryptoPP::HashFilter(hasher,
+                    new CryptoPP::HexEncoder(
+                        new CryptoPP::StringSink(expected))));
+
+            RCREQUIRE(records[i]->hash() == expected);
+        }
+
+    }},
+
+    {"encode records in the binary format",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+        std::shared_ptr<PublicationRecord> pr(new PublicationRecord(get_path("files/general/test_publication.txt")));
+
+        private_key->sign(pr);
+        RCREQUIRE(pr->get_format() == HashFormat::Binary);
+
+        std::string binary = pr->encode();
+        RCREQUIRE(binary == pr->encode_binary());
+        RCREQUIRE(binary[0] == (char)HashFormat::Binary);
+        RCREQUIRE(binary[1] == (char)RecordType::Publication);
+
+        // the hashing variables are the last 20 bytes
+        RCREQUIRE(binary.substr(binary.size() - 20) == BaseRecord::hashing_data(0,0,0,HashFormat::Binary));
+
+        // the reference is a digest, so it's stored as raw bytes
+        RCREQUIRE(binary.size() < pr->get_reference().size() + pr->get_public_key().size() + pr->get_signature().size() + 64);
+
+        std::string hash = pr->hash();
+
+        // the text format hashes the archive
+        pr->set_format(HashFormat::Text);
+        RCREQUIRE(pr->encode() == pr->to_string());
+        RCREQUIRE(pr->hash() != hash);
+
+        // a lowercase reference isn't decoded, so it has its own encoding
+        pr->set_format(HashFormat::Binary);
+        std::string reference = pr->get_reference();
+        std::transform(reference.begin(),reference.end(),reference.begin(),::tolower);
+
+        pr->set_reference(reference);
+        RCREQUIRE(pr->encode() != binary);
+
+    }},
+
+});
@@ -0,0 +1,207 @@
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <climits>
+
+#include "test-framework.hpp"
+
+#include "mining_pool.hpp"
+#include "blockchain.hpp"
+#include "publication_record.hpp"
+#include "genesis_record.hpp"
+#include "keys.hpp"
+
+test_set mining_pool_tests("tests for the mining pool",{
+
+    {"mine a record with remote workers",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+        std::shared_ptr<PublicationRecord> pr(new PublicationRecord(get_path("files/general/test_publication.txt")));
+
+        private_key->sign(pr);
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(10);
+
+        MiningServer server(0,1 << 12);
+        server.start();
+
+        std::string port = std::to_string(server.get_port());
+
+        // several workers on loopback, each with its own connections
+        std::vector< std::shared_ptr<MiningWorker> > workers;
+        std::vector<std::thread> threads;
+
+        for(size_t i = 0; i < 3; ++i){
+            auto worker = std::make_shared<MiningWorker>("127.0.0.1",port,1);
+            workers.push_back(worker);
+            threads.emplace_back([worker]{ worker->run(); });
+        }
+
+        std::string hash = server.mine(pr.get());
+
+        RCREQUIRE(hash == pr->hash());
+        RCREQUIRE(pr->is_valid());
+        RCREQUIRE(pr->get_nonce() > LONG_MAX / 2);
+        RCREQUIRE(server.get_workers() > 0);
+        RCREQUIRE(server.get_hash_rate() > 0);
+
+        // workers exit once the server goes away
+        server.stop();
+
+        uint64_t units = 0;
+        uint64_t solutions = 0;
+
+        for(size_t i = 0; i < threads.size(); ++i){
+            threads[i].join();
+            units += workers[i]->get_units();
+            solutions += workers[i]->get_solutions();
+        }
+
+        RCREQUIRE(units > 0);
+        RCREQUIRE(solutions == 1);
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"serve workers while another connection is idle",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+        std::shared_ptr<PublicationRecord> pr(new PublicationRecord(get_path("files/general/test_publication.txt")));
+
+        private_key->sign(pr);
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(10);
+
+        MiningServer server(0,1 << 12);
+        server.start();
+
+        // a connection that never sends a request
+        boost::asio::io_service service;
+        boost::asio::ip::tcp::socket idle(service);
+        idle.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"),server.get_port()));
+
+        MiningWorker worker("127.0.0.1",std::to_string(server.get_port()),1);
+        std::thread thread([&worker]{ worker.run(); });
+
+        std::string hash = server.mine(pr.get());
+
+        idle.close();
+        server.stop();
+        thread.join();
+
+        RCREQUIRE(hash == pr->hash());
+        RCREQUIRE(pr->is_valid());
+        RCREQUIRE(worker.get_solutions() == 1);
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"publish with local threads and remote workers",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(10);
+
+        auto server = std::make_shared<MiningServer>(0,1 << 12);
+        server->start();
+
+        MiningWorker worker("127.0.0.1",std::to_string(server->get_port()),1);
+        std::thread thread([&worker]{ worker.run(); });
+
+        Blockchain blockchain;
+        blockchain.set_mining_server(server);
+
+        std::shared_ptr<GenesisRecord> genesis(new GenesisRecord());
+        genesis->set_distribution({"FIRST","SECOND"});
+
+        std::shared_ptr<PublicationRecord> publication(new PublicationRecord());
+        publication->set_reference("NOTAHASH");
+
+        RCREQUIRE(blockchain.publish(genesis,private_key));
+        RCREQUIRE(blockchain.publish(publication,private_key));
+        RCREQUIRE(blockchain.size() == 2);
+        RCREQUIRE(blockchain.is_valid());
+
+        server->stop();
+        thread.join();
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"skip bad units from a mining server",[]{
+
+        using boost::asio::ip::tcp;
+
+        boost::asio::io_service service;
+        tcp::acceptor acceptor(service,tcp::endpoint(tcp::v4(),0));
+
+        // units that can't be parsed or don't make sense
+        std::vector< std::map<std::string,std::string> > units = {
+            {{"Nonce","NOTANUMBER"}},
+            {{"Hash-Format","7"}},
+            {{"Difficulty","4096"}},
+            {{"Prefix-Length","100"}}
+        };
+
+        std::thread server([&]{
+            for(auto& unit : units){
+                tcp::socket socket(service);
+                acceptor.accept(socket);
+
+                Request request;
+                request.read(socket);
+
+                Response response;
+                response.set_code(200);
+                response.set_status("OK");
+                response.set_property("Connection","close");
+
+                for(auto& property : unit){
+                    response.set_property(property.first,property.second);
+                }
+
+                response.write(socket);
+            }
+
+            // the worker gives up once the server goes away
+            acceptor.close();
+        });
+
+        MiningWorker worker("127.0.0.1",std::to_string(acceptor.local_endpoint().port()),1);
+        uint64_t mined = worker.run();
+
+        server.join();
+
+        RCREQUIRE(mined == 0);
+        RCREQUIRE(worker.get_units() == 0);
+
+    }},
+
+    {"mine without workers or local threads",[]{
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+        std::shared_ptr<PublicationRecord> pr(new PublicationRecord(get_path("files/general/test_publication.txt")));
+
+        private_key->sign(pr);
+
+        // never started, so nothing could ever solve it
+        MiningServer server;
+
+        try {
+            server.mine(pr.get());
+        }
+        catch(const std::invalid_argument& e){
+            return;
+        }
+
+        RCTHROW("mining with nothing to mine on did not fail");
+
+    }},
+
+});
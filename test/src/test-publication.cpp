@@ -1,6 +1,7 @@
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <sstream>
 
 #include <boost/archive/text_iarchive.hpp>
 #include "test-framework.hpp"
@@ -221,7 +222,7 @@ test_set publication_tests("tests for publication records",{
         private_key->sign(&pr);
         pr.mine();
 
-        RCREQUIRE(pr.hash() < HASH_MAX);
+        RCREQUIRE(pr.is_mined());
         RCREQUIRE(!(pr.get_signature().empty()));
         RCREQUIRE(public_key->verify(&pr));
         RCREQUIRE(!(pr.get_reference().empty()));
@@ -281,7 +282,7 @@ test_set publication_tests("tests for publication records",{
         RCREQUIRE(pr.get_nonce() > 0);
         RCREQUIRE(pr.get_timestamp() > 0);
         RCREQUIRE(pr.get_counter() > 0);
-        RCREQUIRE(pr.hash() < HASH_MAX);
+        RCREQUIRE(pr.is_mined());
         RCREQUIRE(!(pr.get_signature().empty()));
         RCREQUIRE(public_key->verify(&pr));
         RCREQUIRE(!(pr.get_reference().empty()));
@@ -289,6 +290,41 @@ test_set publication_tests("tests for publication records",{
 
         delete private_key;
         delete public_key;
+    }},
+
+    {"cached hash is updated when the record changes",[]{
+
+        PrivateKey* private_key = PrivateKey::load_file(get_path("keys/rsa.private"));
+        PublicationRecord pr(get_path("files/general/test_publication.txt"));
+
+        std::string unsigned_hash = pr.hash();
+        RCREQUIRE(unsigned_hash == pr.hash());
+
+        private_key->sign(&pr);
+        std::string signed_hash = pr.hash();
+        RCREQUIRE(signed_hash != unsigned_hash);
+
+        pr.set_reference("NOTAHASH");
+        RCREQUIRE(pr.hash() != signed_hash);
+
+        pr.set_previous("NOTAHASH");
+        std::string previous_hash = pr.hash();
+
+        pr.mine(1);
+        RCREQUIRE(pr.hash() != previous_hash);
+        RCREQUIRE(pr.is_mined());
+
+        // a fresh copy from the archive hashes the same
+        std::stringstream data(pr.to_string());
+        PublicationRecord copy;
+        {
+            boost::archive::text_iarchive archive(data);
+            archive >> copy;
+        }
+
+        RCREQUIRE(copy.hash() == pr.hash());
+
+        delete private_key;
     }}
 
 });
@@ -0,0 +1,918 @@
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <map>
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <boost/filesystem.hpp>
+
+#include "test-framework.hpp"
+
+#include "segment_store.hpp"
+#include "blockchain.hpp"
+#include "generator.hpp"
+#include "publication_record.hpp"
+#include "signature_record.hpp"
+#include "keys.hpp"
+#include "genesis_record.hpp"
+
+namespace fs = boost::filesystem;
+
+typedef std::vector< std::shared_ptr<BaseRecord> > records_t;
+
+// an empty directory for a store
+static std::string store_path( std::string t_name ){
+    fs::path path = fs::temp_directory_path() / t_name;
+    fs::remove_all(path);
+    return path.string();
+}
+
+// publications and signatures that reference each other
+static records_t make_records( size_t t_count ){
+
+    records_t records;
+    std::string previous;
+
+    for(size_t i = 0; i < t_count; ++i){
+
+        std::shared_ptr<BaseRecord> record;
+        if(i % 2 == 0){
+            record.reset(new PublicationRecord(get_path("files/general/test_publication.txt")));
+        }
+        else {
+            record.reset(new SignatureRecord(previous));
+        }
+
+        record->set_previous(previous);
+        previous = record->hash();
+
+        records.push_back(record);
+    }
+
+    return records;
+}
+
+// flip the lowest bit of a byte in a file
+static void flip_byte( std::string t_path, size_t t_offset ){
+
+    std::fstream file(t_path,std::ios::in | std::ios::out | std::ios::binary);
+
+    file.seekg(t_offset);
+    char byte = file.peek();
+    file.seekp(t_offset);
+    file.put(byte ^ 0x01);
+
+}
+
+test_set segment_store_tests("tests for the segment store",{
+
+    {"append records and open the store again",[]{
+
+        std::string path = store_path("rechain-segments-append");
+        records_t records = make_records(5);
+
+        {
+            SegmentStore store(path);
+            records_t loaded;
+
+            RCREQUIRE(store.open(loaded));
+            RCREQUIRE(loaded.empty());
+            RCREQUIRE(SegmentStore::exists(path));
+
+            for(auto& record : records){
+                RCREQUIRE(store.append(record));
+            }
+
+            RCREQUIRE(store.sync());
+            RCREQUIRE(store.size() == 5);
+            RCREQUIRE(store.tip() == records.back()->hash());
+        }
+
+        SegmentStore store(path);
+        records_t loaded;
+
+        RCREQUIRE(store.open(loaded));
+        RCREQUIRE(loaded.size() == records.size());
+
+        for(size_t i = 0; i < records.size(); ++i){
+            RCREQUIRE(loaded[i]->get_type() == records[i]->get_type());
+            RCREQUIRE(loaded[i]->hash() == records[i]->hash());
+        }
+
+        fs::remove_all(path);
+
+    }},
+
+    {"seal full segments",[]{
+
+        std::string path = store_path("rechain-segments-seal");
+        records_t records = make_records(5);
+
+        {
+            SegmentStore store(path,2,1);
+            records_t loaded;
+
+            RCREQUIRE(store.open(loaded));
+
+            for(auto& record : records){
+                RCREQUIRE(store.append(record));
+            }
+
+            auto segments = store.get_segments();
+            RCREQUIRE(segments.size() == 3);
+            RCREQUIRE(segments[0].sealed && segments[1].sealed && !segments[2].sealed);
+            RCREQUIRE(segments[1].first == 2);
+            RCREQUIRE(segments[1].tip == records[3]->hash());
+            RCREQUIRE(segments[2].records == 1);
+        }
+
+        // the manifest lists every segment and the tip
+        std::ifstream manifest((fs::path(path) / "manifest").string());
+        std::string content((std::istreambuf_iterator<char>(manifest)),std::istreambuf_iterator<char>());
+
+        RCREQUIRE(content.find("sealed segment-000000.dat 0 2") != std::string::npos);
+        RCREQUIRE(content.find("open segment-000002.dat 4 1 " + records[4]->hash()) != std::string::npos);
+
+        SegmentStore store(path,2,1);
+        records_t loaded;
+
+        RCREQUIRE(store.open(loaded));
+        RCREQUIRE(loaded.size() == 5);
+        RCREQUIRE(loaded[4]->hash() == records[4]->hash());
+
+        fs::remove_all(path);
+
+    }},
+
+    {"truncate a torn record at the end",[]{
+
+        std::string path = store_path("rechain-segments-torn");
+        records_t records = make_records(3);
+
+        std::string segment = (fs::path(path) / "segment-000000.dat").string();
+        uintmax_t length = 0;
+
+        {
+            SegmentStore store(path);
+            records_t loaded;
+
+            RCREQUIRE(store.open(loaded));
+            RCREQUIRE(store.append(records[0]));
+            RCREQUIRE(store.append(records[1]));
+            RCREQUIRE(store.sync());
+
+            length = fs::file_size(segment);
+
+            RCREQUIRE(store.append(records[2]));
+        }
+
+        // cut the last record in half
+        fs::resize_file(segment,length + (fs::file_size(segment) - length)/2);
+
+        SegmentStore store(path);
+        records_t loaded;
+
+        RCREQUIRE(store.open(loaded));
+        RCREQUIRE(loaded.size() == 2);
+        RCREQUIRE(fs::file_size(segment) == length);
+        RCREQUIRE(store.tip() == records[1]->hash());
+
+        // appending carries on after the last whole record
+        RCREQUIRE(store.append(records[2]));
+        RCREQUIRE(store.sync());
+
+        RCREQUIRE(store.open(loaded));
+        RCREQUIRE(loaded.size() == 3);
+
+        fs::remove_all(path);
+
+    }},
+
+    {"fail to open a damaged sealed segment",[]{
+
+        std::string path = store_path("rechain-segments-damaged");
+        records_t records = make_records(3);
+
+        {
+            SegmentStore store(path,2,1);
+            records_t loaded;
+
+            RCREQUIRE(store.open(loaded));
+            for(auto& record : records){
+                RCREQUIRE(store.append(record));
+            }
+        }
+
+        // damage the last record of the sealed segment, which is
+        // decoded to check the tip even when the segment is mapped
+        std::string segment = (fs::path(path) / "segment-000000.dat").string();
+        flip_byte(segment,fs::file_size(segment) - 10);
+
+        for(bool mapped : {true,false}){
+            SegmentStore store(path,2,1);
+            store.set_mapped(mapped);
+
+            records_t loaded;
+            RCREQUIRE(!store.open(loaded));
+        }
+
+        fs::remove_all(path);
+
+    }},
+
+    {"read sealed segments as views",[]{
+
+        std::string path = store_path("rechain-segments-views");
+        records_t records = make_records(5);
+
+        {
+            SegmentStore store(path,2,1);
+            records_t loaded;
+
+            RCREQUIRE(store.open(loaded));
+            for(auto& record : records){
+                RCREQUIRE(store.append(record));
+            }
+        }
+
+        SegmentStore store(path,2,1);
+        records_t loaded;
+
+        RCREQUIRE(store.get_mapped());
+        RCREQUIRE(store.open(loaded));
+
+        // only the tips of the sealed segments were decoded
+        RCREQUIRE(!loaded[0]->is_decoded());
+        RCREQUIRE(loaded[1]->is_decoded());
+        RCREQUIRE(!loaded[2]->is_decoded());
+        RCREQUIRE(loaded[4]->is_decoded());
+
+        RCREQUIRE(loaded[0]->get_type() == records[0]->get_type());
+        RCREQUIRE(!loaded[0]->is_decoded());
+
+        RCREQUIRE(loaded[0]->get_previous() == records[0]->get_previous());
+        RCREQUIRE(loaded[0]->is_decoded());
+
+        // released views keep their hash and decode again when used
+        std::string hash = loaded[2]->hash();
+        RCREQUIRE(hash == records[2]->hash());
+
+        loaded[2]->release();
+        RCREQUIRE(!loaded[2]->is_decoded());
+        RCREQUIRE(loaded[2]->hash() == hash);
+
+        auto signature = std::dynamic_pointer_cast<SignatureRecord>(loaded[3]);
+        RCREQUIRE(signature->get_record_hash() == records[2]->hash());
+
+        // a changed view isn't a view anymore
+        loaded[2]->set_previous("CHANGED");
+        loaded[2]->release();
+        RCREQUIRE(loaded[2]->is_decoded());
+        RCREQUIRE(loaded[2]->get_previous() == "CHANGED");
+
+        fs::remove_all(path);
+
+    }},
+
+    {"check mapped records when they're decoded",[]{
+
+        std::string path = store_path("rechain-segments-lazy");
+        records_t records = make_records(3);
+
+        {
+            SegmentStore store(path,2,1);
+            records_t loaded;
+
+            RCREQUIRE(store.open(loaded));
+            for(auto& record : records){
+                RCREQUIRE(store.append(record));
+            }
+        }
+
+        // damage the first record, just after the segment and frame headers
+        std::string segment = (fs::path(path) / "segment-000000.dat").string();
+        flip_byte(segment,30);
+
+        {
+            SegmentStore store(path,2,1);
+            store.set_mapped(false);
+
+            records_t loaded;
+            RCREQUIRE(!store.open(loaded));
+        }
+
+        SegmentStore store(path,2,1);
+        records_t loaded;
+
+        RCREQUIRE(store.open(loaded));
+        RCREQUIRE(loaded.size() == 3);
+        RCREQUIRE(loaded[0]->hash() != records[0]->hash());
+
+        fs::remove_all(path);
+
+    }},
+
+    {"open a blockchain from segments",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        std::string path = store_path("rechain-segments-chain");
+
+        Generator generator(9,2,0.5,4);
+        generator.set_keys(get_path("keys"));
+
+        // a chain that was only in memory is imported into the store
+        std::vector<std::string> hashes;
+        {
+            Blockchain chain;
+            RCREQUIRE(generator.generate(chain));
+
+            BaseRecord::set_difficulty(4);
+
+            RCREQUIRE(chain.open(path));
+            RCREQUIRE(chain.sync());
+
+            // only one writer can have the segments open
+            Blockchain second;
+            RCREQUIRE(!second.open(path));
+
+            for(auto& record : chain){
+                hashes.push_back(record->hash());
+            }
+        }
+
+        Blockchain opened;
+        RCREQUIRE(opened.open(path));
+        RCREQUIRE(opened.size() == 9);
+
+        auto it = opened.begin();
+        for(auto& hash : hashes){
+            RCREQUIRE((*it++)->hash() == hash);
+        }
+
+        BaseRecord::set_difficulty(difficulty);
+        fs::remove_all(path);
+
+    }},
+
+    {"refuse to load a file over open segments",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        std::string path = store_path("rechain-segments-load");
+        std::string saved = path + ".dat";
+
+        Generator generator(5,2,0.5,4);
+        generator.set_keys(get_path("keys"));
+
+        {
+            Blockchain chain;
+            RCREQUIRE(generator.generate(chain));
+            RCREQUIRE(chain.save(saved));
+
+            BaseRecord::set_difficulty(4);
+
+            RCREQUIRE(!chain.has_store());
+            RCREQUIRE(chain.open(path));
+            RCREQUIRE(chain.has_store());
+
+            // the segments stay attached, so later records still reach them
+            RCREQUIRE(!chain.load(saved));
+            RCREQUIRE(!chain.read(saved));
+            RCREQUIRE(chain.has_store());
+
+            std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+            std::shared_ptr<PublicationRecord> publication(new PublicationRecord());
+            publication->set_reference("LOADED");
+
+            RCREQUIRE(chain.publish(publication,private_key));
+            RCREQUIRE(chain.sync());
+        }
+
+        Blockchain opened;
+        RCREQUIRE(opened.open(path));
+        RCREQUIRE(opened.size() == 6);
+
+        BaseRecord::set_difficulty(difficulty);
+        fs::remove_all(path);
+        fs::remove(saved);
+
+    }},
+
+    {"resume from a snapshot when opening segments",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        std::string path = store_path("rechain-segments-snapshot");
+        std::string snapshot = path + ".snapshot";
+
+        Generator generator(9,2,0.5,4);
+        generator.set_keys(get_path("keys"));
+
+        // a copy in memory to compare with, since the segments
+        // can't be opened again while the chain has them
+        std::string saved = path + ".dat";
+
+        {
+            Blockchain imported;
+            RCREQUIRE(generator.generate(imported));
+            RCREQUIRE(imported.save(saved));
+
+            BaseRecord::set_difficulty(4);
+
+            // importing writes the first snapshot
+            imported.set_snapshot(snapshot);
+            RCREQUIRE(imported.open(path));
+            RCREQUIRE(fs::exists(snapshot));
+        }
+
+        Blockchain chain;
+        RCREQUIRE(chain.load(saved));
+
+        // nothing is left to check after the snapshot
+        uint64_t checked = 0;
+        auto progress = [&checked]( uint64_t /* t_done */, uint64_t t_total ){
+            checked = t_total;
+        };
+
+        {
+            Blockchain opened;
+            opened.set_snapshot(snapshot);
+            RCREQUIRE(opened.open(path,true,progress));
+            RCREQUIRE(opened.size() == 9);
+            RCREQUIRE(checked == 0);
+
+            for(auto& record : chain){
+                RCREQUIRE(opened.find_record(record->hash())->hash() == record->hash());
+                RCREQUIRE(opened.trust(record->hash()) == chain.trust(record->hash()));
+                RCREQUIRE(opened.trust(record->get_public_key()) == chain.trust(record->get_public_key()));
+
+                auto publication = std::dynamic_pointer_cast<PublicationRecord>(record);
+                if(publication){
+                    std::string reference = publication->get_reference();
+                    RCREQUIRE(opened.find_publication(reference)->hash() == chain.find_publication(reference)->hash());
+                    RCREQUIRE(opened.find_signatures(reference).size() == chain.find_signatures(reference).size());
+                }
+            }
+
+            // a record appended after the snapshot
+            std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+            std::shared_ptr<PublicationRecord> publication(new PublicationRecord());
+            publication->set_reference("SNAPSHOT");
+
+            RCREQUIRE(opened.publish(publication,private_key));
+            RCREQUIRE(opened.sync());
+        }
+
+        // only the new record is checked
+        std::map<std::string,double> trust;
+        {
+            Blockchain resumed;
+            resumed.set_snapshot(snapshot);
+            RCREQUIRE(resumed.open(path,true,progress));
+            RCREQUIRE(resumed.size() == 10);
+            RCREQUIRE(checked == 1);
+            RCREQUIRE(resumed.find_publication("SNAPSHOT"));
+
+            for(auto& record : resumed){
+                trust[record->hash()] = resumed.trust(record->hash());
+                trust[record->get_public_key()] = resumed.trust(record->get_public_key());
+            }
+        }
+
+        // the trust is the same as checking every record
+        Blockchain full;
+        full.set_snapshot(snapshot);
+        full.set_full_check(true);
+        RCREQUIRE(full.open(path,true,progress));
+        RCREQUIRE(checked == 10);
+
+        for(auto& entry : trust){
+            RCREQUIRE(std::fabs(entry.second - full.trust(entry.first)) < 1e-9);
+        }
+
+        BaseRecord::set_difficulty(difficulty);
+        fs::remove_all(path);
+        fs::remove(snapshot);
+        fs::remove(saved);
+
+    }},
+
+    {"check every record if the snapshot doesn't match",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        std::string path = store_path("rechain-segments-snapshot-bad");
+        std::string snapshot = path + ".snapshot";
+
+        Generator generator(9,2,0.5,4);
+        generator.set_keys(get_path("keys"));
+
+        {
+            Blockchain chain;
+            RCREQUIRE(generator.generate(chain));
+
+            BaseRecord::set_difficulty(4);
+
+            chain.set_snapshot(snapshot);
+            RCREQUIRE(chain.open(path));
+        }
+
+        uint64_t checked = 0;
+        auto progress = [&checked]( uint64_t /* t_done */, uint64_t t_total ){
+            checked = t_total;
+        };
+
+        // a damaged snapshot
+        flip_byte(snapshot,fs::file_size(snapshot) - 10);
+
+        {
+            Blockchain opened;
+            opened.set_snapshot(snapshot);
+            RCREQUIRE(opened.open(path,true,progress));
+            RCREQUIRE(opened.size() == 9);
+            RCREQUIRE(checked == 9);
+        }
+
+        // a snapshot of a different chain
+        Generator other(5,2,0.5,4);
+        other.set_keys(get_path("keys"));
+        other.set_seed(7);
+
+        Blockchain different;
+        RCREQUIRE(other.generate(different));
+
+        BaseRecord::set_difficulty(4);
+
+        different.set_snapshot(snapshot);
+        RCREQUIRE(different.snapshot());
+
+        Blockchain opened;
+        opened.set_snapshot(snapshot);
+        RCREQUIRE(opened.open(path,true,progress));
+        RCREQUIRE(opened.size() == 9);
+        RCREQUIRE(checked == 9);
+
+        BaseRecord::set_difficulty(difficulty);
+        fs::remove_all(path);
+        fs::remove(snapshot);
+
+    }},
+
+    {"share a sync between writers",[]{
+
+        std::string path = store_path("rechain-segments-group");
+        records_t records = make_records(5);
+
+        SegmentStore store(path,100,100);
+        records_t loaded;
+
+        RCREQUIRE(store.open(loaded));
+
+        for(size_t i = 0; i < 3; ++i){
+            RCREQUIRE(store.append(records[i]));
+        }
+
+        int fd = -1;
+        uint64_t height = store.begin_sync(fd);
+        RCREQUIRE(height == 3);
+        RCREQUIRE(fd >= 0);
+
+        // appended while the sync is running, so it isn't covered
+        RCREQUIRE(store.append(records[3]));
+
+        RCREQUIRE(SegmentStore::flush(fd));
+        store.end_sync(height);
+        RCREQUIRE(store.get_synced() == 3);
+
+        RCREQUIRE(store.sync());
+        RCREQUIRE(store.get_synced() == 4);
+
+        // there's nothing left to flush
+        RCREQUIRE(store.begin_sync(fd) == 4);
+        RCREQUIRE(fd == -1);
+
+        fs::remove_all(path);
+
+    }},
+
+    {"sync records published from several threads",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        std::string path = store_path("rechain-segments-threads");
+
+        BaseRecord::set_difficulty(4);
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+
+        std::shared_ptr<GenesisRecord> genesis(new GenesisRecord());
+        genesis->set_distribution({"FIRST","SECOND"});
+
+        {
+            Blockchain chain;
+            RCREQUIRE(chain.publish(genesis,private_key));
+            RCREQUIRE(chain.open(path));
+
+            std::atomic<size_t> synced(0);
+            std::vector<std::thread> writers;
+
+            for(size_t i = 0; i < 4; ++i){
+                writers.push_back(std::thread([&,i]{
+                    for(size_t j = 0; j < 3; ++j){
+                        std::shared_ptr<PublicationRecord> publication(new PublicationRecord());
+                        publication->set_reference("WRITER" + std::to_string(i) + "-" + std::to_string(j));
+
+                        if(chain.publish(publication,private_key) && chain.sync()){
+                            synced++;
+                        }
+                    }
+                }));
+            }
+
+            for(auto& writer : writers){
+                writer.join();
+            }
+
+            RCREQUIRE(synced == 12);
+        }
+
+        Blockchain opened;
+        RCREQUIRE(opened.open(path));
+        RCREQUIRE(opened.size() == 13);
+
+        BaseRecord::set_difficulty(difficulty);
+        fs::remove_all(path);
+
+    }},
+
+    {"keep synced records when the writer is killed",[]{
+
+        std::string path = store_path("rechain-segments-killed");
+        records_t records = make_records(400);
+
+        int acks[2];
+        RCREQUIRE(::pipe(acks) == 0);
+
+        pid_t child = ::fork();
+        RCREQUIRE(child >= 0);
+
+        if(child == 0){
+
+            // small segments, so it's killed around seals too
+            SegmentStore store(path,50,1000);
+            records_t loaded;
+            store.open(loaded);
+
+            // acknowledge every record once it's synced
+            for(auto& record : records){
+                char ack = 1;
+                if(!store.append(record) || !store.sync() || ::write(acks[1],&ack,1) != 1){
+                    ::_exit(1);
+                }
+            }
+
+            while(true){
+                ::pause();
+            }
+        }
+
+        ::close(acks[1]);
+
+        size_t acknowledged = 0;
+        char buffer[64];
+
+        while(acknowledged < 120){
+            ssize_t count = ::read(acks[0],buffer,sizeof(buffer));
+            if(count <= 0){
+                break;
+            }
+            acknowledged += count;
+        }
+
+        // the writer's lock keeps other processes out
+        {
+            SegmentStore store(path,50,1000);
+            records_t loaded;
+            RCREQUIRE(!store.open(loaded));
+        }
+
+        ::kill(child,SIGKILL);
+        ::waitpid(child,nullptr,0);
+
+        // records acknowledged just before the kill
+        ssize_t count;
+        while((count = ::read(acks[0],buffer,sizeof(buffer))) > 0){
+            acknowledged += count;
+        }
+
+        ::close(acks[0]);
+
+        SegmentStore store(path,50,1000);
+        records_t loaded;
+
+        RCREQUIRE(store.open(loaded));
+        RCREQUIRE(acknowledged >= 120);
+        RCREQUIRE(loaded.size() >= acknowledged);
+
+        for(size_t i = 0; i < loaded.size(); ++i){
+            RCREQUIRE(loaded[i]->hash() == records[i]->hash());
+        }
+
+        fs::remove_all(path);
+
+    }},
+
+    {"compress sealed segments with a shared dictionary",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+
+        Generator generator(10,2,0.5,4);
+        generator.set_keys(get_path("keys"));
+
+        Blockchain chain;
+        RCREQUIRE(generator.generate(chain));
+
+        BaseRecord::set_difficulty(4);
+
+        records_t records(chain.begin(),chain.end());
+        std::string plain = store_path("rechain-segments-plain");
+        std::string path  = store_path("rechain-segments-compressed");
+
+        for(bool compressed : {false,true}){
+            SegmentStore store(compressed ? path : plain,4,1);
+            store.set_compressed(compressed);
+
+            records_t loaded;
+            RCREQUIRE(store.open(loaded));
+
+            for(auto& record : records){
+                RCREQUIRE(store.append(record));
+            }
+        }
+
+        // appending only seals segments, they're compressed when the store is opened
+        RCREQUIRE(!fs::exists(fs::path(path) / "dictionary"));
+        RCREQUIRE(fs::exists(fs::path(path) / "segment-000000.dat"));
+
+        {
+            SegmentStore store(path,4,1);
+            store.set_compressed(true);
+
+            records_t loaded;
+            RCREQUIRE(store.open(loaded));
+            RCREQUIRE(loaded.size() == records.size());
+        }
+
+        // sealed segments are replaced, the open one is left alone
+        RCREQUIRE(fs::exists(fs::path(path) / "dictionary"));
+        RCREQUIRE(fs::exists(fs::path(path) / "segment-000000.z"));
+        RCREQUIRE(fs::exists(fs::path(path) / "segment-000001.z"));
+        RCREQUIRE(!fs::exists(fs::path(path) / "segment-000000.dat"));
+        RCREQUIRE(fs::exists(fs::path(path) / "segment-000002.dat"));
+
+        RCREQUIRE(fs::file_size(fs::path(path) / "segment-000001.z") < fs::file_size(fs::path(plain) / "segment-000001.dat"));
+
+        // compressed segments are read even when compression is off
+        for(bool mapped : {true,false}){
+            SegmentStore store(path,4,1);
+            store.set_mapped(mapped);
+
+            records_t loaded;
+            RCREQUIRE(store.open(loaded));
+            RCREQUIRE(loaded.size() == records.size());
+
+            for(size_t i = 0; i < loaded.size(); ++i){
+                RCREQUIRE(loaded[i]->hash() == records[i]->hash());
+                RCREQUIRE(loaded[i]->get_public_key() == records[i]->get_public_key());
+                RCREQUIRE(loaded[i]->is_valid());
+            }
+        }
+
+        BaseRecord::set_difficulty(difficulty);
+        fs::remove_all(plain);
+        fs::remove_all(path);
+
+    }},
+
+    {"fail to open a compressed segment that's damaged",[]{
+
+        std::string path = store_path("rechain-segments-compressed-damaged");
+        records_t records = make_records(3);
+
+        {
+            SegmentStore store(path,2,1);
+            store.set_compressed(true);
+
+            records_t loaded;
+            RCREQUIRE(store.open(loaded));
+
+            for(auto& record : records){
+                RCREQUIRE(store.append(record));
+            }
+
+            RCREQUIRE(store.open(loaded));
+        }
+
+        std::string segment    = (fs::path(path) / "segment-000000.z").string();
+        std::string dictionary = (fs::path(path) / "dictionary").string();
+        RCREQUIRE(fs::exists(segment));
+
+        // a segment can't be read without the dictionary it was compressed with
+        fs::rename(dictionary,dictionary + ".old");
+        {
+            SegmentStore store(path,2,1);
+            records_t loaded;
+            RCREQUIRE(!store.open(loaded));
+        }
+        fs::rename(dictionary + ".old",dictionary);
+
+        // a header that claims far more than the segment could inflate to
+        flip_byte(segment,11);
+        {
+            SegmentStore store(path,2,1);
+            records_t loaded;
+            RCREQUIRE(!store.open(loaded));
+        }
+        flip_byte(segment,11);
+
+        flip_byte(segment,fs::file_size(segment) - 10);
+
+        for(bool mapped : {true,false}){
+            SegmentStore store(path,2,1);
+            store.set_mapped(mapped);
+
+            records_t loaded;
+            RCREQUIRE(!store.open(loaded));
+        }
+
+        fs::remove_all(path);
+
+    }},
+
+    {"resume from a compressed snapshot",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        std::string path = store_path("rechain-segments-compressed-snapshot");
+        std::string snapshot = path + ".snapshot";
+
+        Generator generator(9,2,0.5,4);
+        generator.set_keys(get_path("keys"));
+
+        std::map<std::string,double> trust;
+        {
+            Blockchain chain;
+            RCREQUIRE(generator.generate(chain));
+
+            BaseRecord::set_difficulty(4);
+
+            chain.set_snapshot(snapshot);
+            chain.set_compressed(true);
+            RCREQUIRE(chain.open(path));
+
+            for(auto& record : chain){
+                trust[record->hash()] = chain.trust(record->hash());
+            }
+        }
+
+        // the chains close their segments before they're removed
+        {
+            uint64_t checked = 0;
+            auto progress = [&checked]( uint64_t /* t_done */, uint64_t t_total ){
+                checked = t_total;
+            };
+
+            Blockchain opened;
+            opened.set_snapshot(snapshot);
+            RCREQUIRE(opened.open(path,true,progress));
+            RCREQUIRE(opened.size() == 9);
+            RCREQUIRE(checked == 0);
+
+            for(auto& entry : trust){
+                RCREQUIRE(opened.trust(entry.first) == entry.second);
+            }
+        }
+
+        // a length far past what the snapshot could inflate to
+        flip_byte(snapshot,20);
+        {
+            uint64_t checked = 0;
+            auto progress = [&checked]( uint64_t /* t_done */, uint64_t t_total ){
+                checked = t_total;
+            };
+
+            Blockchain opened;
+            opened.set_snapshot(snapshot);
+            RCREQUIRE(opened.open(path,true,progress));
+            RCREQUIRE(opened.size() == 9);
+            RCREQUIRE(checked == 9);
+        }
+
+        BaseRecord::set_difficulty(difficulty);
+        fs::remove_all(path);
+        fs::remove(snapshot);
+
+    }},
+
+});
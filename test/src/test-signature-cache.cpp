@@ -0,0 +1,168 @@
+#include <iostream>
+#include <fstream>
+#include <memory>
+
+#include <sys/stat.h>
+
+#include <boost/filesystem.hpp>
+
+#include "test-framework.hpp"
+
+#include "signature_cache.hpp"
+#include "keys.hpp"
+#include "publication_record.hpp"
+
+namespace fs = boost::filesystem;
+
+// a signed record, mined at a difficulty of 4
+static std::shared_ptr<PublicationRecord> make_record(){
+
+    std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+    std::shared_ptr<PublicationRecord> pr(new PublicationRecord(get_path("files/general/test_publication.txt")));
+
+    private_key->sign(pr);
+    pr->mine(2);
+
+    return pr;
+}
+
+test_set signature_cache_tests("tests for the verified signature cache",{
+
+    {"skip a signature verified before",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(4);
+
+        auto pr = make_record();
+        std::string entry = SignatureCache::entry(pr.get());
+
+        // nothing is remembered until the cache is opened
+        RCREQUIRE(pr->is_valid());
+        RCREQUIRE(!SignatureCache::contains(entry));
+
+        SignatureCache::open("","");
+
+        RCREQUIRE(pr->is_valid());
+        RCREQUIRE(SignatureCache::get_misses() == 1);
+        RCREQUIRE(SignatureCache::size() == 1);
+
+        RCREQUIRE(pr->is_valid());
+        RCREQUIRE(SignatureCache::get_hits() == 1);
+        RCREQUIRE(SignatureCache::get_misses() == 1);
+
+        // another signature over the same data has its own entry
+        std::string signature = pr->get_signature();
+        signature[signature.size() - 1] = signature[signature.size() - 1] == 'A' ? 'B' : 'A';
+        pr->set_signature(signature);
+
+        RCREQUIRE(SignatureCache::entry(pr.get()) != entry);
+        RCREQUIRE(!pr->is_valid());
+        RCREQUIRE(SignatureCache::size() == 1);
+
+        SignatureCache::close();
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"read a saved cache with the same secret",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(4);
+
+        std::string path = (fs::temp_directory_path() / "rechain-test.verified").string();
+        std::string secret(32,'s');
+        fs::remove(path);
+
+        auto pr = make_record();
+        std::string entry = SignatureCache::entry(pr.get());
+
+        // a missing file is an empty cache
+        RCREQUIRE(SignatureCache::open(path,secret));
+        RCREQUIRE(pr->is_valid());
+        SignatureCache::close();
+
+        RCREQUIRE(fs::exists(path));
+
+        RCREQUIRE(SignatureCache::open(path,secret));
+        RCREQUIRE(SignatureCache::size() == 1);
+        RCREQUIRE(SignatureCache::contains(entry));
+        SignatureCache::close();
+
+        // a different secret doesn't match the HMAC
+        RCREQUIRE(!SignatureCache::open(path,std::string(32,'t')));
+        RCREQUIRE(SignatureCache::size() == 0);
+        RCREQUIRE(!SignatureCache::contains(entry));
+        SignatureCache::close();
+
+        // neither does a changed entry
+        {
+            std::fstream file(path,std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(20);
+            char byte = 0;
+            file.read(&byte,1);
+            file.seekp(20);
+            byte ^= 0x01;
+            file.write(&byte,1);
+        }
+
+        RCREQUIRE(!SignatureCache::open(path,secret));
+        RCREQUIRE(SignatureCache::size() == 0);
+        SignatureCache::close();
+
+        // nor a file that isn't a cache
+        {
+            std::ofstream file(path,std::ios::binary | std::ios::trunc);
+            file << "not a cache";
+        }
+
+        RCREQUIRE(!SignatureCache::open(path,secret));
+        SignatureCache::close();
+
+        fs::remove(path);
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"verify every signature when forced",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(4);
+
+        auto pr = make_record();
+
+        SignatureCache::open("","");
+        RCREQUIRE(pr->is_valid());
+
+        SignatureCache::set_forced(true);
+        RCREQUIRE(pr->is_valid());
+        RCREQUIRE(pr->is_valid());
+        RCREQUIRE(SignatureCache::get_hits() == 0);
+        RCREQUIRE(SignatureCache::get_misses() == 3);
+
+        SignatureCache::set_forced(false);
+        RCREQUIRE(pr->is_valid());
+        RCREQUIRE(SignatureCache::get_hits() == 1);
+
+        SignatureCache::close();
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"create the secret once, readable only by the user",[]{
+
+        std::string path = (fs::temp_directory_path() / "rechain-test.secret").string();
+        fs::remove(path);
+
+        std::string secret = SignatureCache::load_secret(path);
+        RCREQUIRE(secret.size() == 32);
+        RCREQUIRE(SignatureCache::load_secret(path) == secret);
+
+        struct stat info;
+        RCREQUIRE(::stat(path.c_str(),&info) == 0);
+        RCREQUIRE((info.st_mode & 0777) == 0600);
+
+        fs::remove(path);
+
+    }},
+
+});
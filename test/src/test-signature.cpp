@@ -223,7 +223,7 @@ test_set signature_tests("tests for signature records",{
         private_key->sign(&sr);
         sr.mine();
 
-        RCREQUIRE(sr.hash() < HASH_MAX);
+        RCREQUIRE(sr.is_mined());
         RCREQUIRE(!(sr.get_signature().empty()));
         RCREQUIRE(public_key->verify(&sr));
         RCREQUIRE(!(sr.get_record_hash().empty()));
@@ -283,7 +283,7 @@ test_set signature_tests("tests for signature records",{
         RCREQUIRE(sr.get_nonce() > 0);
         RCREQUIRE(sr.get_timestamp() > 0);
         RCREQUIRE(sr.get_counter() > 0);
-        RCREQUIRE(sr.hash() < HASH_MAX);
+        RCREQUIRE(sr.is_mined());
         RCREQUIRE(!(sr.get_signature().empty()));
         RCREQUIRE(public_key->verify(&sr));
         RCREQUIRE(!(sr.get_record_hash().empty()));
@@ -0,0 +1,172 @@
+#include <iostream>
+#include <memory>
+
+#include "test-framework.hpp"
+
+#include "validator.hpp"
+#include "blockchain.hpp"
+#include "key_cache.hpp"
+#include "keys.hpp"
+#include "genesis_record.hpp"
+#include "publication_record.hpp"
+#include "signature_record.hpp"
+
+test_set validator_tests("tests for the staged record validator",{
+
+    {"turn records away at the cheapest stage they fail",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(4);
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+
+        auto make_record = [&]( std::string t_reference ){
+            std::shared_ptr<SignatureRecord> sr(new SignatureRecord(t_reference));
+            private_key->sign(sr);
+            sr->mine(1);
+            return sr;
+        };
+
+        Validator::reset();
+        KeyCache::clear();
+
+        auto record = make_record("NOTAHASH");
+        KeyCache::clear();
+
+        RCREQUIRE(Validator::check(record.get()) == Validator::Passed);
+        RCREQUIRE(Validator::get_passed() == 1);
+        RCREQUIRE(KeyCache::get_misses() == 1);
+
+        uint64_t lookups = KeyCache::get_hits() + KeyCache::get_misses();
+
+        // fields that aren't a key or a signature
+        auto structure = make_record("NOTAHASH");
+        structure->set_public_key("NOT A KEY");
+        RCREQUIRE(Validator::check(structure.get()) == Validator::Structure);
+
+        structure = make_record("NOTAHASH");
+        structure->set_signature(std::string(MAX_SIGNATURE_SIZE + 2,'A'));
+        RCREQUIRE(Validator::check(structure.get()) == Validator::Structure);
+
+        // not enough work
+        auto work = make_record("NOTAHASH");
+        BaseRecord::set_difficulty(64);
+        RCREQUIRE(Validator::check(work.get()) == Validator::Work);
+        BaseRecord::set_difficulty(4);
+
+        // doesn't fit the chain
+        auto link = make_record("NOTAHASH");
+        RCREQUIRE(Validator::check(link.get(),[]{ return false; }) == Validator::Link);
+
+        // none of those looked for a key
+        RCREQUIRE(KeyCache::get_hits() + KeyCache::get_misses() == lookups);
+
+        RCREQUIRE(Validator::check(link.get(),[]{ return true; }) == Validator::Passed);
+
+        // hex that isn't a key
+        auto key = make_record("NOTAHASH");
+        key->set_public_key("00AB");
+        key->mine(1);
+        RCREQUIRE(Validator::check(key.get()) == Validator::Key);
+
+        // a signature from another record
+        auto signature = make_record("OTHERHASH");
+        signature->set_signature(record->get_signature());
+        signature->mine(1);
+        RCREQUIRE(Validator::check(signature.get()) == Validator::Signature);
+
+        RCREQUIRE(Validator::get_rejected(Validator::Structure) == 2);
+        RCREQUIRE(Validator::get_rejected(Validator::Work) == 1);
+        RCREQUIRE(Validator::get_rejected(Validator::Link) == 1);
+        RCREQUIRE(Validator::get_rejected(Validator::Key) == 1);
+        RCREQUIRE(Validator::get_rejected(Validator::Signature) == 1);
+        RCREQUIRE(Validator::get_passed() == 2);
+
+        // is_valid runs the same stages
+        RCREQUIRE(record->is_valid());
+        RCREQUIRE(!signature->is_valid());
+        RCREQUIRE(Validator::get_rejected(Validator::Signature) == 2);
+
+        Validator::reset();
+        RCREQUIRE(Validator::get_passed() == 0);
+        RCREQUIRE(Validator::get_rejected(Validator::Signature) == 0);
+
+        KeyCache::clear();
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"hold records from peers to the minimum difficulty",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(4);
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+        std::shared_ptr<SignatureRecord> record;
+
+        // mined for this node, and like almost every such record
+        // short of the work a peer's record needs
+        do {
+            record.reset(new SignatureRecord("NOTAHASH"));
+            private_key->sign(record);
+            record->mine(1);
+        } while(record->is_mined(MIN_REMOTE_DIFFICULTY));
+
+        Validator::reset();
+
+        RCREQUIRE(Validator::check(record.get()) == Validator::Passed);
+        RCREQUIRE(Validator::check_remote(record.get()) == Validator::Work);
+        RCREQUIRE(Validator::get_rejected(Validator::Work) == 1);
+
+        Validator::reset();
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+    {"count links that fail while validating a chain",[]{
+
+        unsigned int difficulty = BaseRecord::get_difficulty();
+        BaseRecord::set_difficulty(4);
+
+        std::shared_ptr<PrivateKey> private_key(PrivateKey::load_file(get_path("keys/rsa.private")));
+        std::shared_ptr<PublicKey> public_key(private_key->get_public());
+
+        Blockchain chain;
+
+        std::shared_ptr<GenesisRecord> genesis(new GenesisRecord());
+        genesis->set_distribution({public_key->to_string()});
+        RCREQUIRE(chain.publish(genesis,private_key));
+
+        Validator::reset();
+
+        std::vector< std::shared_ptr<PublicationRecord> > publications;
+        for(size_t i = 0; i < 4; ++i){
+            std::shared_ptr<PublicationRecord> publication(new PublicationRecord());
+            publication->set_reference("VALIDATOR" + std::to_string(i));
+            RCREQUIRE(chain.publish(publication,private_key));
+            publications.push_back(publication);
+        }
+
+        // a published record is only checked when it's appended
+        RCREQUIRE(Validator::get_passed() == 4);
+
+        Validator::reset();
+        RCREQUIRE(chain.is_valid(2));
+        RCREQUIRE(Validator::get_passed() == 5);
+
+        // signed and mined, but pointing at the wrong record
+        publications[1]->set_previous(genesis->hash());
+        private_key->sign(publications[1]);
+        publications[1]->mine(1);
+
+        Validator::reset();
+        RCREQUIRE(!chain.is_valid(2));
+        RCREQUIRE(chain.get_invalid() == 2);
+        RCREQUIRE(Validator::get_rejected(Validator::Link) == 1);
+        RCREQUIRE(Validator::get_rejected(Validator::Signature) == 0);
+
+        BaseRecord::set_difficulty(difficulty);
+
+    }},
+
+});